@@ -1,7 +1,27 @@
 #include <Audio.h> 
-extern AudioMixer4_F32              RX_Summer; 
+extern AudioSDRagc_F32              RX_AGC;
 extern int andx;
 extern String agc;
+extern volatile uint32_t Freq;
+
+int8_t   agc_band               = -1;       // bandmem[] slot the AGC setting was last loaded for, -1 = none yet
+uint32_t agc_band_freq          = 0;        // Freq that was looked up
+
+//function declarations
+void selectAgc();
+void applyAgc(uint8_t set);
+void agcBand(void);
+
+// Load one agc_set[] entry into the RX_AGC audio object.  AGC_OFF leaves the gain at 1.0, and its entry has the
+// hard limit off so the audio is not clipped either.
+void applyAgc(uint8_t set)
+{
+    if (set >= AGS_SET_NUM)
+        set = AGC_OFF;
+    struct AGC *a = &agc_set[set];
+    RX_AGC.setParams(a->agc_maxGain, a->agc_threshold, a->agc_attack, a->agc_decay, a->agc_hang, a->agc_hardlimit);
+    RX_AGC.enable(set != AGC_OFF);
+}
 
 void selectAgc()
 {
@@ -32,7 +52,11 @@ void selectAgc()
   }
   
 
-  if(andx==4)
+  applyAgc(andx);
+  if (agc_band >= 0 && agc_band < BANDS)
+    bandmem[agc_band].agc_mode = andx;      // the band remembers the last setting picked on it
+
+  if(andx==3)
   {
     andx=0;
   }
@@ -42,3 +66,23 @@ void selectAgc()
   }
   displayAgc();
 }
+//
+// Load the AGC setting the band Freq is in keeps in bandmem[].agc_mode.  Called at startup and from the tuning task,
+// only does anything when the dial has moved into another band.  Outside the ham bands the setting in use is kept,
+// or AGC_SLOW at startup.  agc_set[] is indexed by AGC speed only, the attack and decay do not change with the mode.
+void agcBand(void)
+{
+    bool first = (agc_band < 0);
+
+    if (Freq == agc_band_freq && !first)
+        return;
+    agc_band_freq = Freq;
+    int8_t b = nf_band_index(Freq);
+    if (b == agc_band)
+        return;
+    agc_band = b;
+    if (b >= BANDS && !first)
+        return;
+    andx = (b < BANDS) ? bandmem[b].agc_mode : AGC_SLOW;
+    selectAgc();                            // loads it and moves andx on to the next step of the AGC button cycle
+}
@@ -0,0 +1,90 @@
+/*-------------------------------------------------------------------------------
+   AudioFilterIQPhasing_F32.cpp
+
+   Function: Fused +45/-45 degree Hilbert phasing filter for the IQ receive path.
+             See AudioFilterIQPhasing_F32.h for the math.
+------------------------------------------------------------------------------- */
+
+#include "AudioFilterIQPhasing_F32.h"
+#include "FIR_Design.h"
+// -----
+void AudioFilterIQPhasing_F32::update(void) {
+  audio_block_f32_t *blockI, *blockQ;
+  blockI = receiveWritable_f32(0);                    // real (quadrature I) data, becomes the output
+  blockQ = receiveReadOnly_f32(1);                    // imaginary (quadrature Q) data
+  if (!blockI &&  blockQ) {release(blockQ); return;}
+  if ( blockI && !blockQ) {release(blockI); return;}
+  if (!blockI && !blockQ) return;
+  if (!enabled) {release(blockI); release(blockQ); return;}
+  //
+  uint16_t len = blockI->length;
+  if (len > IQ_PHASING_MAX_BLOCK) len = IQ_PHASING_MAX_BLOCK;
+  //
+  // Sum and difference of the new samples go in behind the saved taps-1 samples of history
+  float32_t *u = &histU[taps-1];
+  float32_t *v = &histV[taps-1];
+  for (int i=0; i<len; i++) {
+    u[i] = blockI->data[i] + blockQ->data[i];
+    v[i] = blockI->data[i] - blockQ->data[i];
+  }
+  //
+  // USB runs s over I+Q and a over I-Q, LSB the other way round.  pNew walks back from the
+  // newest sample and pOld walks forward from the oldest so each coefficient is used for a pair.
+  const float32_t *hs = (sideband == IQ_PHASING_LSB) ? histV : histU;
+  const float32_t *ha = (sideband == IQ_PHASING_LSB) ? histU : histV;
+  const int half = taps/2;
+  for (int n=0; n<len; n++) {
+    const float32_t *pNewS = &hs[taps-1+n];
+    const float32_t *pNewA = &ha[taps-1+n];
+    const float32_t *pOldS = &hs[n];
+    const float32_t *pOldA = &ha[n];
+    float32_t sum = 0.0f;
+    for (int k=0; k<half; k++)
+      sum += sym[k]*(*(pNewS-k) + pOldS[k]) + anti[k]*(*(pNewA-k) - pOldA[k]);
+    if (taps & 1)                                     // center tap, antisymmetric part is zero here
+      sum += sym[half] * *(pNewS-half);
+    blockI->data[n] = sum;
+  }
+  //
+  // Keep the most recent taps-1 samples for the next block
+  memmove(histU, &histU[len], (taps-1)*sizeof(float32_t));
+  memmove(histV, &histV[len], (taps-1)*sizeof(float32_t));
+
+  transmit(blockI, 0);
+  release(blockQ);
+  release(blockI);
+}
+// -------------------------- Public Functions ----------------------
+// ---
+// --- Load a +45/-45 coefficient pair in the order arm_fir_f32 takes them.  minus45 must be
+// --- plus45 reversed in time, a pair that is not is turned down and the filter left off.
+void AudioFilterIQPhasing_F32::begin(const float32_t *plus45, const float32_t *minus45, uint16_t n_taps) {
+  if (n_taps < 2 || n_taps > IQ_PHASING_MAX_TAPS) {enabled = false; return;}
+  for (int k=0; k<n_taps; k++) {
+    if (fabsf(minus45[k] - plus45[n_taps-1-k]) > 1.0e-6f) {
+      Serial.println("IQ Phasing: -45 filter is not the reverse of the +45 filter, filter off");
+      enabled = false;
+      return;
+    }
+  }
+  __disable_irq();
+  enabled = false;
+  taps    = n_taps;
+  for (int k=0; k<(taps+1)/2; k++) {                  // H1[k] = plus45[taps-1-k]
+    sym[k]  = (plus45[taps-1-k] + plus45[k]) * 0.5f;
+    anti[k] = (plus45[taps-1-k] - plus45[k]) * 0.5f;
+  }
+  memset(histU, 0, sizeof(histU));
+  memset(histV, 0, sizeof(histV));
+  enabled = true;
+  __enable_irq();
+}
+// ---
+// --- Design and load a pair passing low_Hz to high_Hz at sample_rate_Hz
+void AudioFilterIQPhasing_F32::design(float32_t low_Hz, float32_t high_Hz, uint16_t n_taps, float32_t sample_rate_Hz) {
+  float32_t plus45[IQ_PHASING_MAX_TAPS];
+  float32_t minus45[IQ_PHASING_MAX_TAPS];
+  if (n_taps > IQ_PHASING_MAX_TAPS) n_taps = IQ_PHASING_MAX_TAPS;
+  fir_design_hilbert_pair(plus45, minus45, n_taps, low_Hz, high_Hz, sample_rate_Hz);
+  begin(plus45, minus45, n_taps);
+}
@@ -0,0 +1,57 @@
+/*---------------------------------------------------------------------------------------
+  AudioFilterIQPhasing_F32.h
+
+  Function: Fused +45/-45 degree Hilbert phasing filter for the IQ receive path.  Replaces the
+            two separate AudioFilterFIR_F32 objects and the RX_Summer mixer that combined them.
+
+  Notes:    Input 0 is I, input 1 is Q.  Output 0 is the sideband picked with setSideband(),
+            USB (H1*I + H2*Q, the old Hilbert1 + Hilbert2 sum) or LSB (H1*I - H2*Q).  H1 and H2
+            are the impulse responses the old arm_fir_f32 objects applied, which are the +45
+            and -45 tables reversed in time, since CMSIS takes the coefficients in that order.
+
+            The -45 filter must be the time reverse of the +45 filter, which is true for every
+            pair in Hilbert.h and from design().  begin() turns the filter off if it is not.
+            Then H2 is H1 reversed, and splitting H1 into its symmetric part s and antisymmetric
+            part a gives H1 = s + a and H2 = s - a, so
+                USB = s*(I+Q) + a*(I-Q)
+                LSB = s*(I-Q) + a*(I+Q)
+            s and a are each folded around the center tap, so a 151 tap pair costs 76 multiplies
+            per sample for the one sideband, half of the 302 the two old FIR objects took.
+
+            design() builds a new pair for any passband and sample rate, which is needed when the
+            chain runs at a decimated rate the Hilbert.h tables were not made for.
+--------------------------------------------------------------------------------------------- */
+
+#ifndef audio_filter_iq_phasing_f32_h_
+#define audio_filter_iq_phasing_f32_h_
+#include "Arduino.h"
+#include "AudioStream_F32.h"
+#include "arm_math.h"
+//
+#define IQ_PHASING_MAX_TAPS    151
+#define IQ_PHASING_MAX_BLOCK   128
+#define IQ_PHASING_USB         0
+#define IQ_PHASING_LSB         1
+
+class AudioFilterIQPhasing_F32 : public AudioStream_F32 {
+  public:
+    AudioFilterIQPhasing_F32() : AudioStream_F32(2, inputQueueArray) {}
+    virtual void update(void);
+    // --
+    // Public functions
+    void    begin(const float32_t *plus45, const float32_t *minus45, uint16_t n_taps);
+    void    design(float32_t low_Hz, float32_t high_Hz, uint16_t n_taps, float32_t sample_rate_Hz);
+    void    setSideband(uint8_t sb) {sideband = sb;}       // IQ_PHASING_USB or IQ_PHASING_LSB
+    void    end(void) {enabled = false;}
+    // --
+  private:
+    audio_block_f32_t *inputQueueArray[2];
+    float32_t sym[(IQ_PHASING_MAX_TAPS+1)/2];                            // folded symmetric half of H1
+    float32_t anti[(IQ_PHASING_MAX_TAPS+1)/2];                           // folded antisymmetric half of H1
+    float32_t histU[IQ_PHASING_MAX_TAPS-1 + IQ_PHASING_MAX_BLOCK];       // I+Q history
+    float32_t histV[IQ_PHASING_MAX_TAPS-1 + IQ_PHASING_MAX_BLOCK];       // I-Q history
+    uint16_t  taps    = 0;
+    volatile uint8_t sideband = IQ_PHASING_USB;
+    bool      enabled = false;
+};
+#endif
@@ -0,0 +1,96 @@
+/*-------------------------------------------------------------------------------
+   AudioSDRagc_F32.cpp
+
+   Function: Block based receive AGC with one block look-ahead and hang.
+             See AudioSDRagc_F32.h for details.
+------------------------------------------------------------------------------- */
+
+#include "AudioSDRagc_F32.h"
+// -----
+void AudioSDRagc_F32::update(void) {
+  audio_block_f32_t *block;
+  block = receiveWritable_f32(0);
+  if (!block) return;
+  //
+  uint16_t n = block->length;
+  if (n > AGC_MAX_BLOCK) {release(block); return;}
+  if (n != coef_length)
+    setCoefs(n);
+  //
+  // Gain that puts this block's peak at the target
+  float32_t peak, want;
+  uint32_t  index;
+  arm_abs_f32(block->data, env, n);
+  arm_max_f32(env, n, &peak, &index);
+  if (!enabled)
+    want = 1.0f;
+  else
+    want = (peak * max_gain > target) ? target / peak : max_gain;
+  //
+  // Attack right away, hold for the hang time before letting the gain back up
+  float32_t g = gain;
+  if (want < g) {
+    g += attack_k * (want - g);
+    hang_count = hang_blocks;
+  }
+  else if (hang_count > 0 && enabled)
+    hang_count--;
+  else
+    g += decay_k * (want - g);
+  if (limit && g * peak > 1.0f)
+    g = 1.0f / peak;                              // this block is next out, it must not reach full scale
+  //
+  // Ramp from the old gain to the new one across the delayed block
+  arm_scale_f32(ramp, g - gain, env, n);
+  arm_offset_f32(env, gain, env, n);
+  arm_mult_f32(delay, env, env, n);
+  arm_copy_f32(block->data, delay, n);
+  arm_copy_f32(env, block->data, n);
+  gain = g;
+  if (limit) {
+    for (uint16_t i = 0; i < n; i++) {
+      if (block->data[i] > 1.0f) block->data[i] = 1.0f;
+      else if (block->data[i] < -1.0f) block->data[i] = -1.0f;
+    }
+  }
+  transmit(block, 0);
+  release(block);
+}
+// -----
+// Per block factors and the gain ramp for a block length
+void AudioSDRagc_F32::setCoefs(uint16_t length) {
+  float32_t block_ms = 1000.0f * length / fs;
+  attack_k = (attack_ms > 0.0f) ? 1.0f - expf(-block_ms / attack_ms) : 1.0f;
+  decay_k  = (decay_ms  > 0.0f) ? 1.0f - expf(-block_ms / decay_ms)  : 1.0f;
+  hang_blocks = (uint16_t) (hang_ms / block_ms + 0.5f);
+  for (uint16_t i = 0; i < length; i++)
+    ramp[i] = (float32_t) (i + 1) / length;
+  if (length != coef_length)
+    memset(delay, 0, sizeof(delay));
+  coef_length = length;
+}
+// -------------------------- Public Functions ----------------------
+// ---
+// --- sample_rate_Hz is the rate of the audio coming in
+void AudioSDRagc_F32::begin(float32_t sample_rate_Hz) {
+  __disable_irq();
+  fs = sample_rate_Hz;
+  coef_length = 0;                                // worked out again on the next block
+  __enable_irq();
+}
+// ---
+// --- Set the AGC characteristics.  Takes effect on the next block.
+void AudioSDRagc_F32::setParams(float32_t max_gain_dB, float32_t target_dBFS, float32_t attack,
+                                float32_t decay, float32_t hang, bool hard_limit) {
+  __disable_irq();
+  max_gain  = powf(10.0f, max_gain_dB / 20.0f);
+  target    = powf(10.0f, target_dBFS / 20.0f);
+  attack_ms = attack;
+  decay_ms  = decay;
+  hang_ms   = hang;
+  limit     = hard_limit;
+  hang_count = 0;
+  if (coef_length)
+    setCoefs(coef_length);
+  __enable_irq();
+}
@@ -0,0 +1,62 @@
+/*---------------------------------------------------------------------------------------
+  AudioSDRagc_F32.h
+
+  Function: Receive AGC.  Sets the audio gain from the block peak level with attack, hang
+            and decay, looking one block ahead so the gain is already coming down when a
+            strong signal reaches the output.
+
+  Notes:    One input, one output.  The audio is delayed by one block.  For each block the
+            gain needed to bring its peak to the target level is worked out (limited to the
+            max gain), the gain envelope moves toward it by the attack or decay factor (after
+            the hang time when the gain is going up), and the delayed block is multiplied by a
+            ramp from the old gain to the new one.  The whole block is done with CMSIS vector
+            calls so the cost per block is fixed.
+
+            Attack, decay and hang are in ms.  Attack and decay are time constants, the gain
+            moves about 63% of the way to the target in that time.  With the AGC off the gain
+            ramps back to 1.0 and the block delay stays, so switching does not click.  The hard
+            limit is set on its own, enable(false) with it off passes the audio unchanged.
+            With the hard limit on, the gain is also pulled down far enough that the block just
+            looked at will not pass full scale when it goes out, whatever the attack time, and
+            the output is clipped to +/-1.0 to catch anything left over.
+--------------------------------------------------------------------------------------------- */
+
+#ifndef audio_sdr_agc_f32_h_
+#define audio_sdr_agc_f32_h_
+#include "Arduino.h"
+#include "AudioStream_F32.h"
+#include "arm_math.h"
+//
+#define AGC_MAX_BLOCK               128
+
+class AudioSDRagc_F32 : public AudioStream_F32 {
+  public:
+    AudioSDRagc_F32() : AudioStream_F32(1, inputQueueArray) {}
+    virtual void update(void);
+    // --
+    // Public functions
+    void      begin(float32_t sample_rate_Hz);
+    void      setParams(float32_t max_gain_dB, float32_t target_dBFS, float32_t attack_ms,
+                        float32_t decay_ms, float32_t hang_ms, bool hard_limit);
+    void      enable(bool on) {enabled = on;}
+    float32_t getGain_dB(void) {return 20.0f*log10f(gain);}
+    // --
+  private:
+    audio_block_f32_t *inputQueueArray[1];
+    float32_t delay[AGC_MAX_BLOCK];               // previous block, the look-ahead
+    float32_t env[AGC_MAX_BLOCK];                 // gain for each sample of the block going out
+    float32_t ramp[AGC_MAX_BLOCK];                // 1/n, 2/n ... 1 for the current block length
+    float32_t fs = 44100.0f;
+    float32_t max_gain = 1000.0f;                 // linear
+    float32_t target = 0.1f;                      // linear peak level the AGC aims for
+    float32_t attack_ms = 5.0f, decay_ms = 500.0f, hang_ms = 250.0f;
+    float32_t attack_k = 1.0f, decay_k = 1.0f;    // per block factors for the current block length
+    uint16_t  hang_blocks = 0;
+    uint16_t  hang_count = 0;
+    uint16_t  coef_length = 0;                    // block length the factors and ramp are for
+    float32_t gain = 1.0f;
+    bool      enabled = true;
+    bool      limit = true;
+    void      setCoefs(uint16_t length);
+};
+#endif
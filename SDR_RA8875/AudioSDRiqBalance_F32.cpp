@@ -0,0 +1,105 @@
+/*-------------------------------------------------------------------------------
+   AudioSDRiqBalance_F32.cpp
+
+   Function: Adaptive IQ amplitude and phase balance.
+             See AudioSDRiqBalance_F32.h for details.
+------------------------------------------------------------------------------- */
+
+#include "AudioSDRiqBalance_F32.h"
+// -----
+void AudioSDRiqBalance_F32::update(void) {
+  audio_block_f32_t *blockI, *blockQ;
+  blockI = receiveReadOnly_f32(0);
+  blockQ = receiveWritable_f32(1);
+  if (!blockI || !blockQ) {
+    if (blockI) release(blockI);
+    if (blockQ) release(blockQ);
+    return;
+  }
+  uint16_t n = blockI->length;
+  if (blockQ->length < n) n = blockQ->length;
+  if (n > IQBAL_MAX_BLOCK) n = IQBAL_MAX_BLOCK;
+  //
+  // Block moments
+  float32_t ii, qq, iq;
+  arm_dot_prod_f32(blockI->data, blockI->data, n, &ii);
+  arm_dot_prod_f32(blockQ->data, blockQ->data, n, &qq);
+  arm_dot_prod_f32(blockI->data, blockQ->data, n, &iq);
+  //
+  if (ii > IQBAL_MIN_POWER * n && qq > IQBAL_MIN_POWER * n) {
+    ii /= n;  qq /= n;  iq /= n;
+    raw_irr_dB = imageRejection_dB(ii, qq, iq);
+    if (!primed) {
+      avg_ii = ii;  avg_qq = qq;  avg_iq = iq;
+      primed = true;
+    }
+    else {
+      avg_ii += mu * (ii - avg_ii);
+      avg_qq += mu * (qq - avg_qq);
+      avg_iq += mu * (iq - avg_iq);
+    }
+    // Correction from the running averages.  E[(Q - p*I)^2] = E[QQ] - p*E[IQ].
+    float32_t p = avg_iq / avg_ii;
+    float32_t q_orth = avg_qq - p * avg_iq;
+    if (q_orth > 0.0f) {
+      phase = p;
+      gain = sqrtf(avg_ii / q_orth);
+    }
+    // What this correction leaves on the latest block
+    float32_t c1 = -gain * phase, c2 = gain;
+    float32_t iq_c = c1 * ii + c2 * iq;
+    float32_t qq_c = c1 * c1 * ii + 2.0f * c1 * c2 * iq + c2 * c2 * qq;
+    irr_dB = enabled ? imageRejection_dB(ii, qq_c, iq_c) : raw_irr_dB;
+  }
+  //
+  // Q' = g*Q - g*p*I
+  if (enabled) {
+    arm_scale_f32(blockI->data, -gain * phase, temp, n);
+    arm_scale_f32(blockQ->data, gain, blockQ->data, n);
+    arm_add_f32(blockQ->data, temp, blockQ->data, n);
+  }
+  transmit(blockI, 0);
+  transmit(blockQ, 1);
+  release(blockI);
+  release(blockQ);
+}
+// -----
+// Image rejection of an IQ pair from its mean squares and cross product.  With amplitude ratio
+// a = sqrt(qq/ii) and phase error s = sin(phi) = iq/sqrt(ii*qq), the image to wanted power ratio is
+// (1 - 2a*cos(phi) + a^2) / (1 + 2a*cos(phi) + a^2).
+float32_t AudioSDRiqBalance_F32::imageRejection_dB(float32_t ii, float32_t qq, float32_t iq) {
+  float32_t a = sqrtf(qq / ii);
+  float32_t s = iq / sqrtf(ii * qq);
+  float32_t c2a = 2.0f * a * sqrtf(fmaxf(0.0f, 1.0f - s*s));
+  float32_t wanted = 1.0f + c2a + a*a;
+  float32_t image = 1.0f - c2a + a*a;
+  if (image * powf(10.0f, IQBAL_IRR_MAX_DB / 10.0f) <= wanted)
+    return IQBAL_IRR_MAX_DB;
+  return 10.0f * log10f(wanted / image);
+}
+// -------------------------- Public Functions ----------------------
+// ---
+// --- Angle between I and Q away from 90 degrees, from the running averages
+float32_t AudioSDRiqBalance_F32::getPhaseError_deg(void) {
+  if (!primed)
+    return 0.0f;
+  float32_t s = avg_iq / sqrtf(avg_ii * avg_qq);
+  return asinf(constrain(s, -1.0f, 1.0f)) * 180.0f / PI;
+}
+// ---
+// --- rate is the weight of each new block in the running averages, 0.001 to 1.0
+void AudioSDRiqBalance_F32::begin(float32_t rate) {
+  __disable_irq();
+  mu = constrain(rate, 0.001f, 1.0f);
+  __enable_irq();
+  reset();
+}
+// ---
+// --- Forget the learned correction and start over
+void AudioSDRiqBalance_F32::reset(void) {
+  __disable_irq();
+  gain = 1.0f;
+  phase = 0.0f;
+  primed = false;
+  __enable_irq();
+}
@@ -0,0 +1,61 @@
+/*---------------------------------------------------------------------------------------
+  AudioSDRiqBalance_F32.h
+
+  Function: Adaptive IQ amplitude and phase balance.  Learns the gain and phase mismatch
+            between the I and Q inputs from the signal itself and corrects Q so the opposite
+            sideband image is removed before the Hilbert pair and the spectrum.
+
+  Notes:    Two inputs (I, Q) and two outputs.  Blind estimator, no test signal needed.  For
+            a balanced pair E[I*Q] = 0 and E[Q*Q] = E[I*I].  Each block the three moments are
+            taken with arm_dot_prod_f32 and folded into running averages, then
+                p  = E[I*Q] / E[I*I]                  phase error (sine of the angle)
+                g  = sqrt(E[I*I] / E[(Q - p*I)^2])    gain error
+                Q' = g*Q - g*p*I                      I passes through
+            which is two multiplies and an add per sample.  With the default rate of 0.01 the
+            correction settles in a few hundred blocks.  Blocks with almost no signal are not
+            used so the estimate holds through quiet periods.
+
+            getImageRejection_dB() is the image rejection the current correction gives on the
+            latest block, getRawImageRejection_dB() is what the input has without it.  Both
+            are worked out from the moments, no FFT.
+--------------------------------------------------------------------------------------------- */
+
+#ifndef audio_sdr_iq_balance_f32_h_
+#define audio_sdr_iq_balance_f32_h_
+#include "Arduino.h"
+#include "AudioStream_F32.h"
+#include "arm_math.h"
+//
+#define IQBAL_MAX_BLOCK             128
+#define IQBAL_MIN_POWER             1e-12f  // mean square per sample below which a block is not used
+#define IQBAL_IRR_MAX_DB            100.0f  // image rejection is reported no higher than this
+
+class AudioSDRiqBalance_F32 : public AudioStream_F32 {
+  public:
+    AudioSDRiqBalance_F32() : AudioStream_F32(2, inputQueueArray) {}
+    virtual void update(void);
+    // --
+    // Public functions
+    void      begin(float32_t rate);
+    void      enable(bool on) {enabled = on;}
+    bool      isEnabled(void) {return enabled;}
+    void      reset(void);
+    float32_t getGainError_dB(void) {return -20.0f*log10f(gain);}
+    float32_t getPhaseError_deg(void);
+    float32_t getImageRejection_dB(void) {return irr_dB;}
+    float32_t getRawImageRejection_dB(void) {return raw_irr_dB;}
+    static float32_t imageRejection_dB(float32_t ii, float32_t qq, float32_t iq);
+    // --
+  private:
+    audio_block_f32_t *inputQueueArray[2];
+    float32_t temp[IQBAL_MAX_BLOCK];
+    float32_t mu = 0.01f;                         // weight of the newest block in the running averages
+    float32_t avg_ii = 0.0f, avg_qq = 0.0f, avg_iq = 0.0f;
+    float32_t gain = 1.0f;                        // g above
+    float32_t phase = 0.0f;                       // p above
+    float32_t irr_dB = 0.0f;
+    float32_t raw_irr_dB = 0.0f;
+    bool      primed = false;                     // false until the first usable block
+    bool      enabled = true;
+};
+#endif
@@ -0,0 +1,161 @@
+/*-------------------------------------------------------------------------------
+   AudioSDRplayIQ_F32.cpp
+
+   Function: Recorded IQ playback in place of the live input, double buffered.
+             See AudioSDRplayIQ_F32.h for details.
+------------------------------------------------------------------------------- */
+
+#include "AudioSDRplayIQ_F32.h"
+
+// -----
+void AudioSDRplayIQ_F32::update(void) {
+  audio_block_f32_t *block_i, *block_q, *out_i, *out_q;
+  block_i = receiveReadOnly_f32(0);
+  block_q = receiveReadOnly_f32(1);
+  if (!playing) {                                 // live input goes through untouched
+    if (block_i) {transmit(block_i, 0); release(block_i);}
+    if (block_q) {transmit(block_q, 1); release(block_q);}
+    return;
+  }
+  uint16_t n = block_i ? block_i->length : (block_q ? block_q->length : 0);
+  if (block_i) release(block_i);
+  if (block_q) release(block_q);
+  out_i = allocate_f32();
+  out_q = allocate_f32();
+  if (!out_i || !out_q) {
+    if (out_i) release(out_i);
+    if (out_q) release(out_q);
+    return;
+  }
+  if (n == 0) n = out_i->length;                  // no live block, play a full one
+  //
+  int16_t i = 0, q = 0;
+  uint16_t k;
+  for (k = 0; k < n && nextFrame(&i, &q); k++) {
+    out_i->data[k] = i * (1.0f/32768.0f);
+    out_q->data[k] = q * (1.0f/32768.0f);
+  }
+  if (k < n) {
+    if (playing) underruns++;                     // the filler is behind, not the end of the file
+    for (; k < n; k++)
+      out_i->data[k] = out_q->data[k] = 0.0f;
+  }
+  frames += n;
+  out_i->length = out_q->length = n;
+  transmit(out_i, 0);
+  transmit(out_q, 1);
+  release(out_i);
+  release(out_q);
+}
+// -----
+// Next sample pair from memory or the current half.  False if there is none ready, playing is
+// cleared when that is because the recording ended.
+bool AudioSDRplayIQ_F32::nextFrame(int16_t *i, int16_t *q) {
+  if (mem) {
+    if (mem_pos >= mem_count) {
+      if (!mem_loop || mem_count == 0) {playing = false; return false;}
+      mem_pos = 0;
+    }
+    *i = mem[2*mem_pos];
+    *q = mem[2*mem_pos + 1];
+    mem_pos++;
+    return true;
+  }
+  if (pos >= len[cur]) {
+    if (len[cur] == 0)
+      return false;                               // underrun, this half never came back
+    bool end = last[cur];
+    len[cur] = 0;                                 // hand the used half back to the filler
+    pos = 0;
+    cur ^= 1;
+    if (end) {playing = false; return false;}
+    if (len[cur] == 0)
+      return false;                               // underrun
+  }
+  const int16_t *s = (const int16_t *) &half_buf[cur][pos];
+  *i = s[0];
+  *q = s[1];
+  pos += 4;
+  return true;
+}
+// -------------------------- Public Functions ----------------------
+// ---
+// --- Hand over the file buffer, split into two halves.  Returns false if it is too small.
+bool AudioSDRplayIQ_F32::begin(uint8_t *buffer, uint32_t bytes) {
+  uint32_t h = (bytes / 2) & ~3u;
+  if (!buffer || h < 4u * AUDIO_BLOCK_SAMPLES)
+    return false;
+  __disable_irq();
+  playing = false;
+  half_buf[0] = buffer;
+  half_buf[1] = buffer + h;
+  half_size = h;
+  len[0] = len[1] = 0;
+  last[0] = last[1] = false;
+  fill_next = 0;
+  __enable_irq();
+  return true;
+}
+// ---
+// --- Start playing the halves.  Fill at least the first one before calling.
+void AudioSDRplayIQ_F32::play(void) {
+  __disable_irq();
+  mem = NULL;
+  pos = 0;
+  cur = 0;
+  frames = underruns = 0;
+  playing = (half_buf[0] != NULL);
+  __enable_irq();
+}
+// ---
+// --- Stop and drop whatever is left in the halves
+void AudioSDRplayIQ_F32::stop(void) {
+  __disable_irq();
+  playing = false;
+  mem = NULL;
+  len[0] = len[1] = 0;
+  last[0] = last[1] = false;
+  fill_next = 0;
+  __enable_irq();
+}
+// ---
+// --- Play count sample pairs from memory, I then Q.  The frames must stay put while playing.
+void AudioSDRplayIQ_F32::playMemory(const int16_t *data, uint32_t count, bool loop) {
+  __disable_irq();
+  mem = data;
+  mem_count = count;
+  mem_pos = 0;
+  mem_loop = loop;
+  frames = underruns = 0;
+  playing = (data != NULL);
+  __enable_irq();
+}
+// ---
+// --- The half to fill next, or -1 if it is still full.  Halves are filled in turn starting with 0,
+// --- the order update() reads them in, even after an underrun.
+int8_t AudioSDRplayIQ_F32::emptyHalf(uint8_t **buffer, uint32_t *bytes) {
+  if (!half_buf[0] || len[fill_next] != 0)
+    return -1;
+  *buffer = half_buf[fill_next];
+  *bytes = half_size;
+  return fill_next;
+}
+// ---
+// --- Give a filled half to update().  bytes is rounded down to whole sample pairs, 0 with last ends playback.
+void AudioSDRplayIQ_F32::halfFilled(int8_t half, uint32_t bytes, bool end) {
+  if (half < 0 || half > 1)
+    return;
+  bytes &= ~3u;
+  if (bytes > half_size) bytes = half_size;
+  if (bytes == 0 && !end)
+    return;
+  if (bytes == 0) {                               // an empty last half still has to be seen to end playback
+    int16_t *s = (int16_t *) half_buf[half];
+    s[0] = s[1] = 0;                              // so it holds one frame of silence
+    bytes = 4;
+  }
+  last[half] = end;
+  __DMB();                                        // data and last flag in memory before update() sees len
+  len[half] = bytes;
+  fill_next = half ^ 1;
+}
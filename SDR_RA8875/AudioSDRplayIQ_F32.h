@@ -0,0 +1,66 @@
+/*---------------------------------------------------------------------------------------
+  AudioSDRplayIQ_F32.h
+
+  Function: IQ playback.  Sits between the I2S input and the receive chain and, while
+            playing, sends recorded 16 bit interleaved IQ (I first) in place of the live input.
+            Stopped, the live blocks pass straight through.
+
+  Notes:    Two inputs, two outputs.  The graph can not be rewired at run time, so this goes in
+            line after AudioInputI2S_F32 instead of replacing it.  The live input keeps clocking
+            the audio updates, so playback runs at the capture rate.  Nothing here touches the
+            SD card, so it builds anywhere AudioStream_F32 does and a test harness can call
+            update() as fast as it likes to run a recording through the chain.
+
+            File playback is double buffered.  begin() splits the caller's buffer in two halves.
+            loop() side code asks for the next empty half with emptyHalf(), fills it and hands it back
+            with halfFilled(), see IQ_File.h.  update() reads one half while the other is being
+            filled and switches when it runs out.  If the next half is not ready the rest of the
+            block is zeros and the underrun is counted.  The half marked last ends playback.
+            Each half is owned by one side at a time, len[] says which, so no locks are needed.
+
+            playMemory() plays frames straight from memory instead, optionally looping.
+            Samples are int16 full scale in, +/-1.0 out, the same scaling as the I2S input.
+--------------------------------------------------------------------------------------------- */
+
+#ifndef audio_sdr_play_iq_f32_h_
+#define audio_sdr_play_iq_f32_h_
+#include "Arduino.h"
+#include "AudioStream_F32.h"
+#include "arm_math.h"
+//
+
+class AudioSDRplayIQ_F32 : public AudioStream_F32 {
+  public:
+    AudioSDRplayIQ_F32() : AudioStream_F32(2, inputQueueArray) {}
+    virtual void update(void);
+    // --
+    // Public functions
+    bool      begin(uint8_t *buffer, uint32_t bytes);
+    void      play(void);
+    void      playMemory(const int16_t *data, uint32_t count, bool loop);
+    void      stop(void);
+    bool      isPlaying(void) {return playing;}
+    int8_t    emptyHalf(uint8_t **buffer, uint32_t *bytes);
+    void      halfFilled(int8_t half, uint32_t bytes, bool end);
+    uint32_t  getFrames(void) {return frames;}
+    uint32_t  getUnderruns(void) {return underruns;}
+    // --
+  private:
+    audio_block_f32_t *inputQueueArray[2];
+    uint8_t  *half_buf[2] = {NULL, NULL};
+    uint32_t  half_size = 0;                      // bytes in each half, a multiple of 4
+    volatile uint32_t len[2] = {0, 0};            // bytes ready in each half, 0 = empty and owned by the filler
+    volatile bool     last[2] = {false, false};   // playback ends with this half
+    uint32_t  pos = 0;                            // bytes used from the current half
+    uint8_t   cur = 0;                            // half update() is reading
+    uint8_t   fill_next = 0;                      // half the filler gets next
+    const int16_t *mem = NULL;                    // playMemory() source
+    uint32_t  mem_count = 0;
+    uint32_t  mem_pos = 0;
+    bool      mem_loop = false;
+    volatile uint32_t frames = 0;                 // sample pairs played
+    volatile uint32_t underruns = 0;              // blocks that ran out of data
+    volatile bool     playing = false;
+    bool      nextFrame(int16_t *i, int16_t *q);
+};
+#endif
@@ -0,0 +1,141 @@
+/*------------------------------------------------------------------------------- 
+   AudioSDRpreProcessor_F32.cpp 
+
+   Function: A input pre-proccessor to "condition"  quadrature (IQ) input signals before passing
+              to the rest of the F32 receive chain.  See AudioSDRpreProcessor_F32.h for details.
+
+   Author:   Derek Rowell (drowell@mit.edu)
+   Date:     April 26, 2019  
+             Ported to the F32 library from the int16 AudioSDRpreProcessor.
+  ---  
+  Copyright (c) 2019 Derek Rowell
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+------------------------------------------------------------------------------- */
+
+#include "AudioSDRpreProcessor_F32.h"
+// -----
+void AudioSDRpreProcessor_F32::update(void) { 
+  audio_block_f32_t *blockI, *blockQ, *delayed;
+  blockI = receiveReadOnly_f32(0);                    // real (quadrature I) data
+  blockQ = receiveReadOnly_f32(1);                    // imaginary (quadrature Q) data
+  if (!blockI &&  blockQ) {release(blockQ); return;}
+  if ( blockI && !blockQ) {release(blockI); return;}
+  if (!blockI && !blockQ) return;
+  //
+  //---------------------------------------------------------------------------------------------
+  // Teensy I2S single-sample delay IQ lag compensation:
+  //   Note: The Teensy I2S bug causes a randomly occuring single-sample delay in I2S input
+  //     channel 1 (blockQ in this case) on power-up or program reload.   To correct this,
+  //     simply delay the samples in I2S input channel 0 (blockI) by a single sample so that
+  //     the channels are synchronized again.  -1 is the other way round, Q is delayed.
+  //     The channel that is not delayed is passed on as it came in.
+  // ---
+  if (I2Scorrection == 1) {
+    delayed = delayBlock(blockI);
+    if (delayed) {release(blockI); blockI = delayed;}
+  }
+  else if (I2Scorrection == -1) {
+    delayed = delayBlock(blockQ);
+    if (delayed) {release(blockQ); blockQ = delayed;}
+  }
+  //
+  // ----------------------------------------------------------------------
+  // Swap I and Q channels to I in channel and Q in channel 0 to correct for
+  // incorrect quadrature input connections.  Only the outputs are swapped.
+  if (IQswap) {
+    transmit(blockQ, 0);
+    transmit(blockI, 1);
+  }
+  else {
+    transmit(blockI, 0);
+    transmit(blockQ, 1);
+  }
+  release(blockQ);
+  release(blockI);
+}
+// -----
+// New block holding the input one sample later.  NULL if no block is free, the input then goes
+// through uncorrected for this block.
+audio_block_f32_t *AudioSDRpreProcessor_F32::delayBlock(audio_block_f32_t *in) {
+  audio_block_f32_t *out = allocate_f32();
+  if (!out) return NULL;
+  uint16_t n = in->length;
+  out->length = n;
+  out->data[0] = savedSample;
+  arm_copy_f32(in->data, out->data + 1, n - 1);
+  savedSample = in->data[n - 1];                      // save the most recent sample for the next buffer
+  return out;
+}
+// -------------------------- Public Functions ----------------------
+// ---
+//   I2S single-sample delay detection - look for spectral images in the spectrum FFT.
+//   The method recognizes that errors in the phase (and amplitude) of the I and Q channels
+//   will generate symmetrical image lines in the complex spectrum, reflecting similar amplitudes in lines
+//   j and (n__FTT j).   If there is no I2S error, the ratio between these lines will be large.
+//   line_dB is the strongest spectrum line (already well above the noise floor), image_dB its mirror bin.
+//   Call once per spectrum frame.  Returns true if the correction was changed.
+bool AudioSDRpreProcessor_F32::checkImage(float line_dB, float image_dB) {
+  if (!autoDetectFlag) return false;
+  if (settleCount > 0) {settleCount--; return false;}
+  if (line_dB - image_dB < minImbalanceRatio_dB) failureCount++;   // Ratio too low, increment failure counter
+  else failureCount = 0;                                            // Success - start the count over
+  successCount++;
+  if (failureCount > maxFailureCount) {                             // Too many failures (low ratios) in a row...
+    int16_t next = I2Scorrection + 1;
+    if (next > 1) next = -1;                                        // Try a new correction factor (-1, 0, or 1)...
+    I2Scorrection = next;
+    failureCount  = 0;                                              // and start over...
+    successCount  = 0;
+    settleCount   = settleFrames;
+    return true;
+  }
+  if (successCount > maxSuccessCount)
+    autoDetectFlag = false;                    // Turn autoCorrection off and accept the current correction
+  return false;
+}
+// ---
+// --- Enable auto detection and correction of the I2S input error
+void  AudioSDRpreProcessor_F32::startAutoI2SerrorDetection(void) {
+  autoDetectFlag = true;
+  I2Scorrection  = 0;
+  failureCount   = 0;
+  successCount   = 0;
+  settleCount    = 0;
+}
+// ---
+// --- Disable auto detection and correction of the I2S input error
+void  AudioSDRpreProcessor_F32::stopAutoI2SerrorDetection(void) {
+  autoDetectFlag = false;
+  I2Scorrection  = 0;            // Revert to no compensation
+}
+// --- Return the state of the auto detection
+//     true = auto detection is active, false = auto detection is inactve
+bool AudioSDRpreProcessor_F32::getAutoI2SerrorDetectionStatus(void) {return autoDetectFlag;}
+//
+// --- Manually set I2S error correction mode 
+void  AudioSDRpreProcessor_F32::setI2SerrorCompensation(int correction) {
+  I2Scorrection   = constrain(correction, -1, 1);
+  autoDetectFlag  = false;                 // Cancel auto correction if active
+}
+// ---
+// ---  Fetch the current state of the I2S error correction (on or off)
+int16_t AudioSDRpreProcessor_F32::getI2SerrorCompensation(void) {return I2Scorrection;}
+// ---
+// --- Swap quadrature inputs from I on channel 0 to I on channel 1
+void  AudioSDRpreProcessor_F32::swapIQ(bool swap) {IQswap = swap;}
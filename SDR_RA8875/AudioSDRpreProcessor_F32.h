@@ -1,11 +1,12 @@
 /*--------------------------------------------------------------------------------------- 
-  AudioSDRpreprocessor.h 
+  AudioSDRpreProcessor_F32.h 
 
   Function: A input pre-proccessor to "condition"  quadrature (IQ) input signals before passing 
-            to the AudioSDR software-defined-radio Teensy 3.6 Audio block.
+            to the rest of the F32 receive chain.  Sits right after AudioInputI2S_F32.
 
   Author:   Derek Rowell (drowell@mit.edu)
   Date:     April 26, 2019  
+            Ported to the F32 library from the int16 AudioSDRpreProcessor.
 
   Notes:    Includes the following functions:
             a) Automatically detect and correct the random Teensy single-sample delay
@@ -16,6 +17,16 @@
               is that the I channel should be connected to the I2S input 0 (left) and that
               the Q channel should be connect to input 1 (right).   If your hardware does not
               use this convention, you can use this software fix.
+
+            The channel that is not delayed goes straight through, its block is passed on
+            untouched.  The delayed channel is written into a new block one position along with a
+            single arm_copy_f32, the last input sample is kept to start the next block.  The IQ
+            swap only swaps which block goes to which output, no samples are moved.
+
+            The lag detection does no FFT of its own.  While it is running the spectrum code
+            passes the level of the strongest spectrum line and of its mirror image bin to
+            checkImage() once per spectrum frame, see spectrum_lag_check() in Spectrum_RA8875.h.
+            The decision runs in the caller's context, update() only applies the correction.
   --  
   Copyright (c) 2019 Derek Rowell
   Permission is hereby granted, free of charge, to any person obtaining a copy
@@ -37,23 +48,20 @@
   SOFTWARE.
 --------------------------------------------------------------------------------------------- */
 
-#ifndef audio_sdr_preprocessor_h_
-#define audio_sdr_preprocessor_h_
-#include "core_pins.h"
-#include "AudioStream.h"
-#include "arm_math.h"
-#include "arm_const_structs.h"
+#ifndef audio_sdr_preprocessor_f32_h_
+#define audio_sdr_preprocessor_f32_h_
 #include "Arduino.h"
+#include "AudioStream_F32.h"
+#include "arm_math.h"
 //
-#define maxSuccessCount        1000
-#define maxFailureCount        10
-#define minImbalanceRatio      10.0
-#define spectralAvgMultiplier  10.0
-#define n_block 128
+#define maxSuccessCount        40       // spectrum frames in a row with a good image ratio to accept the correction
+#define maxFailureCount        5        // frames in a row with a poor image ratio to try the next correction
+#define minImbalanceRatio_dB   10.0
+#define settleFrames           3        // frames skipped after a correction change while the spectrum catches up
 
-class AudioSDRpreProcessor: public AudioStream {
+class AudioSDRpreProcessor_F32: public AudioStream_F32 {
   public:
-    AudioSDRpreProcessor() : AudioStream(2, inputQueueArray) {}
+    AudioSDRpreProcessor_F32() : AudioStream_F32(2, inputQueueArray) {}
     virtual void update(void);
     // --
     // Public  functions
@@ -62,19 +70,18 @@ class AudioSDRpreProcessor: public AudioStream {
     bool    getAutoI2SerrorDetectionStatus(void);
     void    setI2SerrorCompensation(int correction);
     int16_t getI2SerrorCompensation(void);
-    void    swapIQ(boolean swap);
+    void    swapIQ(bool swap);
+    bool    checkImage(float line_dB, float image_dB);
     // -- 
   private:
-    audio_block_t *inputQueueArray[2];
-    float   buffer[256];
-    float   image_ratio   = 1.0;
-    float   avg;
+    audio_block_f32_t *inputQueueArray[2];
+    float   savedSample   = 0.0f;    // last sample of the delayed channel, first one out next block
     int16_t I2Scorrection = 0;
-    int16_t savedSample   = 0;
     int16_t failureCount  = 0;
     int16_t successCount  = 0;
-     bool   IQswap = false;
-    bool    I2SerrorCheckEnabled = true;
-    bool    autoDetectFlag  = false;
+    int16_t settleCount   = 0;
+    bool    IQswap = false;
+    volatile bool autoDetectFlag  = false;
+    audio_block_f32_t *delayBlock(audio_block_f32_t *in);
 };
 #endif
@@ -0,0 +1,85 @@
+/*-------------------------------------------------------------------------------
+   AudioSDRrecordIQ_F32.cpp
+
+   Function: IQ capture into a lock free ring for recording.
+             See AudioSDRrecordIQ_F32.h for details.
+------------------------------------------------------------------------------- */
+
+#include "AudioSDRrecordIQ_F32.h"
+
+// -----
+void AudioSDRrecordIQ_F32::update(void) {
+  audio_block_f32_t *block_i, *block_q;
+  block_i = receiveReadOnly_f32(0);
+  block_q = receiveReadOnly_f32(1);
+  if (!recording || !ring) {
+    if (block_i) release(block_i);
+    if (block_q) release(block_q);
+    return;
+  }
+  if (!block_i && !block_q) return;
+  //
+  uint16_t  n  = block_i ? block_i->length : block_q->length;
+  uint32_t  h  = head;
+  uint32_t  fill = h - tail;
+  if (fill + 4u * n > size) {
+    dropped++;                                    // the reader is behind, lose this block
+  } else {
+    const float32_t *pi = block_i ? block_i->data : NULL;
+    const float32_t *pq = block_q ? block_q->data : NULL;
+    for (uint16_t k = 0; k < n; k++) {
+      int16_t *dst = (int16_t *) &ring[h & (size-1)];   // h stays 4 byte aligned and size is a power of 2
+      dst[0] = pi ? (int16_t) __SSAT((int32_t) (pi[k] * 32768.0f), 16) : 0;
+      dst[1] = pq ? (int16_t) __SSAT((int32_t) (pq[k] * 32768.0f), 16) : 0;
+      h += 4;
+    }
+    __DMB();                                      // data is in memory before the reader can see the new head
+    head = h;
+    blocks++;
+    fill += 4u * n;
+    if (fill > max_fill) max_fill = fill;
+  }
+  if (block_i) release(block_i);
+  if (block_q) release(block_q);
+}
+// -------------------------- Public Functions ----------------------
+// ---
+// --- Hand over the ring.  bytes must be a power of 2, at least one block.  Returns false if it is not.
+bool AudioSDRrecordIQ_F32::begin(uint8_t *buffer, uint32_t bytes) {
+  if (!buffer || bytes < 4u * AUDIO_BLOCK_SAMPLES || (bytes & (bytes-1)) != 0)
+    return false;
+  __disable_irq();
+  recording = false;
+  ring = buffer;
+  size = bytes;
+  head = tail = 0;
+  __enable_irq();
+  return true;
+}
+// ---
+// --- Empty the ring, clear the counts and start taking blocks
+void AudioSDRrecordIQ_F32::start(void) {
+  __disable_irq();
+  head = tail = 0;
+  blocks = dropped = max_fill = 0;
+  recording = (ring != NULL);
+  __enable_irq();
+}
+// ---
+// --- Oldest unread bytes.  *contiguous is how many can be read there before the ring wraps.
+const uint8_t *AudioSDRrecordIQ_F32::readPtr(uint32_t *contiguous) {
+  uint32_t t = tail;
+  uint32_t used = head - t;
+  __DMB();                                        // read the head before the data it covers
+  uint32_t pos = t & (size-1);
+  *contiguous = (used < size - pos) ? used : size - pos;
+  return &ring[pos];
+}
+// ---
+// --- Done with bytes from readPtr(), give the space back to update()
+void AudioSDRrecordIQ_F32::consume(uint32_t bytes) {
+  uint32_t used = head - tail;
+  if (bytes > used) bytes = used;
+  __DMB();                                        // finished reading before update() may write over it
+  tail += bytes;
+}
@@ -0,0 +1,59 @@
+/*---------------------------------------------------------------------------------------
+  AudioSDRrecordIQ_F32.h
+
+  Function: IQ capture for recording.  Converts the I and Q blocks to interleaved 16 bit
+            samples (I first) and puts them in a ring buffer that loop() side code drains to
+            the SD card, see IQ_File.h.
+
+  Notes:    Two inputs, no outputs.  The ring is single producer (update(), in the audio
+            interrupt) and single consumer (loop()), so no locks are needed.  Only update()
+            moves head and only consume() moves tail.  The counts run freely and are masked
+            for the position, head - tail is the fill.  A memory barrier sits between the
+            data and the head update so the reader never sees a head past the data.
+
+            Nothing is allocated.  The caller gives begin() the buffer, a power of 2 in bytes.
+            When a whole block does not fit it is dropped and counted, the audio update never
+            waits on the reader.  Samples are +/-1.0 full scale in, saturated to int16.
+            A missing input block records as zeros for that channel.
+
+            Blocks are 4 bytes per sample pair, so 128 sample blocks land as one 512 byte SD
+            sector each.  readPtr() hands back the longest run that does not wrap.
+--------------------------------------------------------------------------------------------- */
+
+#ifndef audio_sdr_record_iq_f32_h_
+#define audio_sdr_record_iq_f32_h_
+#include "Arduino.h"
+#include "AudioStream_F32.h"
+#include "arm_math.h"
+//
+
+class AudioSDRrecordIQ_F32 : public AudioStream_F32 {
+  public:
+    AudioSDRrecordIQ_F32() : AudioStream_F32(2, inputQueueArray) {}
+    virtual void update(void);
+    // --
+    // Public functions
+    bool      begin(uint8_t *buffer, uint32_t bytes);
+    void      start(void);
+    void      stop(void) {recording = false;}
+    bool      isRecording(void) {return recording;}
+    uint32_t  available(void) {return head - tail;}   // bytes waiting for the reader
+    const uint8_t *readPtr(uint32_t *contiguous);
+    void      consume(uint32_t bytes);
+    uint32_t  getBlocks(void) {return blocks;}
+    uint32_t  getDropped(void) {return dropped;}
+    uint32_t  getMaxFill(void) {return max_fill;}
+    uint32_t  getSize(void) {return size;}
+    // --
+  private:
+    audio_block_f32_t *inputQueueArray[2];
+    uint8_t  *ring = NULL;
+    uint32_t  size = 0;                           // bytes, power of 2
+    volatile uint32_t head = 0;                   // bytes written, only update() changes it
+    volatile uint32_t tail = 0;                   // bytes read, only consume() changes it
+    volatile uint32_t blocks = 0;                 // blocks stored
+    volatile uint32_t dropped = 0;                // blocks that did not fit
+    volatile uint32_t max_fill = 0;               // most bytes waiting since start()
+    volatile bool     recording = false;
+};
+#endif
@@ -0,0 +1,85 @@
+/*-------------------------------------------------------------------------------
+   AudioSDRresample_F32.cpp
+
+   Function: Polyphase decimate (IQ pair) and interpolate (single channel) objects.
+             See AudioSDRresample_F32.h for details.
+------------------------------------------------------------------------------- */
+
+#include "AudioSDRresample_F32.h"
+#include "FIR_Design.h"
+// -----
+void AudioDecimateIQ_F32::update(void) {
+  audio_block_f32_t *blockI, *blockQ;
+  blockI = receiveWritable_f32(0);                    // real (quadrature I) data
+  blockQ = receiveWritable_f32(1);                    // imaginary (quadrature Q) data
+  if (!blockI &&  blockQ) {release(blockQ); return;}
+  if ( blockI && !blockQ) {release(blockI); return;}
+  if (!blockI && !blockQ) return;
+  //
+  if (factor > 1) {
+    // Each output is written at or behind the input samples already consumed, so run in place
+    arm_fir_decimate_f32(&decI, blockI->data, blockI->data, blockI->length);
+    arm_fir_decimate_f32(&decQ, blockQ->data, blockQ->data, blockQ->length);
+    blockI->length /= factor;
+    blockQ->length /= factor;
+  }
+  transmit(blockI, 0);
+  transmit(blockQ, 1);
+  release(blockQ);
+  release(blockI);
+}
+// -----
+void AudioInterpolate_F32::update(void) {
+  audio_block_f32_t *blockIn, *blockOut;
+  blockIn = receiveReadOnly_f32(0);
+  if (!blockIn) return;
+  if (factor == 1) {
+    transmit(blockIn, 0);
+    release(blockIn);
+    return;
+  }
+  blockOut = allocate_f32();
+  if (!blockOut) {release(blockIn); return;}
+  arm_fir_interpolate_f32(&interp, blockIn->data, blockOut->data, blockIn->length);
+  blockOut->length = blockIn->length * factor;
+  transmit(blockOut, 0);
+  release(blockOut);
+  release(blockIn);
+}
+// -------------------------- Public Functions ----------------------
+// ---
+// --- Set the decimation factor.  sample_rate_Hz is the input (capture) rate.
+void AudioDecimateIQ_F32::begin(uint16_t decimation, float32_t sample_rate_Hz) {
+  if (decimation < 1 || decimation > RESAMPLE_MAX_FACTOR || RESAMPLE_MAX_BLOCK % decimation) {
+    Serial.println("Decimate: factor must divide the block size, using 1");
+    decimation = 1;
+  }
+  uint16_t taps = decimation * RESAMPLE_TAPS_PER_FACTOR;
+  __disable_irq();
+  factor = decimation;
+  if (factor > 1) {
+    fir_design_lowpass(coeffs, taps, RESAMPLE_CUTOFF*sample_rate_Hz/factor, sample_rate_Hz, 1.0f,
+                       RESAMPLE_KAISER_BETA);
+    arm_fir_decimate_init_f32(&decI, taps, factor, coeffs, stateI, RESAMPLE_MAX_BLOCK);
+    arm_fir_decimate_init_f32(&decQ, taps, factor, coeffs, stateQ, RESAMPLE_MAX_BLOCK);
+  }
+  __enable_irq();
+}
+// ---
+// --- Set the interpolation factor.  sample_rate_Hz is the output (capture) rate.
+void AudioInterpolate_F32::begin(uint16_t interpolation, float32_t sample_rate_Hz) {
+  if (interpolation < 1 || interpolation > RESAMPLE_MAX_FACTOR || RESAMPLE_MAX_BLOCK % interpolation) {
+    Serial.println("Interpolate: factor must divide the block size, using 1");
+    interpolation = 1;
+  }
+  uint16_t taps = interpolation * RESAMPLE_TAPS_PER_FACTOR;
+  __disable_irq();
+  factor = interpolation;
+  if (factor > 1) {
+    // Zero stuffing drops the level by the factor, make it up in the filter gain
+    fir_design_lowpass(coeffs, taps, RESAMPLE_CUTOFF*sample_rate_Hz/factor, sample_rate_Hz, (float32_t)factor,
+                       RESAMPLE_KAISER_BETA);
+    arm_fir_interpolate_init_f32(&interp, factor, taps, coeffs, state, RESAMPLE_MAX_BLOCK/factor);
+  }
+  __enable_irq();
+}
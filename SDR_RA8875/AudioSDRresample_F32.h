@@ -0,0 +1,71 @@
+/*---------------------------------------------------------------------------------------
+  AudioSDRresample_F32.h
+
+  Function: Polyphase decimate and interpolate objects so the demodulator chain can run at a
+            fraction of the I2S capture rate.
+
+  Notes:    AudioDecimateIQ_F32 takes I and Q (inputs 0 and 1) at the capture rate and sends
+            audio_block_samples/factor samples per block on outputs 0 and 1.  Only every
+            factor'th output of the anti-alias filter is computed, so it costs taps/factor
+            multiplies per input sample.
+
+            AudioInterpolate_F32 takes one channel at the reduced rate and returns full size
+            blocks at the capture rate for AudioOutputI2S_F32.  The CMSIS interpolator runs the
+            filter as factor polyphase branches so the zero stuffed samples are never multiplied.
+
+            Both filters are flat (+/-0.01dB) to 0.35 * capture rate / factor and at least 60dB down
+            from capture rate / (2 * factor), the reduced rate's Nyquist, so nothing aliases into the
+            demodulator passband.  That takes RESAMPLE_TAPS_PER_FACTOR taps per unit of factor with a
+            Kaiser window, and the multiplies per sample grow with it.  A factor of 1 passes blocks
+            through untouched.  factor must divide the block size.
+--------------------------------------------------------------------------------------------- */
+
+#ifndef audio_sdr_resample_f32_h_
+#define audio_sdr_resample_f32_h_
+#include "Arduino.h"
+#include "AudioStream_F32.h"
+#include "arm_math.h"
+//
+#define RESAMPLE_MAX_FACTOR         16
+#define RESAMPLE_TAPS_PER_FACTOR    28
+#define RESAMPLE_CUTOFF             0.425f          // -6dB point as a fraction of the reduced rate
+#define RESAMPLE_KAISER_BETA        6.0f
+#define RESAMPLE_MAX_TAPS           (RESAMPLE_MAX_FACTOR*RESAMPLE_TAPS_PER_FACTOR)
+#define RESAMPLE_MAX_BLOCK          128
+
+class AudioDecimateIQ_F32 : public AudioStream_F32 {
+  public:
+    AudioDecimateIQ_F32() : AudioStream_F32(2, inputQueueArray) {}
+    virtual void update(void);
+    // --
+    // Public functions
+    void     begin(uint16_t decimation, float32_t sample_rate_Hz);
+    uint16_t getFactor(void) {return factor;}
+    // --
+  private:
+    audio_block_f32_t *inputQueueArray[2];
+    arm_fir_decimate_instance_f32 decI;
+    arm_fir_decimate_instance_f32 decQ;
+    float32_t coeffs[RESAMPLE_MAX_TAPS];
+    float32_t stateI[RESAMPLE_MAX_TAPS + RESAMPLE_MAX_BLOCK - 1];
+    float32_t stateQ[RESAMPLE_MAX_TAPS + RESAMPLE_MAX_BLOCK - 1];
+    uint16_t  factor = 1;
+};
+
+class AudioInterpolate_F32 : public AudioStream_F32 {
+  public:
+    AudioInterpolate_F32() : AudioStream_F32(1, inputQueueArray) {}
+    virtual void update(void);
+    // --
+    // Public functions
+    void     begin(uint16_t interpolation, float32_t sample_rate_Hz);
+    uint16_t getFactor(void) {return factor;}
+    // --
+  private:
+    audio_block_f32_t *inputQueueArray[1];
+    arm_fir_interpolate_instance_f32 interp;
+    float32_t coeffs[RESAMPLE_MAX_TAPS];
+    float32_t state[RESAMPLE_TAPS_PER_FACTOR + RESAMPLE_MAX_BLOCK - 1];
+    uint16_t  factor = 1;
+};
+#endif
@@ -0,0 +1,72 @@
+/*-------------------------------------------------------------------------------
+   AudioSDRsmeter_F32.cpp
+
+   Function: Signal strength meter with attack/decay ballistics and a table based log.
+             See AudioSDRsmeter_F32.h for details.
+------------------------------------------------------------------------------- */
+
+#include "AudioSDRsmeter_F32.h"
+
+float32_t AudioSDRsmeter_F32::log2_table[SMETER_LOG2_SIZE + 1];
+bool      AudioSDRsmeter_F32::table_built = false;
+// -----
+void AudioSDRsmeter_F32::update(void) {
+  audio_block_f32_t *block;
+  block = receiveReadOnly_f32(0);
+  if (!block) return;
+  //
+  if (block->length != coef_length)
+    setCoefs(block->length);
+  float32_t p;
+  arm_power_f32(block->data, block->length, &p);  // sum of squares
+  p /= block->length;
+  float32_t l = level;
+  l += ((p > l) ? attack_k : decay_k) * (p - l);
+  level = l;
+  new_data = true;
+  release(block);
+}
+// -----
+// Smoothing factor per block for a time constant, 1 - e^(-block time / tau)
+void AudioSDRsmeter_F32::setCoefs(uint16_t length) {
+  float32_t block_ms = 1000.0f * length / fs;
+  attack_k = (attack_ms > 0.0f) ? 1.0f - expf(-block_ms / attack_ms) : 1.0f;
+  decay_k  = (decay_ms  > 0.0f) ? 1.0f - expf(-block_ms / decay_ms)  : 1.0f;
+  coef_length = length;
+}
+// -------------------------- Public Functions ----------------------
+// ---
+// --- Set the ballistics.  sample_rate_Hz is the rate of the audio coming in.
+void AudioSDRsmeter_F32::begin(float32_t attack, float32_t decay, float32_t sample_rate_Hz) {
+  if (!table_built) {
+    for (int16_t i = 0; i <= SMETER_LOG2_SIZE; i++)
+      log2_table[i] = log2f(1.0f + (float32_t) i / SMETER_LOG2_SIZE);
+    table_built = true;
+  }
+  __disable_irq();
+  attack_ms = attack;
+  decay_ms  = decay;
+  fs = sample_rate_Hz;
+  coef_length = 0;                                // worked out again on the next block
+  __enable_irq();
+}
+// ---
+// --- Smoothed level in dB full scale.  Clears available().
+float32_t AudioSDRsmeter_F32::getdBFS(void) {
+  new_data = false;
+  return fastdB(level);
+}
+// ---
+// --- 10*log10(power).  Splits the float into exponent and mantissa and looks the mantissa up.
+float32_t AudioSDRsmeter_F32::fastdB(float32_t power) {
+  if (!(power > 0.0f) || !table_built)
+    return SMETER_FLOOR_DB;
+  union {float32_t f; uint32_t u;} v = {power};
+  int32_t   e = (int32_t) ((v.u >> 23) & 0xFF) - 127;
+  uint32_t  m = v.u & 0x7FFFFF;
+  uint32_t  i = m >> (23 - SMETER_LOG2_BITS);
+  float32_t f = (float32_t) (m & ((1 << (23 - SMETER_LOG2_BITS)) - 1)) / (1 << (23 - SMETER_LOG2_BITS));
+  float32_t l2 = e + log2_table[i] + f * (log2_table[i+1] - log2_table[i]);
+  float32_t dB = 3.0103f * l2;                    // 10*log10(2) per octave
+  return (dB < SMETER_FLOOR_DB) ? SMETER_FLOOR_DB : dB;
+}
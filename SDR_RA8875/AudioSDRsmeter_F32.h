@@ -0,0 +1,52 @@
+/*---------------------------------------------------------------------------------------
+  AudioSDRsmeter_F32.h
+
+  Function: Signal strength meter.  Measures the mean power of each block in the audio update
+            and smooths it with separate attack and decay time constants, like the ballistics
+            of an analog meter.  The result is read back in dB full scale.
+
+  Notes:    One input, no outputs.  Power is averaged over the block with arm_power_f32 so the
+            update is a single MAC pass.  The conversion to dB uses a 128 entry log2 table with
+            linear interpolation instead of log10f.  Measured against 10*log10 from 1e-12 to 100 it
+            is within 0.00005 dB (host/test_smeter checks it stays under 0.0001 dB).
+
+            getdBFS() can be called at any time, available() says a new block came in since the
+            last read.  Converting dBFS to dBm and S units is up to the caller, see Smeter.h.
+--------------------------------------------------------------------------------------------- */
+
+#ifndef audio_sdr_smeter_f32_h_
+#define audio_sdr_smeter_f32_h_
+#include "Arduino.h"
+#include "AudioStream_F32.h"
+#include "arm_math.h"
+//
+#define SMETER_LOG2_BITS            7       // mantissa bits used to index the log2 table
+#define SMETER_LOG2_SIZE            (1 << SMETER_LOG2_BITS)
+#define SMETER_FLOOR_DB             -200.0f
+
+class AudioSDRsmeter_F32 : public AudioStream_F32 {
+  public:
+    AudioSDRsmeter_F32() : AudioStream_F32(1, inputQueueArray) {}
+    virtual void update(void);
+    // --
+    // Public functions
+    void      begin(float32_t attack_ms, float32_t decay_ms, float32_t sample_rate_Hz);
+    bool      available(void) {return new_data;}
+    float32_t getdBFS(void);
+    static float32_t fastdB(float32_t power);     // 10*log10(power) from the table
+    // --
+  private:
+    audio_block_f32_t *inputQueueArray[1];
+    static float32_t log2_table[SMETER_LOG2_SIZE + 1];
+    static bool      table_built;
+    volatile float32_t level = 0.0f;              // smoothed power
+    volatile bool      new_data = false;
+    float32_t attack_ms = 10.0f;
+    float32_t decay_ms  = 500.0f;
+    float32_t fs = 44100.0f;
+    float32_t attack_k = 1.0f;                    // per block smoothing factors for the current block length
+    float32_t decay_k  = 1.0f;
+    uint16_t  coef_length = 0;                    // block length the factors were worked out for
+    void      setCoefs(uint16_t length);
+};
+#endif
@@ -0,0 +1,66 @@
+/*-------------------------------------------------------------------------------
+   AudioSDRzoomIQ_F32.cpp
+
+   Function: Zoom FFT front end, decimates the IQ around the VFO.
+             See AudioSDRzoomIQ_F32.h for details.
+------------------------------------------------------------------------------- */
+
+#include "AudioSDRzoomIQ_F32.h"
+#include "FIR_Design.h"
+// -----
+void AudioSDRzoomIQ_F32::update(void) {
+  audio_block_f32_t *blockI, *blockQ;
+  blockI = receiveWritable_f32(0);                    // real (quadrature I) data
+  blockQ = receiveWritable_f32(1);                    // imaginary (quadrature Q) data
+  if (!blockI &&  blockQ) {release(blockQ); return;}
+  if ( blockI && !blockQ) {release(blockI); return;}
+  if (!blockI && !blockQ) return;
+  //
+  uint16_t n = blockI->length;
+  float32_t *pI = blockI->data;
+  float32_t *pQ = blockQ->data;
+  if (factor == 1) {
+    transmit(blockI, 0);
+    transmit(blockQ, 1);
+    release(blockQ);
+    release(blockI);
+    return;
+  }
+  // Each output is written at or behind the input samples already consumed, so run in place
+  arm_fir_decimate_f32(&decI, pI, pI, n);
+  arm_fir_decimate_f32(&decQ, pQ, pQ, n);
+  n /= factor;
+  //
+  // Collect the short blocks into full ones for the FFT
+  memcpy(&accI[acc_count], pI, n*sizeof(float32_t));
+  memcpy(&accQ[acc_count], pQ, n*sizeof(float32_t));
+  acc_count += n;
+  if (acc_count >= blockI->length) {
+    memcpy(pI, accI, acc_count*sizeof(float32_t));
+    memcpy(pQ, accQ, acc_count*sizeof(float32_t));
+    acc_count = 0;
+    transmit(blockI, 0);
+    transmit(blockQ, 1);
+  }
+  release(blockQ);
+  release(blockI);
+}
+// -------------------------- Public Functions ----------------------
+// ---
+// --- Set the zoom factor.  sample_rate_Hz is the input (capture) rate.
+void AudioSDRzoomIQ_F32::begin(uint16_t zoom, float32_t sample_rate_Hz) {
+  if (zoom < 1 || zoom > ZOOM_MAX_FACTOR || (zoom & (zoom-1))) {
+    Serial.println("Zoom: factor must be 1, 2, 4, 8 or 16, using 1");
+    zoom = 1;
+  }
+  uint16_t taps = zoom * ZOOM_TAPS_PER_FACTOR;
+  __disable_irq();
+  factor = zoom;
+  acc_count = 0;
+  if (factor > 1) {
+    fir_design_lowpass(coeffs, taps, 0.45f*sample_rate_Hz/factor, sample_rate_Hz, 1.0f);
+    arm_fir_decimate_init_f32(&decI, taps, factor, coeffs, stateI, ZOOM_MAX_BLOCK);
+    arm_fir_decimate_init_f32(&decQ, taps, factor, coeffs, stateQ, ZOOM_MAX_BLOCK);
+  }
+  __enable_irq();
+}
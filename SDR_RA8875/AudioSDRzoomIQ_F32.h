@@ -0,0 +1,54 @@
+/*---------------------------------------------------------------------------------------
+  AudioSDRzoomIQ_F32.h
+
+  Function: Zoom FFT front end.  Low pass filters and decimates the IQ stream so the spectrum
+            FFT that follows sees a narrower band around the VFO at the same FFT size.  A zoom
+            of 4 gives 1/4 the span with 4x finer bins.
+
+  Notes:    Inputs 0 and 1 are I and Q at the capture rate, outputs 0 and 1 are I and Q at
+            capture rate / zoom.  The decimated samples are collected and sent on as full size
+            blocks, so the FFT gets one block for every zoom blocks in and does less work, not
+            more, as the zoom goes up.
+
+            The zoomed span is always centered on the VFO (0Hz), the spectrum display's labels,
+            center line and DC blanking all assume that, so there is no mixer.  The anti-alias
+            filter uses the CMSIS decimator which only computes the samples kept, taps/zoom
+            multiplies per input sample.  Its -6dB point is at 0.45 * capture rate / zoom, the
+            outer few bins of a zoomed span are rolled off a bit.
+
+            A zoom of 1 passes blocks through untouched.  zoom must be 1, 2, 4, 8 or 16.
+--------------------------------------------------------------------------------------------- */
+
+#ifndef audio_sdr_zoom_iq_f32_h_
+#define audio_sdr_zoom_iq_f32_h_
+#include "Arduino.h"
+#include "AudioStream_F32.h"
+#include "arm_math.h"
+//
+#define ZOOM_MAX_FACTOR             16
+#define ZOOM_TAPS_PER_FACTOR        24
+#define ZOOM_MAX_TAPS               (ZOOM_MAX_FACTOR*ZOOM_TAPS_PER_FACTOR)
+#define ZOOM_MAX_BLOCK              128
+
+class AudioSDRzoomIQ_F32 : public AudioStream_F32 {
+  public:
+    AudioSDRzoomIQ_F32() : AudioStream_F32(2, inputQueueArray) {}
+    virtual void update(void);
+    // --
+    // Public functions
+    void      begin(uint16_t zoom, float32_t sample_rate_Hz);
+    uint16_t  getFactor(void) {return factor;}
+    // --
+  private:
+    audio_block_f32_t *inputQueueArray[2];
+    arm_fir_decimate_instance_f32 decI;
+    arm_fir_decimate_instance_f32 decQ;
+    float32_t coeffs[ZOOM_MAX_TAPS];
+    float32_t stateI[ZOOM_MAX_TAPS + ZOOM_MAX_BLOCK - 1];
+    float32_t stateQ[ZOOM_MAX_TAPS + ZOOM_MAX_BLOCK - 1];
+    float32_t accI[ZOOM_MAX_BLOCK];               // decimated samples waiting to fill an output block
+    float32_t accQ[ZOOM_MAX_BLOCK];
+    uint16_t  acc_count = 0;
+    uint16_t  factor = 1;
+};
+#endif
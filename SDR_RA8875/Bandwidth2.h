@@ -1,12 +1,23 @@
 #include <Audio.h> 
 //extern AudioFilterBiquad       BandPass; 
-extern AudioFilterFIR_F32      Hilbert1;
-extern AudioFilterFIR_F32      Hilbert2;
+extern AudioFilterIQPhasing_F32 RX_Hilbert;
+extern AudioDecimateIQ_F32     RX_Decimate;
+extern float rx_sample_rate_Hz;
 extern AudioFilterBiquad_F32   CW_Filter;
 extern int bndx;
 extern  String bandwidth;
 
 ////////////////////////////////////////////////////////////////////////////////////
+// The Hilbert.h tables are for the full capture rate.  When the receive chain is decimated
+// a pair with the same passband is designed for the lower rate instead.
+void setHilbert(float32_t *plus45, float32_t *minus45, float low_Hz, float high_Hz)
+{
+  if (RX_Decimate.getFactor() == 1)
+    RX_Hilbert.begin(plus45, minus45, 151);
+  else
+    RX_Hilbert.design(low_Hz, high_Hz, 151, rx_sample_rate_Hz);
+}
+
 void selectBandwidth(int ndx)
 {
  
@@ -14,16 +25,14 @@ void selectBandwidth(int ndx)
   {
         Serial.println("Lets set the bandwidth to 250 Hz");
         bandwidth="Bw 250 Hz";
-        Hilbert1.begin(Hilbert_Plus45_500,151);
-        Hilbert2.begin(Hilbert_Minus45_500,151);
+        setHilbert(Hilbert_Plus45_500, Hilbert_Minus45_500, 150.0f, 1500.0f);
         CW_Filter.setBandpass(0,250.0f,9.0f);                     
   }
   if(bndx==1)
   {
        Serial.println("Lets set the bandwidth to 500 Hz");
        bandwidth="Bw 500 Hz";
-       Hilbert1.begin(Hilbert_Plus45_500,151);
-       Hilbert2.begin(Hilbert_Minus45_500,151);
+       setHilbert(Hilbert_Plus45_500, Hilbert_Minus45_500, 150.0f, 1500.0f);
        CW_Filter.setBandpass(0,500.0f,9.0f);
   }
   
@@ -31,8 +40,7 @@ void selectBandwidth(int ndx)
   {
       Serial.println("Lets set the bandwidth to 700 Hz");
       bandwidth="Bw 700 Hz";
-      Hilbert1.begin(Hilbert_Plus45_700,151);
-      Hilbert2.begin(Hilbert_Minus45_700,151);
+      setHilbert(Hilbert_Plus45_700, Hilbert_Minus45_700, 150.0f, 1700.0f);
       CW_Filter.setBandpass(0,700.0f,9.0f);
   }
 
@@ -40,8 +48,7 @@ void selectBandwidth(int ndx)
   {
       Serial.println("Lets set the bandwidth to 1.0kHz");
       bandwidth="Bw 1.0 kHz";
-      Hilbert1.begin(Hilbert_Plus45_1K,151);
-      Hilbert2.begin(Hilbert_Minus45_1K,151);
+      setHilbert(Hilbert_Plus45_1K, Hilbert_Minus45_1K, 250.0f, 2050.0f);
       CW_Filter.setBandpass(0,1000.0f,9.0f);
   }
 
@@ -49,40 +56,35 @@ void selectBandwidth(int ndx)
   {
       Serial.println("Lets set the bandwidth to 1.8kHz");
       bandwidth="Bw 1.8 kHz";  
-      Hilbert1.begin(Hilbert_Plus45_18K,151);
-      Hilbert2.begin(Hilbert_Minus45_18K,151);
+      setHilbert(Hilbert_Plus45_18K, Hilbert_Minus45_18K, 150.0f, 2000.0f);
    }
 
   if(bndx==5)
   {
       Serial.println("Lets set the bandwidth to 2.3kkHz");
       bandwidth="Bw 2.3kHz";
-      Hilbert1.begin(Hilbert_Plus45_23K,151);
-      Hilbert2.begin(Hilbert_Minus45_23K,151);
+      setHilbert(Hilbert_Plus45_23K, Hilbert_Minus45_23K, 150.0f, 2350.0f);
   }
 
   if(bndx==6)
   {
       Serial.println("Lets set the bandwidth to 2.8 kHz");
       bandwidth="Bw 2.8 kHz";
-      Hilbert1.begin(Hilbert_Plus45_28K,151);
-      Hilbert2.begin(Hilbert_Minus45_28K,151);
+      setHilbert(Hilbert_Plus45_28K, Hilbert_Minus45_28K, 150.0f, 2700.0f);
   }
  
   if(bndx==7)
   {
       Serial.println("Lets set the bandwidth to 3.2 kHz");
       bandwidth="Bw 3.2 kHz";
-      Hilbert1.begin(Hilbert_Plus45_32K,151);
-      Hilbert2.begin(Hilbert_Minus45_32K,151);           
+      setHilbert(Hilbert_Plus45_32K, Hilbert_Minus45_32K, 150.0f, 3000.0f);           
   }
   
   if(bndx==8) 
   {
       Serial.println("Lets set the bandwidth to 4.0 kHz");
       bandwidth="4.0 kHz";
-      Hilbert1.begin(Hilbert_Plus45_40K,151);
-      Hilbert2.begin(Hilbert_Minus45_40K,151);
+      setHilbert(Hilbert_Plus45_40K, Hilbert_Minus45_40K, 150.0f, 4500.0f);
   } 
 
   displayBandwidth();
@@ -52,11 +52,11 @@ void displayBandwidth()
 
 void displayFreq()
 { 
- tft.fillRect(305, 0, 210, 40,RA8875_BLACK);
- tft.setFont(Arial_32);
- tft.setCursor(306,6);
- tft.setTextColor(RA8875_LIGHT_ORANGE);
- tft.print(float(Freq)/1000,3);
+ char string[DQ_TEXT_LEN];
+ 
+ snprintf(string, DQ_TEXT_LEN, "%.3f", float(Freq)/1000);
+ // Called for every tuning step.  One tagged op, a burst of steps overwrites it in the queue until it is drawn.
+ dq_field(DQ_TAG_FREQ, 305, 0, 210, 40, RA8875_BLACK, 306, 6, Arial_32, RA8875_LIGHT_ORANGE, string);
 }
 
 void displayStep()
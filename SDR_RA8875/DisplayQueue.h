@@ -0,0 +1,328 @@
+//
+// DisplayQueue.h
+//
+// Display command queue so loop() does not sit waiting on the RA8875.  Producers put draw ops (rects, lines,
+// text, BTE block moves, row writes) into a ring and return right away.  displayQueue_service() is called every
+// pass through loop() and runs queued ops for a limited time.  After starting a BTE move it checks the controller
+// busy status on the following passes instead of spinning on it, so tuning and touch get serviced while the
+// controller is moving memory.
+//
+// The RA8875 library does its SPI transfers with the CPU, there is no DMA path to hang this on.  The queue gets
+// the same effect for the parts that matter here: the waits on the controller no longer happen in line.
+//
+// Ops run in the order queued.  Anything drawing straight to tft while ops may be pending (touch UI, spectrum trace)
+// must call displayQueue_sync() first so it does not collide with a BTE move still running.
+//
+// Producers never wait.  When the ring is full the op is dropped, the call returns false and dq_drops counts it.
+// Callers that queue a group of ops that only make sense together check displayQueue_room() first.  A readout that
+// can change faster than it is drawn (the frequency while tuning) goes in as one tagged DQ_FIELD op, and a newer
+// field with the same tag overwrites the one still waiting instead of taking another entry.
+//
+// All display access goes through a DQ_Transport.  displayQueue_setTransport() can swap in a mock that records
+// the command stream, which lets the queue logic be exercised off target.
+//
+#include <RA8875.h>
+
+extern RA8875 tft;
+
+#define DQ_SIZE                 64          // ring entries, power of 2
+#define DQ_TEXT_LEN             24          // longest text string an op can carry
+#define DQ_SLICE_US             1000        // default time budget for one displayQueue_service() call
+
+enum DQ_Op_Type {
+    DQ_FILL_RECT,               // x, y, w, h, color
+    DQ_WRITE_RECT,              // x, y, w, h, pixels.  pixels must stay valid until the op runs
+    DQ_HLINE,                   // x, y, w, color
+    DQ_VLINE,                   // x, y, h, color
+    DQ_BTE_MOVE,                // x, y, w, h -> x2, y2, layers
+    DQ_TEXT,                    // x, y, color, font, text
+    DQ_FIELD,                   // fill x, y, w, h with bg_color, then text at x2, y2 in color and font
+    DQ_CALL                     // fn(value) for drawing that has no op of its own
+};
+
+enum DQ_Field_Tag {             // DQ_FIELD readouts that replace their own queued op
+    DQ_TAG_NONE,
+    DQ_TAG_FREQ
+};
+
+struct DQ_Cmd {
+    uint8_t  op;
+    uint8_t  tag;               // DQ_FIELD only, DQ_TAG_NONE for every other op
+    uint8_t  src_layer;
+    uint8_t  dst_layer;
+    uint16_t color;
+    uint16_t bg_color;
+    int16_t  x, y, w, h;
+    int16_t  x2, y2;
+    const ILI9341_t3_font_t *font;
+    const uint16_t *pixels;
+    void   (*fn)(float);
+    float    value;
+    char     text[DQ_TEXT_LEN];
+};
+
+struct DQ_Transport {
+    void (*exec)(const struct DQ_Cmd *cmd);     // carry out one op
+    bool (*busy)(void);                         // true while the controller is still working on a BTE move
+};
+
+struct DQ_Cmd   dq_ring[DQ_SIZE];
+volatile uint16_t dq_head       = 0;        // next free entry
+volatile uint16_t dq_tail       = 0;        // next entry to run
+bool     dq_bte_pending         = false;    // a BTE move was started and has not been seen to finish
+uint16_t dq_depth_max           = 0;        // most entries waiting at once since the last stats print
+uint32_t dq_ops_run             = 0;        // total ops carried out
+uint32_t dq_drops               = 0;        // ops dropped because the ring was full
+uint32_t dq_coalesced           = 0;        // DQ_FIELD ops that overwrote a queued one with the same tag
+uint32_t dq_sync_waits          = 0;        // times displayQueue_sync() had work to finish
+uint32_t dq_service_max_us      = 0;        // longest displayQueue_service() call since the last stats print
+
+//function declarations
+void displayQueue_service(uint32_t budget_us);
+void displayQueue_sync(void);
+bool displayQueue_pending(void);
+bool displayQueue_room(uint16_t ops);
+void displayQueue_setTransport(const struct DQ_Transport *t);
+void printDisplayQueueStats(void);
+
+//
+//_____________________________________________ RA8875 Transport _________________________________________
+//
+static void dq_ra8875_exec(const struct DQ_Cmd *c)
+{
+    switch (c->op)
+    {
+        case DQ_FILL_RECT:  tft.fillRect(c->x, c->y, c->w, c->h, c->color);                 break;
+        case DQ_WRITE_RECT: tft.writeRect(c->x, c->y, c->w, c->h, c->pixels);               break;
+        case DQ_HLINE:      tft.drawFastHLine(c->x, c->y, c->w, c->color);                  break;
+        case DQ_VLINE:      tft.drawFastVLine(c->x, c->y, c->h, c->color);                  break;
+        case DQ_BTE_MOVE:   tft.BTE_move(c->x, c->y, c->w, c->h, c->x2, c->y2, c->src_layer, c->dst_layer);  break;
+        case DQ_TEXT:       tft.setFont(*c->font);
+                            tft.setTextColor(c->color);
+                            tft.setCursor(c->x, c->y);
+                            tft.print(c->text);
+                            break;
+        case DQ_FIELD:      tft.fillRect(c->x, c->y, c->w, c->h, c->bg_color);
+                            tft.setFont(*c->font);
+                            tft.setTextColor(c->color);
+                            tft.setCursor(c->x2, c->y2);
+                            tft.print(c->text);
+                            break;
+        case DQ_CALL:       c->fn(c->value);                                                break;
+    }
+}
+//
+static bool dq_ra8875_busy(void)
+{
+    return tft.readStatus();
+}
+//
+const struct DQ_Transport dq_ra8875 = {dq_ra8875_exec, dq_ra8875_busy};
+const struct DQ_Transport *dq_transport = &dq_ra8875;
+
+//
+//_____________________________________________ Queue Engine _________________________________________
+//
+static inline uint16_t dq_depth(void)
+{
+    return (dq_head - dq_tail) & (DQ_SIZE-1);
+}
+//
+bool displayQueue_pending(void)
+{
+    return dq_head != dq_tail || dq_bte_pending;
+}
+//
+// True if ops more entries can be queued right now
+bool displayQueue_room(uint16_t ops)
+{
+    return dq_depth() + ops <= DQ_SIZE-1;
+}
+//
+// Run queued ops until the queue is empty, the time budget is used up, or a BTE move is still running.
+// Never waits on the controller.
+void displayQueue_service(uint32_t budget_us)
+{
+    uint32_t start = micros();
+
+    while (1)
+    {
+        if (dq_bte_pending)
+        {
+            if (dq_transport->busy())
+                break;                      // check again next time around
+            dq_bte_pending = false;
+        }
+        if (dq_head == dq_tail || micros() - start >= budget_us)
+            break;
+
+        struct DQ_Cmd *c = &dq_ring[dq_tail];
+        dq_transport->exec(c);
+        dq_ops_run++;
+        if (c->op == DQ_BTE_MOVE)
+            dq_bte_pending = true;
+        dq_tail = (dq_tail + 1) & (DQ_SIZE-1);
+    }
+
+    uint32_t t = micros() - start;
+    if (t > dq_service_max_us)
+        dq_service_max_us = t;
+}
+//
+// Finish everything queued, including a BTE move in progress.  Call before drawing directly to tft.
+void displayQueue_sync(void)
+{
+    if (!displayQueue_pending())
+        return;
+    dq_sync_waits++;
+    while (displayQueue_pending())
+        displayQueue_service(DQ_SLICE_US);
+}
+//
+void displayQueue_setTransport(const struct DQ_Transport *t)
+{
+    displayQueue_sync();
+    dq_transport = t;
+}
+//
+//_____________________________________________ Producers _________________________________________
+//
+// Get the next free entry, or NULL if the ring is full.  Does not wait for the engine to make room.
+static struct DQ_Cmd *dq_next(uint8_t op)
+{
+    if (dq_depth() == DQ_SIZE-1)
+    {
+        dq_drops++;
+        return NULL;
+    }
+    struct DQ_Cmd *c = &dq_ring[dq_head];
+    c->op = op;
+    c->tag = DQ_TAG_NONE;
+    return c;
+}
+//
+static inline void dq_commit(void)
+{
+    dq_head = (dq_head + 1) & (DQ_SIZE-1);
+    if (dq_depth() > dq_depth_max)
+        dq_depth_max = dq_depth();
+}
+//
+bool dq_fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+    struct DQ_Cmd *c = dq_next(DQ_FILL_RECT);
+    if (!c) return false;
+    c->x = x; c->y = y; c->w = w; c->h = h; c->color = color;
+    dq_commit();
+    return true;
+}
+//
+bool dq_writeRect(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *pixels)
+{
+    struct DQ_Cmd *c = dq_next(DQ_WRITE_RECT);
+    if (!c) return false;
+    c->x = x; c->y = y; c->w = w; c->h = h; c->pixels = pixels;
+    dq_commit();
+    return true;
+}
+//
+bool dq_drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
+{
+    struct DQ_Cmd *c = dq_next(DQ_HLINE);
+    if (!c) return false;
+    c->x = x; c->y = y; c->w = w; c->color = color;
+    dq_commit();
+    return true;
+}
+//
+bool dq_drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
+{
+    struct DQ_Cmd *c = dq_next(DQ_VLINE);
+    if (!c) return false;
+    c->x = x; c->y = y; c->h = h; c->color = color;
+    dq_commit();
+    return true;
+}
+//
+bool dq_BTE_move(int16_t x, int16_t y, int16_t w, int16_t h, int16_t dx, int16_t dy, uint8_t src_layer, uint8_t dst_layer)
+{
+    struct DQ_Cmd *c = dq_next(DQ_BTE_MOVE);
+    if (!c) return false;
+    c->x = x; c->y = y; c->w = w; c->h = h; c->x2 = dx; c->y2 = dy;
+    c->src_layer = src_layer; c->dst_layer = dst_layer;
+    dq_commit();
+    return true;
+}
+//
+bool dq_print(int16_t x, int16_t y, const ILI9341_t3_font_t &font, uint16_t color, const char *text)
+{
+    struct DQ_Cmd *c = dq_next(DQ_TEXT);
+    if (!c) return false;
+    c->x = x; c->y = y; c->font = &font; c->color = color;
+    strncpy(c->text, text, DQ_TEXT_LEN-1);
+    c->text[DQ_TEXT_LEN-1] = '\0';
+    dq_commit();
+    return true;
+}
+//
+// A readout box: clear it and draw the text.  With a tag, a field still waiting in the ring with the same tag is
+// overwritten in place so only the newest value is drawn, and a burst of updates costs one draw.
+bool dq_field(uint8_t tag, int16_t x, int16_t y, int16_t w, int16_t h, uint16_t bg_color,
+              int16_t tx, int16_t ty, const ILI9341_t3_font_t &font, uint16_t color, const char *text)
+{
+    struct DQ_Cmd *c = NULL;
+    if (tag != DQ_TAG_NONE)
+    {
+        for (uint16_t i = dq_tail; i != dq_head; i = (i + 1) & (DQ_SIZE-1))
+            if (dq_ring[i].op == DQ_FIELD && dq_ring[i].tag == tag)
+            {
+                c = &dq_ring[i];
+                dq_coalesced++;
+                break;
+            }
+    }
+    bool queued = (c == NULL);
+    if (queued)
+    {
+        c = dq_next(DQ_FIELD);
+        if (!c) return false;
+    }
+    c->tag = tag;
+    c->x = x; c->y = y; c->w = w; c->h = h; c->bg_color = bg_color;
+    c->x2 = tx; c->y2 = ty; c->font = &font; c->color = color;
+    strncpy(c->text, text, DQ_TEXT_LEN-1);
+    c->text[DQ_TEXT_LEN-1] = '\0';
+    if (queued)
+        dq_commit();
+    return true;
+}
+//
+bool dq_call(void (*fn)(float), float value)
+{
+    struct DQ_Cmd *c = dq_next(DQ_CALL);
+    if (!c) return false;
+    c->fn = fn; c->value = value;
+    dq_commit();
+    return true;
+}
+//
+// Queue report for the console 'C' command
+void printDisplayQueueStats(void)
+{
+    Serial.print("Display Queue Depth: ");
+    Serial.print(dq_depth());
+    Serial.print(", Max: ");
+    Serial.print(dq_depth_max);
+    Serial.print(", Ops Run: ");
+    Serial.print(dq_ops_run);
+    Serial.print(", Dropped: ");
+    Serial.print(dq_drops);
+    Serial.print(", Coalesced: ");
+    Serial.print(dq_coalesced);
+    Serial.print(", Sync Waits: ");
+    Serial.print(dq_sync_waits);
+    Serial.print(", Service Max (uS): ");
+    Serial.println(dq_service_max_us);
+    dq_depth_max = 0;
+    dq_service_max_us = 0;
+}
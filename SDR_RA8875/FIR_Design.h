@@ -0,0 +1,74 @@
+/*---------------------------------------------------------------------------------------
+  FIR_Design.h
+
+  Function: Windowed-sinc FIR coefficient generators shared by the audio objects that need
+            filters computed for a sample rate chosen at run time (decimation, interpolation,
+            Hilbert phasing pairs).
+
+  Notes:    These use floating point trig and are meant to be called from begin()/design()
+            style setup functions, never from an update().  The Hilbert pairs use a Blackman
+            window.  The resampler filters use a Kaiser window, which gets the same stopband
+            from fewer taps.
+--------------------------------------------------------------------------------------------- */
+
+#ifndef fir_design_h_
+#define fir_design_h_
+#include "arm_math.h"
+//
+// ---
+// --- Blackman window value for tap n of a taps long filter
+static inline float32_t fir_window_blackman(int n, int taps) {
+  if (taps < 2) return 1.0f;
+  float32_t x = 2.0f * (float32_t)M_PI * n / (taps - 1);
+  return 0.42f - 0.5f*cosf(x) + 0.08f*cosf(2.0f*x);
+}
+// ---
+// --- Zeroth order modified Bessel function, power series (converges in ~20 terms for x < 10)
+static inline float32_t fir_bessel_i0(float32_t x) {
+  float32_t sum = 1.0f, term = 1.0f;
+  for (int k=1; k<32; k++) {
+    float32_t t = x / (2.0f * k);
+    term *= t * t;
+    sum  += term;
+    if (term < sum * 1e-9f) break;
+  }
+  return sum;
+}
+// ---
+// --- Kaiser window value for tap n of a taps long filter.  beta 6.0 gives about 63dB of stopband.
+static inline float32_t fir_window_kaiser(int n, int taps, float32_t beta) {
+  if (taps < 2) return 1.0f;
+  float32_t r = 2.0f * n / (taps - 1) - 1.0f;
+  return fir_bessel_i0(r*r < 1.0f ? beta * sqrtf(1.0f - r*r) : 0.0f) / fir_bessel_i0(beta);
+}
+// ---
+// --- Lowpass with -6dB point at cutoff_Hz, normalized to the requested DC gain.
+//     kaiser_beta 0 uses the Blackman window.
+static inline void fir_design_lowpass(float32_t *coeffs, uint16_t taps, float32_t cutoff_Hz,
+                                      float32_t sample_rate_Hz, float32_t gain, float32_t kaiser_beta = 0.0f) {
+  float32_t fc  = cutoff_Hz / sample_rate_Hz;        // normalized cutoff, cycles per sample
+  float32_t sum = 0.0f;
+  for (int n=0; n<taps; n++) {
+    float32_t m = n - (taps-1)/2.0f;
+    float32_t h = (m == 0.0f) ? 2.0f*fc : sinf(2.0f*(float32_t)M_PI*fc*m) / ((float32_t)M_PI*m);
+    coeffs[n] = h * (kaiser_beta > 0.0f ? fir_window_kaiser(n, taps, kaiser_beta) : fir_window_blackman(n, taps));
+    sum += coeffs[n];
+  }
+  for (int n=0; n<taps; n++) coeffs[n] *= gain / sum;
+}
+// ---
+// --- +45/-45 degree phasing pair passing low_Hz to high_Hz with unity gain.
+//     Built as the real part of a complex bandpass rotated by +/-45 degrees, which makes
+//     minus45 exactly plus45 reversed in time (same as the tables in Hilbert.h).
+static inline void fir_design_hilbert_pair(float32_t *plus45, float32_t *minus45, uint16_t taps,
+                                           float32_t low_Hz, float32_t high_Hz, float32_t sample_rate_Hz) {
+  float32_t w0 = 2.0f * (float32_t)M_PI * (low_Hz + high_Hz) * 0.5f / sample_rate_Hz;
+  fir_design_lowpass(plus45, taps, (high_Hz - low_Hz) * 0.5f, sample_rate_Hz, 1.0f);
+  for (int n=0; n<taps; n++) {
+    float32_t m  = n - (taps-1)/2.0f;
+    float32_t lp = plus45[n];
+    plus45[n]  = 2.0f * lp * cosf(w0*m + (float32_t)M_PI/4.0f);
+    minus45[n] = 2.0f * lp * cosf(w0*m - (float32_t)M_PI/4.0f);
+  }
+}
+#endif
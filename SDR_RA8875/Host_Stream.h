@@ -0,0 +1,301 @@
+//
+// Host_Stream.h
+//
+// Framed binary stream over the USB serial port for a remote panadapter, tools/sdr_stream_view.py reads it.  It
+// carries spectrum frames (the same 1 dB codes as Spectrum_Recorder.h), optionally the decimated IQ the demodulator
+// sees, and a once a second status frame.  The console text keeps working on the same port, the host skips anything
+// that is not a good frame.
+//
+// Nothing is sent until the host asks.  Every spectrum or IQ frame sent uses one credit and the host hands out
+// credits as it keeps up, so a slow or stalled host stops the stream instead of filling the USB buffers.  A frame
+// is also only written when the USB buffers have room for all of it.  Otherwise it is skipped and counted, the
+// sender never waits.  Frames are built in stream_frame[], nothing is allocated.  The IQ comes from Stream_IQ on
+// the RX_Decimate outputs, its ring drops whole blocks (counted) if the host falls behind.
+//
+// All values little endian.  CRC is CRC-16/CCITT (poly 0x1021, start 0xFFFF) over everything after the sync bytes.
+//
+//   Device frame:   u8 0xA5, u8 0x5A, u8 version, u8 type, u16 sequence, u16 payload bytes, payload, u16 CRC
+//                   The sequence counts every frame sent, a gap means frames were lost on the way.
+//   STREAM_FFT:     u32 ms, u32 VFO Hz, f32 bin Hz, f32 0 (was a zoom center offset), u16 bins, u16 frames skipped
+//                   since the last one sent, then one code per bin, lowest frequency first.  Code c is
+//                   SPEC_REC_MIN_DB + c dB.
+//   STREAM_IQ:      u32 IQ blocks dropped so far, f32 sample rate, u16 sample pairs, u16 0, then int16 I,Q pairs.
+//   STREAM_STATUS:  u32 ms, u32 VFO Hz, u8 streams, u8 credits, u16 FFT interval ms, u32 FFT frames sent,
+//                   u32 FFT frames skipped, u32 IQ frames sent, u32 IQ blocks dropped, u32 bad host frames.
+//
+//   Host frame:     u8 0xA5, u8 0x5A, u8 version, u8 command, u32 argument, u16 CRC.  10 bytes.
+//   STREAM_CMD_SET:      argument is the streams wanted, STREAM_FFT_ON | STREAM_IQ_ON | STREAM_STATUS_ON, 0 stops
+//   STREAM_CMD_INTERVAL: shortest time between spectrum frames in ms
+//   STREAM_CMD_CREDIT:   add argument credits, up to STREAM_MAX_CREDIT
+//
+
+#define STREAM_VERSION          1
+#define STREAM_SYNC0            0xA5
+#define STREAM_SYNC1            0x5A
+#define STREAM_HEADER           8           // bytes before the payload
+#define STREAM_MAX_PAYLOAD      (20 + SPEC_REC_BINS)
+#define STREAM_IQ_PAIRS         128         // sample pairs per IQ frame
+#define STREAM_IQ_RING          16384       // bytes, power of 2.  320ms of IQ at 12.8KHz
+#define STREAM_MAX_CREDIT       128
+#define STREAM_PERIOD           5           // task period in ms
+#define STREAM_IQ_PER_RUN       4           // most IQ frames sent by one task run
+#define STREAM_STATUS_MS        1000
+#define STREAM_HOST_FRAME       10
+
+enum Stream_Type {
+    STREAM_FFT                  = 1,
+    STREAM_IQ                   = 2,
+    STREAM_STATUS               = 3
+};
+enum Stream_Command {
+    STREAM_CMD_SET              = 1,
+    STREAM_CMD_INTERVAL         = 2,
+    STREAM_CMD_CREDIT           = 3
+};
+#define STREAM_FFT_ON           0x01        // STREAM_CMD_SET bits
+#define STREAM_IQ_ON            0x02
+#define STREAM_STATUS_ON        0x04
+
+static_assert(STREAM_IQ_PAIRS*4 + 12 <= STREAM_MAX_PAYLOAD, "IQ frame must fit stream_frame[]");
+
+extern AudioSDRrecordIQ_F32     Stream_IQ;
+extern float                    rx_sample_rate_Hz;
+extern volatile uint32_t        Freq;
+
+DMAMEM uint8_t stream_iq_ring[STREAM_IQ_RING] __attribute__ ((aligned (32)));
+uint8_t  stream_frame[STREAM_HEADER + STREAM_MAX_PAYLOAD + 2] __attribute__ ((aligned (4)));
+uint8_t  stream_rx[STREAM_HOST_FRAME];      // host frame being collected
+uint8_t  stream_rx_count        = 0;        // bytes of it so far, 0 = looking for sync
+uint8_t  stream_on              = 0;        // STREAM_*_ON bits the host asked for
+uint8_t  stream_credit          = 0;
+uint16_t stream_seq             = 0;
+uint16_t stream_fft_interval    = 100;      // ms
+uint32_t stream_fft_last_ms     = 0;
+uint32_t stream_status_last_ms  = 0;
+uint32_t stream_fft_sent        = 0;
+uint32_t stream_fft_skipped     = 0;
+uint16_t stream_fft_skip_run    = 0;        // skipped since the last spectrum frame went out
+uint32_t stream_iq_sent         = 0;
+uint32_t stream_bad_rx          = 0;        // host frames with a bad CRC or version
+
+//function declarations
+void     stream_init(void);
+bool     stream_rx_byte(char c);
+void     stream_fft_add(const float *pout);
+void     task_Stream(void);
+uint16_t stream_crc(const uint8_t *p, uint16_t n);
+void     printStreamStats(void);
+
+//
+// Give the IQ tap its ring.  Call once from setup().
+void stream_init(void)
+{
+    if (!Stream_IQ.begin(stream_iq_ring, sizeof(stream_iq_ring)))
+        Serial.println("Host Stream: bad IQ ring size");
+}
+//
+// CRC-16/CCITT, bit at a time.  A spectrum frame is about 550 bytes so a table is not worth the RAM.
+uint16_t stream_crc(const uint8_t *p, uint16_t n)
+{
+    uint16_t crc = 0xFFFF;
+
+    while (n--)
+    {
+        crc ^= (uint16_t) *p++ << 8;
+        for (uint8_t b = 0; b < 8; b++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+//
+// Payload area of stream_frame[]
+static inline uint8_t *stream_payload(void)
+{
+    return &stream_frame[STREAM_HEADER];
+}
+//
+// Finish the frame in stream_frame[] and send it if the USB buffers can take all of it.  Returns false if skipped.
+static bool stream_send(uint8_t type, uint16_t payload_bytes)
+{
+    uint16_t n = STREAM_HEADER + payload_bytes + 2;
+
+    if (Serial.availableForWrite() < (int) n)
+        return false;
+    stream_frame[0] = STREAM_SYNC0;
+    stream_frame[1] = STREAM_SYNC1;
+    stream_frame[2] = STREAM_VERSION;
+    stream_frame[3] = type;
+    memcpy(&stream_frame[4], &stream_seq, 2);
+    memcpy(&stream_frame[6], &payload_bytes, 2);
+    uint16_t crc = stream_crc(&stream_frame[2], STREAM_HEADER - 2 + payload_bytes);
+    memcpy(&stream_frame[STREAM_HEADER + payload_bytes], &crc, 2);
+    Serial.write(stream_frame, n);
+    stream_seq++;
+    return true;
+}
+//
+// Act on a good host frame
+static void stream_command(uint8_t cmd, uint32_t arg)
+{
+    switch (cmd)
+    {
+        case STREAM_CMD_SET:
+            stream_on = arg & (STREAM_FFT_ON | STREAM_IQ_ON | STREAM_STATUS_ON);
+            if ((stream_on & STREAM_IQ_ON) && !Stream_IQ.isRecording())
+                Stream_IQ.start();
+            else if (!(stream_on & STREAM_IQ_ON))
+                Stream_IQ.stop();
+            if (stream_on == 0)
+                stream_credit = 0;
+            break;
+        case STREAM_CMD_INTERVAL:
+            stream_fft_interval = constrain(arg, 10, 60000);
+            break;
+        case STREAM_CMD_CREDIT:
+            arg = min(arg, (uint32_t) STREAM_MAX_CREDIT);   // a large arg would wrap the sum
+            stream_credit = min(stream_credit + arg, (uint32_t) STREAM_MAX_CREDIT);
+            break;
+        default:
+            stream_bad_rx++;
+    }
+}
+//
+// Feed one byte from the serial port.  Returns true if it belongs to a host frame, otherwise it is for the console.
+// A sync byte is never a console command so nothing the console wants is lost.
+bool stream_rx_byte(char c)
+{
+    uint8_t b = (uint8_t) c;
+
+    if (stream_rx_count == 0 && b != STREAM_SYNC0)
+        return false;
+    if (stream_rx_count == 1 && b != STREAM_SYNC1)
+    {
+        stream_rx_count = 0;
+        return stream_rx_byte(c);           // may be the start of the real frame or a console byte
+    }
+    stream_rx[stream_rx_count++] = b;
+    if (stream_rx_count < STREAM_HOST_FRAME)
+        return true;
+
+    stream_rx_count = 0;
+    uint16_t crc;
+    uint32_t arg;
+    memcpy(&crc, &stream_rx[8], 2);
+    memcpy(&arg, &stream_rx[4], 4);
+    if (stream_rx[2] != STREAM_VERSION || crc != stream_crc(&stream_rx[2], 6))
+        stream_bad_rx++;
+    else
+        stream_command(stream_rx[3], arg);
+    return true;
+}
+//
+// Called by spectrum_update() with each frame's dB array in FFT bin order.  Sends it if it is time, the host has
+// given credit and USB has room.  Never waits.
+void stream_fft_add(const float *pout)
+{
+    if (!(stream_on & STREAM_FFT_ON))
+        return;
+    uint32_t now = millis();
+    if (now - stream_fft_last_ms < stream_fft_interval)
+        return;
+    stream_fft_last_ms = now;
+
+    if (stream_credit == 0)
+    {
+        stream_fft_skipped++;
+        stream_fft_skip_run++;
+        return;
+    }
+    uint8_t *p = stream_payload();
+    uint32_t f = Freq;
+    float    center = 0.0f;                 // the zoom is always centered on the VFO
+    uint16_t bins = SPEC_REC_BINS;
+    memcpy(&p[0],  &now, 4);
+    memcpy(&p[4],  &f, 4);
+    memcpy(&p[8],  &fft_bin_size, 4);
+    memcpy(&p[12], &center, 4);
+    memcpy(&p[16], &bins, 2);
+    memcpy(&p[18], &stream_fft_skip_run, 2);
+    spec_rec_quantize(pout, &p[20]);
+    if (stream_send(STREAM_FFT, 20 + SPEC_REC_BINS))
+    {
+        stream_credit--;
+        stream_fft_sent++;
+        stream_fft_skip_run = 0;
+    }
+    else
+    {
+        stream_fft_skipped++;
+        stream_fft_skip_run++;
+    }
+}
+//
+// Scheduler task.  Sends the IQ that has built up and the status frame.
+void task_Stream(void)
+{
+    if (stream_on == 0)
+        return;
+
+    for (uint8_t k = 0; k < STREAM_IQ_PER_RUN && (stream_on & STREAM_IQ_ON) && stream_credit > 0; k++)
+    {
+        uint32_t n;
+        const uint8_t *src = Stream_IQ.readPtr(&n);
+        if (n < STREAM_IQ_PAIRS*4)
+            break;                          // the ring is a multiple of a frame, so a short run means not enough yet
+        uint8_t *p = stream_payload();
+        uint32_t dropped = Stream_IQ.getDropped();
+        uint16_t pairs = STREAM_IQ_PAIRS, zero = 0;
+        memcpy(&p[0],  &dropped, 4);
+        memcpy(&p[4],  &rx_sample_rate_Hz, 4);
+        memcpy(&p[8],  &pairs, 2);
+        memcpy(&p[10], &zero, 2);
+        memcpy(&p[12], src, STREAM_IQ_PAIRS*4);
+        if (!stream_send(STREAM_IQ, 12 + STREAM_IQ_PAIRS*4))
+            break;                          // USB is full, the ring holds it until next time or drops blocks
+        Stream_IQ.consume(STREAM_IQ_PAIRS*4);
+        stream_credit--;
+        stream_iq_sent++;
+    }
+
+    uint32_t now = millis();
+    if ((stream_on & STREAM_STATUS_ON) && now - stream_status_last_ms >= STREAM_STATUS_MS)
+    {
+        uint8_t *p = stream_payload();
+        uint32_t f = Freq, iq_dropped = Stream_IQ.getDropped();
+        memcpy(&p[0],  &now, 4);
+        memcpy(&p[4],  &f, 4);
+        p[8] = stream_on;
+        p[9] = stream_credit;
+        memcpy(&p[10], &stream_fft_interval, 2);
+        memcpy(&p[12], &stream_fft_sent, 4);
+        memcpy(&p[16], &stream_fft_skipped, 4);
+        memcpy(&p[20], &stream_iq_sent, 4);
+        memcpy(&p[24], &iq_dropped, 4);
+        memcpy(&p[28], &stream_bad_rx, 4);
+        if (stream_send(STREAM_STATUS, 32))
+            stream_status_last_ms = now;    // if USB is full, try again next run
+    }
+}
+//
+// Stream report for the console 'C' command
+void printStreamStats(void)
+{
+    Serial.print("Host Stream: ");
+    if (stream_on == 0)
+    {
+        Serial.println("off");
+        return;
+    }
+    Serial.print("FFT Sent/Skipped: ");
+    Serial.print(stream_fft_sent);
+    Serial.print("/");
+    Serial.print(stream_fft_skipped);
+    Serial.print(", IQ Sent: ");
+    Serial.print(stream_iq_sent);
+    Serial.print(", IQ Dropped Blocks: ");
+    Serial.print(Stream_IQ.getDropped());
+    Serial.print(", Credits: ");
+    Serial.print(stream_credit);
+    Serial.print(", Bad Host Frames: ");
+    Serial.println(stream_bad_rx);
+}
@@ -0,0 +1,558 @@
+//
+// IQ_File.h
+//
+// Records the raw IQ from the I2S input to the SD card as a WAV file and plays it back into the receive chain.
+// Console 'I' starts and stops a recording, 'F' plays the newest recording in place of the live input.
+//
+// RX_IQ_Record sits on both Input channels and packs every audio block into iq_ring from the audio interrupt.
+// task_IQRec() runs from the scheduler and writes the ring out to IQnnnn.WAV in whole SPEC_REC_SECTOR multiples, at
+// most IQ_REC_CHUNK per run.  The WAV header is padded to exactly one sector so every data write lands sector
+// aligned.  The ring holds about 640ms at 51.2KHz, longer than the worst SD card write stalls.  If the card still
+// falls behind, whole blocks are dropped in the audio update and counted, it never waits on the card.
+//
+// The file is 16 bit stereo PCM, I on the left, at the capture rate, followed by a "ksdr" chunk with the radio
+// settings:  u32 version, u32 Freq Hz, i32 Fc offset Hz, f32 sample rate, char[8] mode, char[16] bandwidth,
+// u32 RTC start and stop (unix), u32 blocks recorded, u32 blocks dropped, then from version 2 the RX_PreProc I2S lag
+// correction in effect (i16, -1 0 or 1) and u8 1 if the lag check had finished, 0 if it was still looking.  The
+// recording is taken before RX_PreProc so the lag is in the file.  A JUNK chunk pads the header to 512 bytes.
+// The sizes, stop time and counts are filled in when the recording stops.  Data stops short of 4GB, blocks still in
+// the ring when that is reached are counted as dropped.  A file cut short by a power loss reads
+// with the data size left at 0, most tools then take the rest of the file as the data.
+//
+// Playback: RX_Play sits between Input and RX_PreProc and passes the live input through until it is told to play.
+// task_IQPlay() reads the file into whichever half of iq_ring RX_Play is not reading, IQ_PLAY_CHUNK per run, so
+// one half (320ms) is always read ahead.  The file is played raw, so it goes through the I2S lag fix, IQ balance,
+// the demodulator and the spectrum just like the live input.  The lag in the file is the one the recording session
+// had, so RX_PreProc gets the correction from the ksdr chunk for the playback and the live setting back after it.
+// A file without one (version 1 or another program's WAV), or recorded before the lag check finished, has the lag
+// check run on it instead.  It plays once, or round and round with iq_play_loop.  Recording and playback share
+// iq_ring so only one runs at a time.  Any 16 bit stereo WAV plays, the rest of the ksdr chunk is only printed.
+//
+
+#include "AudioSDRrecordIQ_F32.h"
+#include "AudioSDRplayIQ_F32.h"
+#include "AudioSDRpreProcessor_F32.h"
+
+#define IQ_REC_RING             131072      // bytes, power of 2.  640ms of 16 bit IQ at 51.2KHz
+#define IQ_REC_CHUNK            16384       // most written by one task run
+#define IQ_REC_PERIOD           10          // task period in ms, about 2KB comes in per run
+#define IQ_REC_HEADER           512         // WAV header bytes, one sector
+#define IQ_REC_MAX_DATA         ((0xFFFFFFFFu - IQ_REC_HEADER) & ~(SPEC_REC_SECTOR-1u))  // WAV and FAT32 size limit
+#define IQ_REC_VERSION          2
+#define IQ_PLAY_CHUNK           16384       // most read by one task run
+#define IQ_PLAY_PERIOD          10          // task period in ms
+
+struct __attribute__ ((packed)) IQ_Rec_Meta {
+    uint32_t version;
+    uint32_t freq_Hz;
+    int32_t  fc_Hz;
+    float    sample_rate_Hz;
+    char     mode[8];
+    char     bandwidth[16];
+    uint32_t start_unix;
+    uint32_t stop_unix;
+    uint32_t blocks;
+    uint32_t dropped;
+    int16_t  i2s_correction;                // version 2 on
+    uint8_t  i2s_found;
+    uint8_t  reserved;
+};
+struct __attribute__ ((packed)) IQ_Rec_Header {
+    char     riff[4];                       // "RIFF"
+    uint32_t riff_bytes;                    // file size - 8
+    char     wave[4];                       // "WAVE"
+    char     fmt[4];                        // "fmt "
+    uint32_t fmt_bytes;                     // 16
+    uint16_t format;                        // 1, PCM
+    uint16_t channels;                      // 2, I and Q
+    uint32_t sample_rate;
+    uint32_t byte_rate;
+    uint16_t block_align;
+    uint16_t bits;
+    char     meta_id[4];                    // "ksdr"
+    uint32_t meta_bytes;
+    struct IQ_Rec_Meta meta;
+    char     junk[4];                       // "JUNK", pads the header to one sector
+    uint32_t junk_bytes;
+    uint8_t  pad[IQ_REC_HEADER - 12 - 24 - 8 - sizeof(struct IQ_Rec_Meta) - 8 - 8];
+    char     data[4];                       // "data"
+    uint32_t data_bytes;
+};
+static_assert(sizeof(struct IQ_Rec_Header) == IQ_REC_HEADER, "WAV header must be one sector");
+
+extern AudioSDRrecordIQ_F32     RX_IQ_Record;
+extern AudioSDRplayIQ_F32       RX_Play;
+extern AudioSDRpreProcessor_F32 RX_PreProc;
+extern volatile uint32_t        Freq;
+extern volatile uint32_t        Fc;
+extern float                    sample_rate_Hz;
+extern String                   mode;
+extern String                   bandwidth;
+
+DMAMEM uint8_t iq_ring[IQ_REC_RING] __attribute__ ((aligned (32)));    // recording ring or the two playback halves
+struct IQ_Rec_Header iq_rec_header;
+File     iq_rec_file;
+char     iq_rec_name[16];                   // WAV file name being written
+bool     iq_rec_on              = false;
+uint32_t iq_rec_data_bytes      = 0;        // bytes of IQ on the card
+uint32_t iq_rec_errors          = 0;        // short card writes
+uint32_t iq_rec_write_max_us    = 0;        // slowest card write since the last stats print
+File     iq_play_file;
+char     iq_play_name[16];                  // WAV file being played
+bool     iq_play_on             = false;
+bool     iq_play_loop           = false;    // start over at the end of the file
+uint32_t iq_play_data_start     = 0;        // file offset of the IQ data
+uint32_t iq_play_data_bytes     = 0;
+uint32_t iq_play_left           = 0;        // data bytes not yet read this time through
+int8_t   iq_play_half           = -1;       // RX_Play half being filled, -1 = none
+uint8_t *iq_play_buf            = NULL;
+uint32_t iq_play_size           = 0;        // bytes in the half
+uint32_t iq_play_fill           = 0;        // bytes read into the half so far
+uint32_t iq_play_read_max_us    = 0;        // slowest card read since the last stats print
+int16_t  iq_play_i2s            = 0;        // I2S lag correction the file needs
+bool     iq_play_i2s_found      = false;    // false = not known, run the lag check on the file
+int16_t  iq_play_live_i2s       = 0;        // live RX_PreProc setting, put back when the playback stops
+bool     iq_play_live_auto      = false;
+
+//function declarations
+void iq_file_init(void);
+void iq_rec_start(void);
+void iq_rec_stop(void);
+void iq_rec_toggle(void);
+void task_IQRec(void);
+void printIQRecStats(void);
+bool iq_play_open(void);
+void iq_play_start(void);
+void iq_play_stop(void);
+void iq_play_toggle(void);
+void task_IQPlay(void);
+void printIQPlayStats(void);
+
+//
+// Give the recorder and the player the ring.  Call once from setup().
+void iq_file_init(void)
+{
+    if (!RX_IQ_Record.begin(iq_ring, sizeof(iq_ring)) || !RX_Play.begin(iq_ring, sizeof(iq_ring)))
+        Serial.println("IQ File: bad ring size");
+}
+//
+// Fill in the header from the current radio settings
+static void iq_rec_header_fill(void)
+{
+    struct IQ_Rec_Header *h = &iq_rec_header;
+
+    memset(h, 0, sizeof(*h));
+    memcpy(h->riff, "RIFF", 4);
+    memcpy(h->wave, "WAVE", 4);
+    memcpy(h->fmt,  "fmt ", 4);
+    h->fmt_bytes        = 16;
+    h->format           = 1;
+    h->channels         = 2;
+    h->sample_rate      = (uint32_t) sample_rate_Hz;
+    h->block_align      = 4;
+    h->byte_rate        = h->sample_rate * h->block_align;
+    h->bits             = 16;
+    memcpy(h->meta_id, "ksdr", 4);
+    h->meta_bytes       = sizeof(h->meta);
+    h->meta.version     = IQ_REC_VERSION;
+    h->meta.freq_Hz     = Freq;
+    h->meta.fc_Hz       = (int32_t) Fc;
+    h->meta.sample_rate_Hz = sample_rate_Hz;
+    strncpy(h->meta.mode, mode.c_str(), sizeof(h->meta.mode));
+    strncpy(h->meta.bandwidth, bandwidth.c_str(), sizeof(h->meta.bandwidth));
+    h->meta.start_unix  = Teensy3Clock.get();
+    h->meta.i2s_correction = RX_PreProc.getI2SerrorCompensation();
+    h->meta.i2s_found   = !RX_PreProc.getAutoI2SerrorDetectionStatus();
+    memcpy(h->junk, "JUNK", 4);
+    h->junk_bytes       = sizeof(h->pad);
+    memcpy(h->data, "data", 4);
+    h->riff_bytes       = sizeof(*h) - 8;   // sizes are fixed up by iq_rec_stop()
+}
+//
+// Open the next free IQnnnn.WAV and start taking blocks
+void iq_rec_start(void)
+{
+    uint16_t n;
+
+    if (iq_play_on)
+    {
+        Serial.println("IQ Recorder: stop the playback first");
+        return;
+    }
+    if (!sd_card_ready())
+    {
+        Serial.println("IQ Recorder: no SD card");
+        return;
+    }
+    for (n = 0; n < 10000; n++)
+    {
+        snprintf(iq_rec_name, sizeof(iq_rec_name), "IQ%04u.WAV", n);
+        if (!SD.exists(iq_rec_name))
+            break;
+    }
+    if (n == 10000 || !(iq_rec_file = SD.open(iq_rec_name, FILE_WRITE)))
+    {
+        Serial.println("IQ Recorder: can not create a file");
+        return;
+    }
+    iq_rec_header_fill();
+    if (iq_rec_file.write((const uint8_t *) &iq_rec_header, sizeof(iq_rec_header)) != sizeof(iq_rec_header))
+    {
+        iq_rec_file.close();
+        Serial.println("IQ Recorder: SD card write failed");
+        return;
+    }
+    iq_rec_data_bytes = iq_rec_errors = 0;
+    iq_rec_on = true;
+    RX_IQ_Record.start();
+    Serial.print("IQ Recorder: recording to ");
+    Serial.println(iq_rec_name);
+}
+//
+// Write what is left, fix up the header and close the file
+void iq_rec_stop(void)
+{
+    if (!iq_rec_on)
+        return;
+    RX_IQ_Record.stop();
+    iq_rec_on = false;
+    uint32_t lost = 0;                      // bytes past IQ_REC_MAX_DATA, whole blocks
+    while (RX_IQ_Record.available() > 0)
+    {
+        uint32_t n;
+        const uint8_t *p = RX_IQ_Record.readPtr(&n);
+        uint32_t w = min(n, IQ_REC_MAX_DATA - iq_rec_data_bytes);
+        size_t done = iq_rec_file.write(p, w);
+        if (done != w)
+            iq_rec_errors++;
+        iq_rec_data_bytes += done;
+        lost += n - w;
+        RX_IQ_Record.consume(n);
+    }
+
+    struct IQ_Rec_Header *h = &iq_rec_header;
+    h->data_bytes       = iq_rec_data_bytes;
+    h->riff_bytes       = sizeof(*h) - 8 + iq_rec_data_bytes;
+    h->meta.stop_unix   = Teensy3Clock.get();
+    h->meta.blocks      = RX_IQ_Record.getBlocks() - lost / (4 * AUDIO_BLOCK_SAMPLES);
+    h->meta.dropped     = RX_IQ_Record.getDropped() + lost / (4 * AUDIO_BLOCK_SAMPLES);
+    if (!iq_rec_file.seek(0) || iq_rec_file.write((const uint8_t *) h, sizeof(*h)) != sizeof(*h))
+        iq_rec_errors++;
+    iq_rec_file.close();
+
+    Serial.print("IQ Recorder: stopped, ");
+    Serial.print(iq_rec_data_bytes / 4 / sample_rate_Hz, 1);
+    Serial.print(" seconds, ");
+    Serial.print(h->meta.dropped);
+    Serial.print(" blocks dropped, in ");
+    Serial.println(iq_rec_name);
+}
+//
+void iq_rec_toggle(void)
+{
+    if (iq_rec_on)
+        iq_rec_stop();
+    else
+        iq_rec_start();
+}
+//
+// Scheduler task.  Writes whole sectors from the ring, up to where it wraps or IQ_REC_CHUNK.
+void task_IQRec(void)
+{
+    if (!iq_rec_on)
+        return;
+
+    uint32_t n;
+    const uint8_t *p = RX_IQ_Record.readPtr(&n);
+    n = min(min(n, (uint32_t) IQ_REC_CHUNK), IQ_REC_MAX_DATA - iq_rec_data_bytes);
+    n -= n % SPEC_REC_SECTOR;
+    if (n == 0)
+        return;
+
+    uint32_t start = micros();
+    size_t done = iq_rec_file.write(p, n);
+    uint32_t us = micros() - start;
+    if (us > iq_rec_write_max_us)
+        iq_rec_write_max_us = us;
+    if (done != n)
+        iq_rec_errors++;                    // not retried, the stats show it
+    iq_rec_data_bytes += done;
+    RX_IQ_Record.consume(n);
+
+    if (IQ_REC_MAX_DATA - iq_rec_data_bytes < SPEC_REC_SECTOR)
+    {
+        Serial.println("IQ Recorder: file is full");
+        iq_rec_stop();
+    }
+}
+//
+// Recorder report for the console 'C' command
+void printIQRecStats(void)
+{
+    Serial.print("IQ Recorder: ");
+    if (!iq_rec_on)
+    {
+        Serial.println("off");
+        return;
+    }
+    Serial.print(iq_rec_name);
+    Serial.print(", Seconds: ");
+    Serial.print(iq_rec_data_bytes / 4 / sample_rate_Hz, 1);
+    Serial.print(", Blocks: ");
+    Serial.print(RX_IQ_Record.getBlocks());
+    Serial.print(", Dropped: ");
+    Serial.print(RX_IQ_Record.getDropped());
+    Serial.print(", Queued: ");
+    Serial.print(RX_IQ_Record.available());
+    Serial.print(", Max Queued: ");
+    Serial.print(RX_IQ_Record.getMaxFill());
+    Serial.print(" of ");
+    Serial.print(RX_IQ_Record.getSize());
+    Serial.print(", Errors: ");
+    Serial.print(iq_rec_errors);
+    Serial.print(", Max Write Time (uS): ");
+    Serial.println(iq_rec_write_max_us);
+    iq_rec_write_max_us = 0;
+}
+//
+// Open the newest IQnnnn.WAV and find its data.  Prints the ksdr settings if it has them.
+bool iq_play_open(void)
+{
+    struct IQ_Rec_Meta meta;
+    char     id[4];
+    uint32_t size;
+    bool     fmt_ok = false, have_meta = false;
+    uint16_t n;
+
+    if (!sd_card_ready())
+    {
+        Serial.println("IQ Player: no SD card");
+        return false;
+    }
+    for (n = 0; n < 10000; n++)             // the recorder numbers files from 0 with no gaps
+    {
+        snprintf(iq_play_name, sizeof(iq_play_name), "IQ%04u.WAV", n);
+        if (!SD.exists(iq_play_name))
+            break;
+    }
+    if (n == 0)
+    {
+        Serial.println("IQ Player: no recordings");
+        return false;
+    }
+    snprintf(iq_play_name, sizeof(iq_play_name), "IQ%04u.WAV", n-1);
+    if (!(iq_play_file = SD.open(iq_play_name, FILE_READ)))
+    {
+        Serial.println("IQ Player: can not open the file");
+        return false;
+    }
+
+    // RIFF header, then walk the chunks to the data
+    iq_play_data_start = iq_play_data_bytes = 0;
+    iq_play_i2s_found = false;
+    if (iq_play_file.read(id, 4) != 4 || memcmp(id, "RIFF", 4) != 0 || iq_play_file.read(&size, 4) != 4 ||
+        iq_play_file.read(id, 4) != 4 || memcmp(id, "WAVE", 4) != 0)
+    {
+        iq_play_file.close();
+        Serial.println("IQ Player: not a WAV file");
+        return false;
+    }
+    while (iq_play_file.read(id, 4) == 4 && iq_play_file.read(&size, 4) == 4)
+    {
+        uint32_t next = iq_play_file.position() + size + (size & 1);
+        if (memcmp(id, "fmt ", 4) == 0)
+        {
+            struct {uint16_t format, channels; uint32_t sample_rate, byte_rate; uint16_t block_align, bits;} f;
+            if (size >= sizeof(f) && iq_play_file.read(&f, sizeof(f)) == sizeof(f))
+            {
+                fmt_ok = f.format == 1 && f.channels == 2 && f.bits == 16;
+                if (f.sample_rate != (uint32_t) sample_rate_Hz)
+                {
+                    Serial.print("IQ Player: recorded at ");
+                    Serial.print(f.sample_rate);
+                    Serial.println("Hz, plays at the capture rate");
+                }
+            }
+        }
+        else if (memcmp(id, "ksdr", 4) == 0)
+        {
+            memset(&meta, 0, sizeof(meta));
+            have_meta = iq_play_file.read(&meta, min(size, sizeof(meta))) > 0;
+            if (have_meta && meta.version >= 2 && meta.i2s_found)
+            {
+                iq_play_i2s = meta.i2s_correction;
+                iq_play_i2s_found = true;
+            }
+        }
+        else if (memcmp(id, "data", 4) == 0)
+        {
+            iq_play_data_start = iq_play_file.position();
+            iq_play_data_bytes = (size > 0) ? size : iq_play_file.size() - iq_play_data_start;   // 0 = cut short
+            break;
+        }
+        if (!iq_play_file.seek(next))
+            break;
+    }
+    if (!fmt_ok || iq_play_data_start == 0 || iq_play_data_bytes < 4)
+    {
+        iq_play_file.close();
+        Serial.println("IQ Player: needs 16 bit stereo PCM");
+        return false;
+    }
+    iq_play_file.seek(iq_play_data_start);
+
+    Serial.print("IQ Player: ");
+    Serial.print(iq_play_name);
+    Serial.print(", ");
+    Serial.print(iq_play_data_bytes / 4 / sample_rate_Hz, 1);
+    Serial.print(" seconds");
+    if (have_meta)
+    {
+        meta.mode[sizeof(meta.mode)-1] = 0;
+        meta.bandwidth[sizeof(meta.bandwidth)-1] = 0;
+        Serial.print(", recorded at ");
+        Serial.print(meta.freq_Hz);
+        Serial.print("Hz Fc ");
+        Serial.print(meta.fc_Hz);
+        Serial.print(" ");
+        Serial.print(meta.mode);
+        Serial.print(" ");
+        Serial.print(meta.bandwidth);
+        Serial.print(", ");
+        Serial.print(meta.dropped);
+        Serial.print(" blocks dropped");
+    }
+    Serial.print(", I2S lag fix ");
+    if (iq_play_i2s_found)
+        Serial.println(iq_play_i2s);
+    else
+        Serial.println("not recorded, checking");
+    return true;
+}
+//
+// Read the next piece of the file into the half being filled.  Hands the half over once it is full or the
+// file has run out.  Returns false when there was nothing to do.
+static bool iq_play_fill_step(void)
+{
+    if (iq_play_half < 0)
+    {
+        if (iq_play_left == 0)
+            return false;                   // the last half has gone, nothing more to read
+        iq_play_half = RX_Play.emptyHalf(&iq_play_buf, &iq_play_size);
+        iq_play_fill = 0;
+        if (iq_play_half < 0)
+            return false;                   // both halves are full
+    }
+
+    uint32_t n = min(min((uint32_t) IQ_PLAY_CHUNK, iq_play_size - iq_play_fill), iq_play_left);
+    uint32_t start = micros();
+    int got = iq_play_file.read(iq_play_buf + iq_play_fill, n);
+    uint32_t us = micros() - start;
+    if (us > iq_play_read_max_us)
+        iq_play_read_max_us = us;
+    if (got <= 0)
+        iq_play_left = 0;                   // read error, end the playback here
+    else
+    {
+        iq_play_fill += got;
+        iq_play_left -= got;
+    }
+    if (iq_play_left == 0 && iq_play_loop)
+    {
+        iq_play_file.seek(iq_play_data_start);
+        iq_play_left = iq_play_data_bytes;
+    }
+    if (iq_play_fill == iq_play_size || iq_play_left == 0)
+    {
+        RX_Play.halfFilled(iq_play_half, iq_play_fill, iq_play_left == 0);
+        iq_play_half = -1;
+    }
+    return true;
+}
+//
+// Play the newest recording in place of the live input.  Fills the first half before starting.
+void iq_play_start(void)
+{
+    if (iq_rec_on)
+    {
+        Serial.println("IQ Player: stop the recording first");
+        return;
+    }
+    if (!iq_play_open())
+        return;
+    RX_Play.stop();
+    iq_play_left = iq_play_data_bytes;
+    iq_play_half = -1;
+    iq_play_read_max_us = 0;
+    while (iq_play_fill_step() && iq_play_half >= 0)
+        ;                                   // first half, the task reads the rest as it goes
+    iq_play_live_i2s  = RX_PreProc.getI2SerrorCompensation();
+    iq_play_live_auto = RX_PreProc.getAutoI2SerrorDetectionStatus();
+    if (iq_play_i2s_found)
+        RX_PreProc.setI2SerrorCompensation(iq_play_i2s);
+    else
+        RX_PreProc.startAutoI2SerrorDetection();
+    RX_Play.play();
+    iq_play_on = true;
+}
+//
+// Back to the live input
+void iq_play_stop(void)
+{
+    if (!iq_play_on)
+        return;
+    RX_Play.stop();
+    if (iq_play_live_auto)
+        RX_PreProc.startAutoI2SerrorDetection();
+    else
+        RX_PreProc.setI2SerrorCompensation(iq_play_live_i2s);
+    iq_play_file.close();
+    iq_play_on = false;
+    Serial.print("IQ Player: stopped after ");
+    Serial.print(RX_Play.getFrames() / sample_rate_Hz, 1);
+    Serial.print(" seconds, ");
+    Serial.print(RX_Play.getUnderruns());
+    Serial.println(" underruns, live input");
+}
+//
+void iq_play_toggle(void)
+{
+    if (iq_play_on)
+        iq_play_stop();
+    else
+        iq_play_start();
+}
+//
+// Scheduler task.  Keeps the half RX_Play is not reading filled and notices the end of the file.
+void task_IQPlay(void)
+{
+    if (!iq_play_on)
+        return;
+    if (!RX_Play.isPlaying())
+    {
+        iq_play_stop();                     // played to the end
+        return;
+    }
+    iq_play_fill_step();
+}
+//
+// Player report for the console 'C' command
+void printIQPlayStats(void)
+{
+    Serial.print("IQ Player: ");
+    if (!iq_play_on)
+    {
+        Serial.println("off, live input");
+        return;
+    }
+    Serial.print(iq_play_name);
+    Serial.print(", Seconds: ");
+    Serial.print(RX_Play.getFrames() / sample_rate_Hz, 1);
+    Serial.print(", Underruns: ");
+    Serial.print(RX_Play.getUnderruns());
+    Serial.print(", Loop: ");
+    Serial.print(iq_play_loop ? "ON" : "OFF");
+    Serial.print(", Max Read Time (uS): ");
+    Serial.println(iq_play_read_max_us);
+    iq_play_read_max_us = 0;
+}
@@ -1,8 +1,9 @@
 #include <Audio.h> 
-extern AudioMixer4_F32  RX_Summer; 
+extern AudioFilterIQPhasing_F32 RX_Hilbert;
 extern AudioMixer4_F32  FFT_Switch1;
 extern AudioMixer4_F32  FFT_Switch2;
 extern int mndx;
+extern int16_t FFT_Source;
 extern String mode;
 
 void selectMode()
@@ -14,13 +15,13 @@ void selectMode()
             Serial.println("Lets set the mode to CW");
             mode="CW";
             AudioNoInterrupts();
-              RX_Summer.gain(0,1);
-              RX_Summer.gain(1,-1);
+              RX_Hilbert.setSideband(IQ_PHASING_LSB);
               FFT_Switch1.gain(0,0.0f);  // 0  for Filtered FFT,  1 for Unfiltered FFT
               FFT_Switch1.gain(1,1.0f);  // 1  for Filtered FFT,  0 for Unfiltered FFT
               FFT_Switch2.gain(0,0.0f);  // 0  for Filtered FFT,  1 for Unfiltered FFT
               FFT_Switch2.gain(1,1.0f);  // 1  for Filtered FFT,  0 for Unfiltered FFT
             AudioInterrupts();
+            FFT_Source = 1;     // spectrum shows the filtered audio
   }
       
   if(mndx==1)
@@ -28,13 +29,13 @@ void selectMode()
             Serial.println("Lets set the mode to LSB");
             mode="LSB";
             AudioNoInterrupts();
-              RX_Summer.gain(0,1);
-              RX_Summer.gain(1,-1);
+              RX_Hilbert.setSideband(IQ_PHASING_LSB);
               FFT_Switch1.gain(0,1.0f);   // 1  for Filtered FFT,  1 for Unfiltered FFT
               FFT_Switch1.gain(1,0.0f);   // 1  for Filtered FFT,  0 for Unfiltered FFT          
               FFT_Switch2.gain(0,1.0f);   // 1  for Filtered FFT,  1 for Unfiltered FFT
               FFT_Switch2.gain(1,0.0f);   // 1  for Filtered FFT,  0 for Unfiltered FFT       
             AudioInterrupts(); 
+            FFT_Source = 0;     // spectrum shows the IQ input
   }
 
   if(mndx==2)
@@ -42,13 +43,13 @@ void selectMode()
             Serial.println("Lets set the mode to USB");
             mode="USB";          
             AudioNoInterrupts();
-              RX_Summer.gain(0,1);
-              RX_Summer.gain(1,1);
+              RX_Hilbert.setSideband(IQ_PHASING_USB);
               FFT_Switch1.gain(0,1.0f);   // 0  for Filtered FFT,  1 for Unfiltered FFT
               FFT_Switch1.gain(1,0.0f);   // 1  for Filtered FFT,  0 for Unfiltered FFT
               FFT_Switch2.gain(0,1.0f);   // 0  for Filtered FFT,  1 for Unfiltered FFT
               FFT_Switch2.gain(1,0.0f);   // 1  for Filtered FFT,  0 for Unfiltered FFT
             AudioInterrupts();
+            FFT_Source = 0;     // spectrum shows the IQ input
   }
 
   if(mndx==3)
@@ -56,13 +57,13 @@ void selectMode()
             Serial.println("Lets set the mode to DATA at 4KHz BW");
             mode="DATA";          
             AudioNoInterrupts();
-              RX_Summer.gain(0,1);
-              RX_Summer.gain(1,1);
+              RX_Hilbert.setSideband(IQ_PHASING_USB);
               FFT_Switch1.gain(0,1.0f);   // 0  for Filtered FFT,  1 for Unfiltered FFT
               FFT_Switch1.gain(1,0.0f);   // 1  for Filtered FFT,  0 for Unfiltered FFT
               FFT_Switch2.gain(0,1.0f);   // 0  for Filtered FFT,  1 for Unfiltered FFT
               FFT_Switch2.gain(1,0.0f);   // 1  for Filtered FFT,  0 for Unfiltered FFT
             AudioInterrupts();
+            FFT_Source = 0;     // spectrum shows the IQ input
   }
   
   displayMode();
@@ -0,0 +1,196 @@
+//
+// NoiseFloor.h
+//
+// Noise floor estimate from a histogram of the spectrum levels.  spectrum_update() adds each graph column's dB
+// value with nf_hist_add() as it goes, then nf_hist_percentile() reads any percentile out of the histogram.  That
+// is one pass over the bins plus one pass over the buckets per frame, no sorting.  The floor is a low percentile
+// (most of the spectrum is noise) and the top of the signals is a high one.
+//
+// Each band keeps its own floor and signal top.  An estimate moves the tracked value only once it is more than
+// NF_HYST_DB away, then the tracked value glides toward it.  With nf_auto on, the spectrum reference level
+// (spect_floor) and scale (spect_sp_scale) are set from the tracked values so the floor sits just above the bottom
+// of the spectrum box.  A manual reference level swipe turns nf_auto off, console 'N' turns it back on.  The scale
+// sets the grid and every change of it clears and redraws the spectrum box, so nf_scale() keeps it on whole grid
+// steps and only moves it when the signal top has been well away from it for a number of frames.
+//
+// nf_percentile() works on any dB array and nf_floor_dB() returns the current band's floor, for use by the S meter
+// and squelch.
+//
+
+#define NF_MIN_DB               -200.0f     // histogram range
+#define NF_MAX_DB               20.0f
+#define NF_BUCKET_DB            0.5f        // histogram resolution
+#define NF_BUCKETS              ((int16_t) ((NF_MAX_DB - NF_MIN_DB) / NF_BUCKET_DB))
+#define NF_FLOOR_PCT            20.0f       // percent of the bins at or below the noise floor
+#define NF_TOP_PCT              99.5f       // percent of the bins at or below the top of the signals
+#define NF_HYST_DB              3.0f        // estimate must move this far before the tracked value follows
+#define NF_RATE                 0.2f        // fraction of the remaining distance the tracked value moves per frame
+#define NF_SCALE_STEP_DB        10          // auto scale is a multiple of this
+#define NF_SCALE_HYST           0.7f        // steps the wanted scale must be off by, over half so a value sitting
+                                            // on the midpoint between two steps does not flip back and forth
+#define NF_SCALE_FRAMES         8           // frames in a row it must stay that far off before the scale moves
+#define NF_FLOOR_MARGIN         10          // percent of the spectrum box height left below the noise floor
+#define NF_GENERAL              BANDS       // nf_band[] slot for frequencies outside the ham bands
+
+struct NF_Track {
+    float   floor_dB;                       // tracked noise floor
+    float   floor_target;                   // value floor_dB is moving toward
+    float   top_dB;                         // tracked top of the signals
+    float   top_target;
+    bool    valid;                          // false until the first estimate on this band
+};
+
+uint16_t nf_hist[NF_BUCKETS];               // current frame's level histogram
+uint16_t nf_hist_count          = 0;        // values in nf_hist[]
+struct NF_Track nf_band[BANDS+1];           // per band state, last slot for outside the bands
+int8_t   nf_band_now            = NF_GENERAL;
+bool     nf_auto                = true;     // set spect_floor and spect_sp_scale from the tracked values
+float    nf_estimate_dB         = NF_MIN_DB;    // last raw floor estimate, for the stats print
+uint8_t  nf_scale_frames        = 0;        // frames in a row the wanted scale has been NF_SCALE_HYST steps off
+uint32_t nf_scale_changes       = 0;        // auto scale changes, each one redraws the spectrum grid
+
+//function declarations
+void  nf_hist_clear(void);
+static inline void nf_hist_add(float dB);
+float nf_hist_percentile(float pct);
+float nf_percentile(const float *dB, int16_t n, float pct);
+int8_t nf_band_index(uint32_t freq);
+void  nf_update(uint32_t freq);
+float nf_floor_dB(void);
+int16_t nf_scale(int16_t scale, float want, int16_t lo, int16_t hi);
+void  nf_auto_set(bool on);
+void  printNoiseFloorStats(void);
+
+//
+void nf_hist_clear(void)
+{
+    memset(nf_hist, 0, sizeof(nf_hist));
+    nf_hist_count = 0;
+}
+//
+// Add one level.  Values outside the histogram range (the -500 used for columns with no bin) are left out.
+static inline void nf_hist_add(float dB)
+{
+    if (dB < NF_MIN_DB || dB >= NF_MAX_DB)
+        return;
+    nf_hist[(int16_t) ((dB - NF_MIN_DB) * (1.0f/NF_BUCKET_DB))]++;
+    nf_hist_count++;
+}
+//
+// Level that pct percent of the values are at or below.  Interpolates inside the bucket it lands in.
+float nf_hist_percentile(float pct)
+{
+    if (nf_hist_count == 0)
+        return NF_MIN_DB;
+
+    float    want = pct / 100.0f * nf_hist_count;
+    uint32_t sum = 0;
+    int16_t  b;
+
+    for (b = 0; b < NF_BUCKETS-1; b++)
+    {
+        if (sum + nf_hist[b] >= want)
+            break;
+        sum += nf_hist[b];
+    }
+    float frac = (nf_hist[b] > 0) ? (want - sum) / nf_hist[b] : 0.0f;
+    return NF_MIN_DB + (b + constrain(frac, 0.0f, 1.0f)) * NF_BUCKET_DB;
+}
+//
+// Percentile of any dB array.  Uses (and clears) the shared histogram.
+float nf_percentile(const float *dB, int16_t n, float pct)
+{
+    nf_hist_clear();
+    for (int16_t i = 0; i < n; i++)
+        nf_hist_add(dB[i]);
+    return nf_hist_percentile(pct);
+}
+//
+// bandmem[] slot for a dial frequency in Hz, NF_GENERAL if not in a ham band
+int8_t nf_band_index(uint32_t freq)
+{
+    float kHz = freq / 1000.0f;
+
+    for (int8_t i = 0; i < BANDS; i++)
+        if (kHz >= bandmem[i].edge_lower && kHz <= bandmem[i].edge_upper)
+            return i;
+    return NF_GENERAL;
+}
+//
+// Move one tracked value toward a new estimate, with hysteresis
+static void nf_follow(float *value, float *target, float estimate, bool first)
+{
+    if (first)
+        *value = *target = estimate;
+    else if (fabsf(estimate - *target) > NF_HYST_DB)
+        *target = estimate;
+    *value += NF_RATE * (*target - *value);
+}
+//
+// Called once per spectrum frame after the histogram is filled.  Updates the tracked floor and top for the band freq is in.
+void nf_update(uint32_t freq)
+{
+    if (nf_hist_count == 0)
+        return;
+
+    struct NF_Track *t = &nf_band[nf_band_now = nf_band_index(freq)];
+    nf_estimate_dB = nf_hist_percentile(NF_FLOOR_PCT);
+    float top = nf_hist_percentile(NF_TOP_PCT);
+
+    nf_follow(&t->floor_dB, &t->floor_target, nf_estimate_dB, !t->valid);
+    nf_follow(&t->top_dB,   &t->top_target,   top,            !t->valid);
+    t->valid = true;
+}
+//
+// Tracked noise floor in dB for the current band
+float nf_floor_dB(void)
+{
+    struct NF_Track *t = &nf_band[nf_band_now];
+    return t->valid ? t->floor_dB : NF_MIN_DB;
+}
+//
+// Auto spectrum scale.  scale is the one in use, want the one the tracked floor and top call for.  Returns scale
+// unchanged until want has been more than NF_SCALE_HYST grid steps away for NF_SCALE_FRAMES frames running, then
+// want rounded to a whole step.  A scale off the step grid (a preset or manual value) is snapped to it right away.
+int16_t nf_scale(int16_t scale, float want, int16_t lo, int16_t hi)
+{
+    int16_t q = constrain((int16_t) (roundf(want / NF_SCALE_STEP_DB) * NF_SCALE_STEP_DB), lo, hi);
+
+    if (scale % NF_SCALE_STEP_DB != 0 || scale < lo || scale > hi)
+        nf_scale_frames = NF_SCALE_FRAMES;
+    else if (q != scale && fabsf(want - scale) > NF_SCALE_HYST * NF_SCALE_STEP_DB)
+        nf_scale_frames++;
+    else
+        nf_scale_frames = 0;
+
+    if (nf_scale_frames < NF_SCALE_FRAMES)
+        return scale;
+    nf_scale_frames = 0;
+    if (q != scale)
+        nf_scale_changes++;
+    return q;
+}
+//
+void nf_auto_set(bool on)
+{
+    nf_auto = on;
+    Serial.print("Auto Noise Floor = ");
+    Serial.println(nf_auto ? "ON" : "OFF");
+}
+//
+// Noise floor report for the console 'C' command
+void printNoiseFloorStats(void)
+{
+    Serial.print("Noise Floor (dB): ");
+    Serial.print(nf_floor_dB(), 1);
+    Serial.print(", Estimate: ");
+    Serial.print(nf_estimate_dB, 1);
+    Serial.print(", Signal Top: ");
+    Serial.print(nf_band[nf_band_now].top_dB, 1);
+    Serial.print(", Scale Changes: ");
+    Serial.print(nf_scale_changes);
+    Serial.print(", Band Slot: ");
+    Serial.print(nf_band_now);
+    Serial.print(", Auto: ");
+    Serial.println(nf_auto ? "ON" : "OFF");
+}
@@ -4,6 +4,14 @@
 extern RA8875 tft;
 extern AudioAnalyzePeak_F32         Q_Peak;          
 extern AudioAnalyzePeak_F32         I_Peak;         
+extern AudioSDRiqBalance_F32        IQ_Balance;
+extern AudioSDRpreProcessor_F32     RX_PreProc;
+
+//function declarations
+void Quad_Check();
+void iq_balance_toggle(void);
+void printIQBalanceStats(void);
+void printPreProcStats(void);
 
 void Quad_Check()
 {
@@ -43,3 +51,37 @@ void Quad_Check()
  }
 
 }
+//
+// Turn the IQ balance correction on or off.  Turning it on starts the learning over.
+void iq_balance_toggle(void)
+{
+    if (!IQ_Balance.isEnabled())
+        IQ_Balance.reset();
+    IQ_Balance.enable(!IQ_Balance.isEnabled());
+    Serial.print("IQ Balance = ");
+    Serial.println(IQ_Balance.isEnabled() ? "ON" : "OFF");
+}
+//
+// IQ balance report for the console 'C' command
+void printIQBalanceStats(void)
+{
+    Serial.print("IQ Balance: ");
+    Serial.print(IQ_Balance.isEnabled() ? "ON" : "OFF");
+    Serial.print(", Gain Error (dB): ");
+    Serial.print(IQ_Balance.getGainError_dB(), 2);
+    Serial.print(", Phase Error (deg): ");
+    Serial.print(IQ_Balance.getPhaseError_deg(), 2);
+    Serial.print(", Image Rejection (dB): ");
+    Serial.print(IQ_Balance.getImageRejection_dB(), 1);
+    Serial.print(", Uncorrected: ");
+    Serial.println(IQ_Balance.getRawImageRejection_dB(), 1);
+}
+//
+// I2S lag correction report for the console 'C' command
+void printPreProcStats(void)
+{
+    Serial.print("I2S Lag Correction: ");
+    Serial.print(RX_PreProc.getI2SerrorCompensation());
+    Serial.print(", Auto Detect: ");
+    Serial.println(RX_PreProc.getAutoI2SerrorDetectionStatus() ? "Running" : "Done");
+}
@@ -0,0 +1,153 @@
+//
+// RX_Chain.h
+//
+// The receive audio graph: sample rates, the F32 objects and the patch cords between them, plus the one time setup
+// of the objects that do not depend on the mode or bandwidth.  SDR_RA8875.ino includes it, and so does the host
+// build in host/rx_bench.cpp, so the chain that gets benchmarked and replayed on a PC is the one the radio runs.
+// Nothing in here may touch the display, the SD card or any other hardware.
+//
+// Objects update in the order they are defined here.
+//
+
+// FFT size for the spectrum and waterfall.  Can be set on the compiler command line, 1024, 2048 or 4096.
+// Bin size is sample rate / FFT_SIZE so 1024 gives 50Hz bins at 51200Hz, 4096 gives 12.5Hz.
+#ifndef FFT_SIZE
+#define FFT_SIZE                1024
+#endif
+
+// Pick the OpenAudio IQ FFT analyzer class for FFT_SIZE.  Any other size fails to compile here.
+template <int N> struct FFT_IQ_Traits {
+    static_assert(N == 1024 || N == 2048 || N == 4096, "FFT_SIZE must be 1024, 2048 or 4096");
+};
+template <> struct FFT_IQ_Traits<1024> { typedef AudioAnalyzeFFT1024_IQ_F32 Analyzer; };
+template <> struct FFT_IQ_Traits<2048> { typedef AudioAnalyzeFFT2048_IQ_F32 Analyzer; };
+template <> struct FFT_IQ_Traits<4096> { typedef AudioAnalyzeFFT4096_IQ_F32 Analyzer; };
+typedef FFT_IQ_Traits<FFT_SIZE>::Analyzer FFT_Analyzer;
+
+// Audio Library setup stuff
+//float sample_rate_Hz = 11000.0f;  //43Hz /bin  5K spectrum
+//float sample_rate_Hz = 22000.0f;  //21Hz /bin 6K wide
+//float sample_rate_Hz = 44100.0f;  //43Hz /bin  12.5K spectrum
+//float sample_rate_Hz = 48000.0f;  //46Hz /bin  24K spectrum for 1024, 187.5/bin for 256 FFTiq
+float sample_rate_Hz = 51200.0f;    // 50Hz/bin for 1024, 200Hz/bin for 256 FFT
+//float sample_rate_Hz = 102400.0f;  // 100Hz/bin
+//float sample_rate_Hz = 192000.0f;  // 200Hz/bin
+const int   audio_block_samples = 128;
+AudioSettings_F32 audio_settings(sample_rate_Hz, audio_block_samples);
+// The demodulator chain (Hilbert, CW filter, S meter) runs at the capture rate divided by this.
+// Must divide audio_block_samples.  1 turns decimation off and uses the Hilbert.h tables.
+#define RX_DECIMATION       4
+float rx_sample_rate_Hz = sample_rate_Hz/RX_DECIMATION;    // 12.8KHz at 51.2KHz capture
+AudioSettings_F32 rx_settings(rx_sample_rate_Hz, audio_block_samples/RX_DECIMATION);
+
+AudioInputI2S_F32       Input(audio_settings);
+AudioSDRplayIQ_F32      RX_Play;        // plays an IQ recording in place of the live input, see IQ_File.h
+AudioSDRpreProcessor_F32 RX_PreProc;    // Teensy I2S one sample IQ lag fix and IQ swap
+AudioSDRiqBalance_F32   IQ_Balance;     // learns and corrects the IQ gain and phase mismatch
+AudioSDRrecordIQ_F32    RX_IQ_Record;   // raw IQ to the SD card, see IQ_File.h
+AudioSDRrecordIQ_F32    Stream_IQ;      // decimated IQ for the USB host stream, see Host_Stream.h
+AudioDecimateIQ_F32     RX_Decimate;
+AudioInterpolate_F32    RX_Interpolate;
+AudioMixer4_F32         FFT_Switch1;
+AudioMixer4_F32         FFT_Switch2;
+AudioSDRzoomIQ_F32      FFT_Zoom;       // zoom FFT, mixes and decimates the FFT input to set the span
+AudioFilterIQPhasing_F32 RX_Hilbert;     // Fused +45/-45 Hilbert pair, out 0 is the sideband set by selectMode()
+AudioFilterBiquad_F32   CW_Filter(rx_settings);
+AudioSDRagc_F32         RX_AGC;         // receive AGC, settings from agc_set[]
+AudioSDRsmeter_F32      S_Meter;        // calibrated S meter, power with meter ballistics
+AudioAnalyzePeak_F32    Q_Peak; 
+AudioAnalyzePeak_F32    I_Peak;
+AudioAnalyzePeak_F32    CW_Peak;
+AudioAnalyzeRMS_F32     CW_RMS;  
+FFT_Analyzer            myFFT;          // AudioAnalyzeFFTxxxx_IQ_F32 picked by FFT_SIZE
+AudioOutputI2S_F32      Output(audio_settings);
+
+//#define TEST_SINEWAVE_SIG
+#ifdef TEST_SINEWAVE_SIG
+//AudioSynthSineCosine_F32   sinewave1;
+//AudioSynthSineCosine_F32   sinewave2;
+//AudioSynthSineCosine_F32   sinewave3;
+AudioSynthWaveformSine_F32 sinewave1;
+AudioSynthWaveformSine_F32 sinewave2;
+AudioSynthWaveformSine_F32 sinewave3;
+AudioConnection_F32     patchCord4c(sinewave2,0,  FFT_Switch1,2);
+AudioConnection_F32     patchCord4d(sinewave3,0,  FFT_Switch1,3);
+//AudioConnection_F32     patchCord4e(sinewave3,0,  FFT_Switch1,4);
+#endif
+
+AudioConnection_F32     patchCord0a(Input,0,      RX_Play,0);
+AudioConnection_F32     patchCord0b(Input,1,      RX_Play,1);
+AudioConnection_F32     patchCord0g(RX_Play,0,    RX_PreProc,0);
+AudioConnection_F32     patchCord0h(RX_Play,1,    RX_PreProc,1);
+AudioConnection_F32     patchCord0c(RX_PreProc,0, IQ_Balance,0);
+AudioConnection_F32     patchCord0d(RX_PreProc,1, IQ_Balance,1);
+AudioConnection_F32     patchCord0e(Input,0,      RX_IQ_Record,0);
+AudioConnection_F32     patchCord0f(Input,1,      RX_IQ_Record,1);
+AudioConnection_F32     patchCord4a(IQ_Balance,0, FFT_Switch1,0);
+AudioConnection_F32     patchCord4b(IQ_Balance,1, FFT_Switch2,0);
+AudioConnection_F32     patchCord4c(Output,0,     FFT_Switch1,1);
+AudioConnection_F32     patchCord4d(Output,1,     FFT_Switch2,1);
+AudioConnection_F32     patchCord1e(IQ_Balance,0, RX_Decimate,0);
+AudioConnection_F32     patchCord1f(IQ_Balance,1, RX_Decimate,1);
+AudioConnection_F32     patchCord1a(RX_Decimate,0, RX_Hilbert,0);
+AudioConnection_F32     patchCord1b(RX_Decimate,1, RX_Hilbert,1);
+AudioConnection_F32     patchCord1g(RX_Decimate,0, Stream_IQ,0);
+AudioConnection_F32     patchCord1h(RX_Decimate,1, Stream_IQ,1);
+AudioConnection_F32     patchCord1c(Input,1,      Q_Peak,0);
+AudioConnection_F32     patchCord1d(Input,0,      I_Peak,0);
+AudioConnection_F32     patchCord2g(RX_Hilbert,0, S_Meter,0);
+AudioConnection_F32     patchCord2h(RX_Hilbert,0, CW_Filter,0);
+AudioConnection_F32     patchCord2i(CW_Filter,0,  CW_Peak,0);
+AudioConnection_F32     patchCord2i1(CW_Filter,0, CW_RMS,0);
+AudioConnection_F32     patchCord2l(CW_Filter,0,  RX_AGC,0);
+AudioConnection_F32     patchCord2m(RX_AGC,0,     RX_Interpolate,0);
+AudioConnection_F32     patchCord2j(RX_Interpolate,0, Output,0);
+AudioConnection_F32     patchCord2k(RX_Interpolate,0, Output,1);
+AudioConnection_F32     patchCord4f(FFT_Switch1,0, FFT_Zoom,0);
+AudioConnection_F32     patchCord4g(FFT_Switch2,0, FFT_Zoom,1);
+AudioConnection_F32     patchCord4h(FFT_Zoom,0,   myFFT,0);
+AudioConnection_F32     patchCord4i(FFT_Zoom,1,   myFFT,1);
+
+// Receive chain objects in update order, for the profile reports (the 'P' console command and host/rx_bench)
+struct RX_Chain_Entry {
+    const char  *name;
+    AudioStream *obj;
+} rx_chain[] = {
+    {"Input",       &Input},
+    {"RX_Play",     &RX_Play},
+    {"RX_PreProc",  &RX_PreProc},
+    {"IQ_Balance",  &IQ_Balance},
+    {"RX_IQ_Record", &RX_IQ_Record},
+    {"Stream_IQ",   &Stream_IQ},
+    {"RX_Decimate", &RX_Decimate},
+    {"RX_Interpolate", &RX_Interpolate},
+    {"FFT_Switch1", &FFT_Switch1},
+    {"FFT_Switch2", &FFT_Switch2},
+    {"FFT_Zoom",    &FFT_Zoom},
+    {"RX_Hilbert",  &RX_Hilbert},
+    {"CW_Filter",   &CW_Filter},
+    {"RX_AGC",      &RX_AGC},
+    {"S_Meter",     &S_Meter},
+    {"Q_Peak",      &Q_Peak},
+    {"I_Peak",      &I_Peak},
+    {"CW_Peak",     &CW_Peak},
+    {"CW_RMS",      &CW_RMS},
+    {"myFFT",       &myFFT},
+    {"Output",      &Output}
+};
+#define RX_CHAIN_OBJECTS    (sizeof(rx_chain)/sizeof(rx_chain[0]))
+
+//
+// Setup for the chain objects that does not change with mode, bandwidth or AGC.  Call from setup() before
+// selectBandwidth(), which designs the Hilbert pair for the decimated rate.
+void rx_chain_begin(void)
+{
+    RX_PreProc.startAutoI2SerrorDetection();    // finds the I2S one sample lag, if any, then stops looking
+    RX_PreProc.swapIQ(false);
+    IQ_Balance.begin(0.01f);    // weight of each block in the running averages, settles in a few hundred blocks
+    IQ_Balance.enable(false);   // turned on by spectrum_lag_check() once the I2S lag is found
+    RX_Decimate.begin(RX_DECIMATION, sample_rate_Hz);
+    RX_Interpolate.begin(RX_DECIMATION, sample_rate_Hz);
+    S_Meter.begin(10.0f, 500.0f, rx_sample_rate_Hz);      // attack and decay in ms, meter sees the decimated audio
+    RX_AGC.begin(rx_sample_rate_Hz);                      // call before selectAgc(), which loads agc_set[]
+}
@@ -104,18 +104,19 @@ struct Band_Memory {
     float       lineOut_Vol_last;
     uint8_t     xvtr_en;   // use Tranverter Table or not
     uint8_t     xvtr_num;  // index to Transverter Table 
+    float       sm_cal;    // S meter calibration, dB added to the meter's dBFS reading to get dBm
 } static bandmem[BANDS] = {
-    {"160M", 1800.0, 2000.0, 1840.0, 1860.0, LSB, BAND1,4,AGC_SLOW,OFF,OFF,OFF,OFF,ANT1, PRESEL1,ATTEN_OFF,PREAMP_OFF,MIC_OFF,1.0,ON,15,ON,0.7,ON,20,OFF,0 },
-    { "80M", 3500.0, 4000.0, 3573.0, 3830.0, LSB, BAND2,4,AGC_SLOW,OFF,OFF,OFF,OFF,ANT1, PRESEL2,ATTEN_OFF,PREAMP_OFF,MIC_OFF,1.0,ON,15,ON,0.7,ON,20,OFF,0 },
-    { "60M", 5000.0, 5000.0, 5000.0, 5000.0, USB, BAND3,4,AGC_SLOW,OFF,OFF,OFF,OFF,ANT1, PRESEL3,ATTEN_OFF,PREAMP_OFF,MIC_OFF,1.0,ON,15,ON,0.7,ON,20,OFF,0 },
-    { "40M", 7000.0, 7300.0, 7040.0, 7200.0,DATA, BAND4,4,AGC_SLOW,OFF,OFF,OFF,OFF,ANT1, PRESEL4,ATTEN_OFF,PREAMP_OFF,MIC_OFF,1.0,ON,15,ON,0.7,ON,20,OFF,0 },
-    { "30M",10000.0,10200.0,10136.0,10136.0,DATA, BAND5,4,AGC_SLOW,OFF,OFF,OFF,OFF,ANT1, PRESEL5,ATTEN_OFF,PREAMP_OFF,MIC_OFF,1.0,ON,15,ON,0.7,ON,20,OFF,0 },
-    { "20M",14000.0,14350.0,21074.0,14200.0,DATA, BAND6,4,AGC_SLOW,OFF,OFF,OFF,OFF,ANT1, PRESEL6,ATTEN_OFF,PREAMP_OFF,MIC_OFF,1.0,ON,15,ON,0.7,ON,20,OFF,0 },
-    { "17M",18000.0,18150.0,18000.0,18000.0, USB, BAND7,4,AGC_SLOW,OFF,OFF,OFF,OFF,ANT1, PRESEL7,ATTEN_OFF,PREAMP_OFF,MIC_OFF,1.0,ON,15,ON,0.7,ON,20,OFF,0 },
-    { "15M",21000.0,21450.0,21074.0,21350.0,DATA, BAND8,4,AGC_SLOW,OFF,OFF,OFF,OFF,ANT1, PRESEL8,ATTEN_OFF,PREAMP_OFF,MIC_OFF,1.0,ON,15,ON,0.7,ON,20,OFF,0 },
-    { "12M",24890.0,25000.0,24890.0,24920.0, USB, BAND9,4,AGC_SLOW,OFF,OFF,OFF,OFF,ANT1, PRESEL9,ATTEN_OFF,PREAMP_OFF,MIC_OFF,1.0,ON,15,ON,0.7,ON,20,OFF,0 },
-    { "10M",28000.0,29600.0,28100.0,28074.0,DATA,BAND10,4,AGC_SLOW,OFF,OFF,OFF,OFF,ANT1,PRESEL10,ATTEN_OFF,PREAMP_OFF,MIC_OFF,1.0,ON,15,ON,0.7,ON,20,OFF,0 },
-    {  "6M",50000.0,54000.0,50125.0,50313.0, USB,BAND11,4,AGC_SLOW,OFF,OFF,OFF,OFF,ANT1,PRESEL11,ATTEN_OFF,PREAMP_OFF,MIC_OFF,1.0,ON,15,ON,0.7,ON,20,OFF,0 }
+    {"160M", 1800.0, 2000.0, 1840.0, 1860.0, LSB, BAND1,4,AGC_SLOW,OFF,OFF,OFF,OFF,ANT1, PRESEL1,ATTEN_OFF,PREAMP_OFF,MIC_OFF,1.0,ON,15,ON,0.7,ON,20,OFF,0,0.0 },
+    { "80M", 3500.0, 4000.0, 3573.0, 3830.0, LSB, BAND2,4,AGC_SLOW,OFF,OFF,OFF,OFF,ANT1, PRESEL2,ATTEN_OFF,PREAMP_OFF,MIC_OFF,1.0,ON,15,ON,0.7,ON,20,OFF,0,0.0 },
+    { "60M", 5000.0, 5000.0, 5000.0, 5000.0, USB, BAND3,4,AGC_SLOW,OFF,OFF,OFF,OFF,ANT1, PRESEL3,ATTEN_OFF,PREAMP_OFF,MIC_OFF,1.0,ON,15,ON,0.7,ON,20,OFF,0,0.0 },
+    { "40M", 7000.0, 7300.0, 7040.0, 7200.0,DATA, BAND4,4,AGC_SLOW,OFF,OFF,OFF,OFF,ANT1, PRESEL4,ATTEN_OFF,PREAMP_OFF,MIC_OFF,1.0,ON,15,ON,0.7,ON,20,OFF,0,0.0 },
+    { "30M",10000.0,10200.0,10136.0,10136.0,DATA, BAND5,4,AGC_SLOW,OFF,OFF,OFF,OFF,ANT1, PRESEL5,ATTEN_OFF,PREAMP_OFF,MIC_OFF,1.0,ON,15,ON,0.7,ON,20,OFF,0,0.0 },
+    { "20M",14000.0,14350.0,21074.0,14200.0,DATA, BAND6,4,AGC_SLOW,OFF,OFF,OFF,OFF,ANT1, PRESEL6,ATTEN_OFF,PREAMP_OFF,MIC_OFF,1.0,ON,15,ON,0.7,ON,20,OFF,0,0.0 },
+    { "17M",18000.0,18150.0,18000.0,18000.0, USB, BAND7,4,AGC_SLOW,OFF,OFF,OFF,OFF,ANT1, PRESEL7,ATTEN_OFF,PREAMP_OFF,MIC_OFF,1.0,ON,15,ON,0.7,ON,20,OFF,0,0.0 },
+    { "15M",21000.0,21450.0,21074.0,21350.0,DATA, BAND8,4,AGC_SLOW,OFF,OFF,OFF,OFF,ANT1, PRESEL8,ATTEN_OFF,PREAMP_OFF,MIC_OFF,1.0,ON,15,ON,0.7,ON,20,OFF,0,0.0 },
+    { "12M",24890.0,25000.0,24890.0,24920.0, USB, BAND9,4,AGC_SLOW,OFF,OFF,OFF,OFF,ANT1, PRESEL9,ATTEN_OFF,PREAMP_OFF,MIC_OFF,1.0,ON,15,ON,0.7,ON,20,OFF,0,0.0 },
+    { "10M",28000.0,29600.0,28100.0,28074.0,DATA,BAND10,4,AGC_SLOW,OFF,OFF,OFF,OFF,ANT1,PRESEL10,ATTEN_OFF,PREAMP_OFF,MIC_OFF,1.0,ON,15,ON,0.7,ON,20,OFF,0,0.0 },
+    {  "6M",50000.0,54000.0,50125.0,50313.0, USB,BAND11,4,AGC_SLOW,OFF,OFF,OFF,OFF,ANT1,PRESEL11,ATTEN_OFF,PREAMP_OFF,MIC_OFF,1.0,ON,15,ON,0.7,ON,20,OFF,0,0.0 }
 };
 
 #define XVTRS 12
@@ -144,19 +145,21 @@ struct Transverter {
 };
 
 #define AGS_SET_NUM 4
+// Settings for the RX_AGC audio object, indexed by AGC_OFF..AGC_FAST.  Attack, decay and hang are in ms.
 struct AGC {
     char        agc_name[10];
-    uint8_t     agc_maxGain;
-    uint8_t     agc_response;
-    uint8_t     agc_hardlimit;    ///autoVolumeControl(maxGain, response, hardLimit, threshold, attack, decay);
-    float       agc_threshold;
-    float       agc_attack;
-    float       agc_decay;
+    uint8_t     agc_maxGain;      // most gain the AGC will apply, dB
+    uint8_t     agc_response;     // not used by RX_AGC, the old codec autoVolumeControl() response setting
+    uint8_t     agc_hardlimit;    // 1 = clip the AGC output at full scale
+    float       agc_threshold;    // output peak level the AGC aims for, dBFS
+    float       agc_attack;       // time constant for the gain coming down
+    float       agc_decay;        // time constant for the gain going back up
+    float       agc_hang;         // time the gain is held after the signal drops before it starts to decay
 } agc_set[AGS_SET_NUM] = {
-    { "AGC OFF",2,0,0,-36.0,12.0,6.0},
-    {"AGC SLOW",2,0,0,-36.0,12.0,6.0},
-    { "AGC MED",2,0,0,-36.0,12.0,6.0},
-    {"AGC FAST",2,0,0,-36.0,12.0,6.0}
+    { "AGC OFF", 0,0,0,-6.0,  5.0,   50.0,   0.0},     // no limiter either, the audio passes at unity gain
+    {"AGC SLOW",60,0,1,-6.0,  5.0, 1000.0, 500.0},
+    { "AGC MED",60,0,1,-6.0,  3.0,  300.0, 200.0},
+    {"AGC FAST",60,0,1,-6.0,  2.0,  100.0,  50.0}
 };
 
 #define USER_SETTINGS_NUM 3
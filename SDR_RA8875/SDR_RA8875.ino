@@ -24,19 +24,32 @@
 #include <Metro.h> 
 #include <Audio.h>
 #include <OpenAudio_ArduinoLibrary.h> // F32 library
+#include "AudioFilterIQPhasing_F32.h"
+#include "AudioSDRresample_F32.h"
+#include "AudioSDRzoomIQ_F32.h"
+#include "AudioSDRsmeter_F32.h"
+#include "AudioSDRagc_F32.h"
+#include "AudioSDRpreProcessor_F32.h"
+#include "AudioSDRiqBalance_F32.h"
+#include "AudioSDRrecordIQ_F32.h"
+#include "AudioSDRplayIQ_F32.h"
+#include "RX_Chain.h"         // sample rates and the receive audio graph, shared with the host build in host/
 #include "hilbert.h"
 #include "Vfo.h"
+#include "DisplayQueue.h"   // include before anything that draws
+#include "Scheduler.h"
 #include "Display.h"
 #include "Tuner.h"
-#include "AGC.h"
 #include "Mode.h"
 #include "BandWidth2.h"
 #include "Step.h"
-#include "Smeter.h"
 #include "CW_Tune.h"
 #include "Quadrature.h"
-#include "Spectrum_RA8875.h"
 #include "RadioConfig.h"
+#include "Spectrum_RA8875.h"    // include after RadioConfig.h, the noise floor tracker keeps state per band
+#include "Smeter.h"             // uses the band table and nf_band_index()
+#include "AGC.h"                // uses agc_set[]
+#include "IQ_File.h"            // shares the SD card with Spectrum_Recorder.h
 #include "UserInput.h"   // include after Spectrun_RA8875.h abd Display.h
 
 RA8875 tft = RA8875(RA8875_CS,RA8875_RESET); //initiate the display object
@@ -45,88 +58,29 @@ Si5351mcu si5351;
 const int myInput = AUDIO_INPUT_LINEIN;
 //const int myInput = AUDIO_INPUT_MIC;
 
-// Audio Library setup stuff
-//float sample_rate_Hz = 11000.0f;  //43Hz /bin  5K spectrum
-//float sample_rate_Hz = 22000.0f;  //21Hz /bin 6K wide
-//float sample_rate_Hz = 44100.0f;  //43Hz /bin  12.5K spectrum
-//float sample_rate_Hz = 48000.0f;  //46Hz /bin  24K spectrum for 1024, 187.5/bin for 256 FFTiq
-float sample_rate_Hz = 51200.0f;    // 50Hz/bin for 1024, 200Hz/bin for 256 FFT
-//float sample_rate_Hz = 102400.0f;  // 100Hz/bin
-//float sample_rate_Hz = 192000.0f;  // 200Hz/bin
-const int   audio_block_samples = 128;
-AudioSettings_F32 audio_settings(sample_rate_Hz, audio_block_samples);
-
 //
 //============================================  Start of Spectrum Setup Section =====================================================
 //
 // used for spectrum object
-//#define FFT_SIZE            256           // need a constant for array size declarion so manually set this value here   Could try a macro later
-int16_t fft_bins            = FFT_SIZE;     // Number of FFT bins which is FFT_SIZE/2 or FFT_SIZE for iq version
-float fft_bin_size = sample_rate_Hz/(FFT_SIZE*2);   // Size of FFT bin in HZ.  From sample_rate_Hz/FFT_SIZE*2 for iq
+// FFT_SIZE, the analyzer class and the sample rates are set in RX_Chain.h
+int16_t fft_bins            = FFT_SIZE;     // Number of FFT bins which is FFT_SIZE for iq version
+float fft_bin_size = sample_rate_Hz/FFT_SIZE;   // Size of FFT bin in HZ.  50Hz for 1024 at 51200Hz
 
 extern int16_t spectrum_preset;   // Specify the default layout option for spectrum window placement and size.
 int16_t waterfall_speed     = 60;    // window update rate in ms.  25 is fast enough to see dit and dahs well
-Metro spectrum = Metro(waterfall_speed);
-int16_t FFT_Source          = 0;
+int16_t waterfall_slowest   = 240;   // under load the scheduler may slow the waterfall down to this rate in ms
+int16_t FFT_Source          = 0;     // 0 = spectrum shows the IQ input, 1 = the filtered audio.  Set by selectMode()
 //
 //============================================ End of Spectrum Setup Section =====================================================
 //
                                
-AudioInputI2S_F32       Input(audio_settings);
-AudioMixer4_F32         FFT_Switch1;
-AudioMixer4_F32         FFT_Switch2;
-AudioFilterFIR_F32      Hilbert1;
-AudioFilterFIR_F32      Hilbert2;
-AudioFilterBiquad_F32   CW_Filter;
-AudioMixer4_F32         RX_Summer;
-AudioAnalyzePeak_F32    S_Peak; 
-AudioAnalyzePeak_F32    Q_Peak; 
-AudioAnalyzePeak_F32    I_Peak;
-AudioAnalyzePeak_F32    CW_Peak;
-AudioAnalyzeRMS_F32     CW_RMS;  
-//AudioAnalyzeFFT1024_F32 myFFT;
-AudioAnalyzeFFT256_IQ_F32 myFFT;
-AudioOutputI2S_F32      Output(audio_settings);
-
-//#define TEST_SINEWAVE_SIG
-#ifdef TEST_SINEWAVE_SIG
-//AudioSynthSineCosine_F32   sinewave1;
-//AudioSynthSineCosine_F32   sinewave2;
-//AudioSynthSineCosine_F32   sinewave3;
-AudioSynthWaveformSine_F32 sinewave1;
-AudioSynthWaveformSine_F32 sinewave2;
-AudioSynthWaveformSine_F32 sinewave3;
-AudioConnection_F32     patchCord4c(sinewave2,0,  FFT_Switch1,2);
-AudioConnection_F32     patchCord4d(sinewave3,0,  FFT_Switch1,3);
-//AudioConnection_F32     patchCord4e(sinewave3,0,  FFT_Switch1,4);
-#endif
-
-AudioConnection_F32     patchCord4a(Input,0,      FFT_Switch1,0);
-AudioConnection_F32     patchCord4b(Input,1,      FFT_Switch2,0);
-AudioConnection_F32     patchCord4c(Output,0,     FFT_Switch1,1);
-AudioConnection_F32     patchCord4d(Output,1,     FFT_Switch2,1);
-AudioConnection_F32     patchCord1a(Input,0,      Hilbert1,0);
-AudioConnection_F32     patchCord1b(Input,1,      Hilbert2,0);
-AudioConnection_F32     patchCord1c(Hilbert1,0,   Q_Peak,0);
-AudioConnection_F32     patchCord1d(Hilbert2,0,   I_Peak,0);
-AudioConnection_F32     patchCord2e(Hilbert1, 0,  RX_Summer,0);
-AudioConnection_F32     patchCord2f(Hilbert2, 0,  RX_Summer,1);
-AudioConnection_F32     patchCord2g(RX_Summer,0,  S_Peak,0);
-AudioConnection_F32     patchCord2h(RX_Summer,0,  CW_Filter,0);
-AudioConnection_F32     patchCord2i(CW_Filter,0,  CW_Peak,0);
-AudioConnection_F32     patchCord2i1(CW_Filter,0, CW_RMS,0);
-AudioConnection_F32     patchCord2j(CW_Filter,0,  Output,0);
-AudioConnection_F32     patchCord2k(CW_Filter,0,  Output,1);
-AudioConnection_F32     patchCord4f(FFT_Switch1,0, myFFT,0);
-AudioConnection_F32     patchCord4g(FFT_Switch2,0, myFFT,1);
-
 AudioControlSGTL5000    codec1;
 
 ///////////////////////Set up global variables for Frequency, mode, bandwidth, step
 int mndx=3; // sets the index to cycle through the modes ..
 int bndx=8; // sets the bandwidth initial index
 int fndx=4; // sets tuning step increment
-int andx=0; // AGC setting
+int andx=0; // AGC setting the AGC button loads next, agcBand() sets it from the band
 String mode="";
 String bandwidth="";
 String increment="";
@@ -145,15 +99,16 @@ long newFreq=0;
 long oldFreq=0;
 int attenuator=1;
 int preamp=1;
-Metro touch=Metro(350);
-Metro meter=Metro(200);
-Metro tune=Metro(125);
+// Scheduler task periods in ms.  Lower priority number runs first when more than one is due.
+#define TUNE_PERIOD         5       // encoder counts are caught by interrupt, this is how soon they get applied
+#define TOUCH_PERIOD        350
+#define METER_PERIOD        200
 //
 // _______________________________________ Setup_____________________________________________
 //
 void setup() 
 {
-	//Wire.setClock(400000);  // Increase i2C bus transfer data rate from default of 100KHz 
+	//Wire.setClock(400000);  // Increase i2C bus transfer data rate from default of 100KHz.  Now done in initVfo() after si5351.init()
 	//Serial.begin(115200);
 	tft.begin(RA8875_800x480);
 	tft.setRotation(0);
@@ -175,12 +130,13 @@ void setup()
 	selectStep(fndx);    
 	displayAgc();
 
-    // TODO: Move this to set mode and/or bandwidth sectoin when ready.  messes up initial USB/or LSB/CW alignments until one hits the mode button.
-    RX_Summer.gain(0,-3.0);   // Leave at 1.0
-    RX_Summer.gain(1,3.0);  // -1 for LSB out
+    rx_chain_begin();       // Call before selectBandwidth() so the Hilbert pair matches the decimated rate
+    iq_file_init();
+    stream_init();
+
     bndx = 8;
     selectBandwidth(bndx);
-    selectAgc();
+    agcBand();              // AGC setting saved for the band the dial is in
     selectMode(); 
     
     //AudioMemory(16);   // moved to 32 bit so no longer needed hopefully
@@ -194,11 +150,11 @@ void setup()
     codec1.lineInLevel(15,15);     // range 0 to 15.  0 => 3.12Vp-p, 15 => 0.24Vp-p sensitivity
     codec1.lineOutLevel(20,20);    // range 13 to 31.  13 => 3.16Vp-p, 31=> 1.16Vp-p
     codec1.volume(0.7);   // 0.7 seemed optimal for K7MDL with QRP_Labs RX board with 15 on line input and 20 on line output
-    codec1.autoVolumeControl(2,0,0,-36.0,12,6); // add a compressor limiter
+    //codec1.autoVolumeControl(2,0,0,-36.0,12,6); // add a compressor limiter
     //codec1.autoVolumeControl( 0-2, 0-3, 0-1, 0-96, 3, 3);
     //autoVolumeControl(maxGain, response, hardLimit, threshold, attack, decay);
-    codec1.autoVolumeEnable();// let the volume control itself..... poor mans agc
-    //codec1.autoVolumeDisable();// Or don't let the volume control itself
+    //codec1.autoVolumeEnable();// let the volume control itself..... poor mans agc
+    codec1.autoVolumeDisable();// AGC is done by RX_AGC in the audio chain, see agc_set[] in RadioConfig.h
     codec1.unmuteHeadphone();
     codec1.unmuteLineout(); //unmute the audio output
     codec1.adcHighPassFilterDisable();
@@ -247,7 +203,7 @@ void setup()
     #endif
    
     // Choose our output type.  Can do dB, RMS or power
-    myFFT.setOutputType(FFT_DBFS);  // FFT_RMS or FFT_POWER or FFT_DBFS
+    myFFT.setOutputType(FFT_POWER);  // FFT_RMS or FFT_POWER or FFT_DBFS.  Spectrum_Average.h needs linear power
     
     // Uncomment one these to try other window functions
     //  myFFT.windowFunction(NULL);
@@ -265,46 +221,75 @@ void setup()
      // Print out our starting frequency for testing
     Serial.print("\nInitial Dial Frequency is "); Serial.print(Freq); Serial.println("MHz");
     
+    // Periodic jobs.  Input first, display last.  Only the waterfall is allowed to slow down under load.
+    addTask("Tune",     task_Tune,     TUNE_PERIOD,     0, 0);
+    addTask("Touch",    task_Touch,    TOUCH_PERIOD,    1, 0);
+    addTask("Meter",    task_Meter,    METER_PERIOD,    2, 0);
+    addTask("Spectrum", task_Spectrum, waterfall_speed, 3, waterfall_slowest);
+    addTask("SD Rec",   task_SpecRec,  SPEC_REC_PERIOD, 4, 0);     // idles unless recording
+    addTask("IQ Rec",   task_IQRec,    IQ_REC_PERIOD,   4, 0);
+    addTask("IQ Play",  task_IQPlay,   IQ_PLAY_PERIOD,  4, 0);
+    addTask("Stream",   task_Stream,   STREAM_PERIOD,   4, 0);      // idles until a host asks
+
     //finish the setup by printing the help menu to the serial connections
     printHelp();
 }
 //
+// __________________________________________ Scheduler Tasks  _____________________________________
+//
+// Add a periodic job.  A task that does not fit in the scheduler table would silently never run, so say so.
+void addTask(const char *name, void (*fn)(void), uint32_t period, uint8_t priority, uint32_t max_period)
+{
+    if (sched_add(name, fn, period, priority, max_period) < 0)
+    {
+        Serial.print("Scheduler: table full, task not added: ");
+        Serial.print(name);
+        Serial.print(" (SCHED_MAX_TASKS = ");
+        Serial.print(SCHED_MAX_TASKS);
+        Serial.println(")");
+    }
+}
+//
+void task_Tune(void)
+{
+    tuneEncoder();      // applies all counts since the last run with acceleration
+    agcBand();          // reloads the AGC when the dial crosses into another band
+}
+//
+void task_Touch(void)   ////// touch interrupt runs wayyy tooo fast .. so scheduled it up
+{
+    displayQueue_sync();    // touch UI draws directly, let any queued BTE move finish first
+    Touch(); // need to get the touch working //
+}
+//
+void task_Meter(void)
+{
+    Peak();
+    // Code_Peak();
+    // Quad_Check();
+}
+//
+void task_Spectrum(void)
+{
+    spectrum_update(spectrum_preset);   // valid numbers are 0 through PRESETS to index the record of predefined window layouts 
+}
+//
 // __________________________________________ Main Program Loop  _____________________________________
 //
 void loop() 
 {
-    // Update spectrum and waterfall based on timer
-    
-    if (spectrum.check() == 1)
-    {   
-        spectrum_update(spectrum_preset);   // valid numbers are 0 through PRESETS to index the record of predefined window layouts 
-    }
+    // Run the most important periodic task that is due: tuning, touch, S meter, then spectrum and waterfall
+    sched_run();
 
-    if(touch.check()==1) ////// touch interrupt runs wayyy tooo fast .. so scheduled it up
-    {
-        Touch(); // need to get the touch working //
-    }
- 
-    if(tune.check()==1)
-    {
-        newFreq = Position.read();
-        if(newFreq!=oldFreq)
-        {
-            selectFrequency(); // need to get the tuner working //
-        }
-    }
-    
-    if(meter.check()==1)
-    {
-        Peak();
-        // Code_Peak();
-        // Quad_Check();
-    }
+    // Run queued display ops for a while.  Returns early if the RA8875 is still busy with a BTE move.
+    displayQueue_service(DQ_SLICE_US);
 
-    //respond to Serial commands
+    //respond to Serial commands.  Framed host stream commands are picked out first, see Host_Stream.h
     while(Serial.available())
     {
-        respondToByte((char)Serial.read());
+        char c = (char)Serial.read();
+        if (!stream_rx_byte(c))
+            respondToByte(c);
     }
     
     //check to see whether to print the CPU and Memory Usage
@@ -367,11 +352,60 @@ void printCPUandMemory(unsigned long curTime_millis, unsigned long updatePeriod_
         Serial.print(AudioMemoryUsage());
         Serial.print("/");
         Serial.println(AudioMemoryUsageMax());
+        printSpectrumStats();
+        printDisplayQueueStats();
+        printSchedulerStats();
+        printVfoStats();
+        printPreProcStats();
+        printIQBalanceStats();
+        printIQRecStats();
+        printIQPlayStats();
+        printStreamStats();
         
         lastUpdate_millis = curTime_millis; //we will use this value the next time around.
     }
 }
 //
+// _______________________________________ Print Receive Chain Profile ____________________________
+//
+// Prints the time each receive chain object spends in its update() per audio block plus the resulting
+// throughput in samples/sec, as seen on the radio.  The audio library only keeps whole percent of the block
+// period of the core library (one step is about 29us) so this is for spotting the big users.  For a regression number
+// run the same chain on a PC with host/rx_bench, see host/README.md.  Peak values are reset after each report.
+void printRxChainProfile(void)
+{
+    // processorUsage() is scaled to the core library block period, not ours, so convert back to time first
+    const float usage_period_us = AUDIO_BLOCK_SAMPLES / AUDIO_SAMPLE_RATE_EXACT * 1000000.0f;
+    const float block_period_us = audio_block_samples / sample_rate_Hz * 1000000.0f;
+    float total_us = 0.0f;
+    float total_max_us = 0.0f;
+
+    Serial.print("RX Chain Profile: "); Serial.print(sample_rate_Hz,0); Serial.print("Hz, ");
+    Serial.print(audio_block_samples); Serial.print(" samples/block, ");
+    Serial.print(block_period_us,1); Serial.println("us per block");
+    for (uint16_t i = 0; i < RX_CHAIN_OBJECTS; i++)
+    {
+        float cur_us = rx_chain[i].obj->processorUsage()    * usage_period_us / 100.0f;
+        float max_us = rx_chain[i].obj->processorUsageMax() * usage_period_us / 100.0f;
+        total_us     += cur_us;
+        total_max_us += max_us;
+        Serial.print("  ");             Serial.print(rx_chain[i].name);
+        Serial.print("  Cur/Peak us: ");Serial.print(cur_us,1);
+        Serial.print("/");              Serial.println(max_us,1);
+        rx_chain[i].obj->processorUsageMaxReset();
+    }
+    Serial.print(" Total Cur/Peak us: "); Serial.print(total_us,1);
+    Serial.print("/");                    Serial.print(total_max_us,1);
+    Serial.print("  Load: ");             Serial.print(total_us/block_period_us*100.0f,1);
+    Serial.println("%");
+    if (total_us > 0.0f)
+    {
+        Serial.print(" Throughput: ");    Serial.print(audio_block_samples/total_us*1000000.0f,0);
+        Serial.print(" samples/sec (");   Serial.print(block_period_us/total_us,1);
+        Serial.println("x realtime)");
+    }
+}
+//
 // _______________________________________ Console Parser ____________________________________
 //
 //switch yard to determine the desired action
@@ -389,6 +423,33 @@ void respondToByte(char c)
           Serial.println("Toggle printing of memory and CPU usage.");
           togglePrintMemoryAndCPU();
           break;     
+        case 'P': case 'p':
+          printRxChainProfile();
+          break;
+        case 'W': case 'w':
+          palette_select(palette_index+1);
+          break;
+        case 'A': case 'a':
+          spec_avg_select(spec_avg_mode+1);
+          break;
+        case 'N': case 'n':
+          nf_auto_set(!nf_auto);
+          break;
+        case 'S': case 's':
+          smeter_calibrate(SMETER_S9_DBM);
+          break;
+        case 'Q': case 'q':
+          iq_balance_toggle();
+          break;
+        case 'R': case 'r':
+          spec_rec_toggle();
+          break;
+        case 'I': case 'i':
+          iq_rec_toggle();
+          break;
+        case 'F': case 'f':
+          iq_play_toggle();
+          break;
         default:
           Serial.print("You typed "); Serial.print(s);
           Serial.println(".  What command?");
@@ -403,4 +464,14 @@ void printHelp(void)
     Serial.println("Help: Available Commands:");
     Serial.println("   h: Print this help");
     Serial.println("   C: Toggle printing of CPU and Memory usage");
+    Serial.println("   P: Print receive chain time per block and throughput");
+    Serial.println("   W: Select the next waterfall color palette");
+    Serial.println("   A: Select the next spectrum averaging mode");
+    Serial.println("   N: Toggle automatic noise floor and reference level");
+    Serial.println("   S: Calibrate the S meter on this band so the present signal reads S9 (-73dBm)");
+    Serial.println("   Q: Toggle the adaptive IQ balance correction");
+    Serial.println("   R: Start or stop recording the spectrum to the SD card");
+    Serial.println("   I: Start or stop recording the raw IQ to the SD card as a WAV file");
+    Serial.println("   F: Play the newest IQ recording in place of the live input, or back to live");
+    Serial.println("   Binary stream commands from tools/sdr_stream_view.py are also taken on this port");
 }
@@ -0,0 +1,129 @@
+//
+// Scheduler.h
+//
+// Small cooperative scheduler for the periodic jobs in loop().  Each task has a period and a priority (0 runs first).
+// sched_run() is called every pass of loop() and runs at most one task, the highest priority one that is due, so a
+// tuning or touch task that comes due never waits behind more than one display task.
+//
+// A task added with a max_period larger than its period is allowed to slow down under load.  If it starts late or
+// a higher priority task had to wait for it, its period is stretched a step toward max_period.  When things are quiet
+// again it works its way back to the normal period.  The waterfall uses this so it loses frame rate instead of
+// making the encoder and touch sluggish.
+//
+// Per task stats (runs, overruns, max and last run time) print with the 'C' report.
+//
+
+#define SCHED_MAX_TASKS     10
+#define SCHED_LATE_MS       20          // a higher priority task starting this late means the slow ones should back off
+#define SCHED_STRETCH       5           // stretch by period/SCHED_STRETCH per late run
+#define SCHED_RELAX         20          // recover by period/SCHED_RELAX per on time run
+
+struct Sched_Task {
+    const char *name;
+    void     (*fn)(void);
+    uint32_t period;                    // normal period in ms
+    uint32_t period_now;                // current period, only differs from period for tasks that can stretch
+    uint32_t max_period;                // longest period allowed under load
+    uint8_t  priority;                  // 0 = most important
+    uint32_t next_due;                  // millis() when it should next run
+    uint32_t runs;                      // times run
+    uint32_t overruns;                  // times it missed a whole period and had runs skipped
+    uint32_t max_us;                    // longest run since the last stats print
+    uint32_t last_us;                   // last run time
+} sched_task[SCHED_MAX_TASKS];
+
+uint8_t sched_tasks     = 0;            // entries used in sched_task[]
+bool    sched_pressure  = false;        // a task ran late since the last stretchable task ran
+
+//function declarations
+int8_t sched_add(const char *name, void (*fn)(void), uint32_t period, uint8_t priority, uint32_t max_period);
+void   sched_run(void);
+void   printSchedulerStats(void);
+
+//
+// Add a task.  Returns its index or -1 if the table is full.  max_period of 0 means the task never stretches.
+int8_t sched_add(const char *name, void (*fn)(void), uint32_t period, uint8_t priority, uint32_t max_period)
+{
+    if (sched_tasks >= SCHED_MAX_TASKS)
+        return -1;
+
+    struct Sched_Task *t = &sched_task[sched_tasks];
+    t->name         = name;
+    t->fn           = fn;
+    t->period       = period;
+    t->period_now   = period;
+    t->max_period   = (max_period > period) ? max_period : period;
+    t->priority     = priority;
+    t->next_due     = millis() + period;
+    t->runs = t->overruns = t->max_us = t->last_us = 0;
+    return sched_tasks++;
+}
+//
+// Run the most important task that is due, if any
+void sched_run(void)
+{
+    uint32_t now = millis();
+    struct Sched_Task *t = NULL;
+
+    for (uint8_t i = 0; i < sched_tasks; i++)
+    {
+        struct Sched_Task *c = &sched_task[i];
+        if ((int32_t)(now - c->next_due) >= 0 && (t == NULL || c->priority < t->priority))
+            t = c;
+    }
+    if (t == NULL)
+        return;
+
+    uint32_t late = now - t->next_due;
+    uint32_t start = micros();
+    t->fn();
+    t->last_us = micros() - start;
+    if (t->last_us > t->max_us)
+        t->max_us = t->last_us;
+    t->runs++;
+
+    // Adjust the period of a task that can stretch.  Anything else running late counts as load.
+    if (t->max_period > t->period)
+    {
+        if (sched_pressure || late > t->period_now/2)
+            t->period_now = min(t->period_now + t->period/SCHED_STRETCH, t->max_period);
+        else if (t->period_now > t->period)
+            t->period_now = max(t->period_now - max(t->period/SCHED_RELAX, (uint32_t) 1), t->period);
+        sched_pressure = false;
+    }
+    else if (late > SCHED_LATE_MS)
+        sched_pressure = true;
+
+    // Next run.  If we fell a whole period behind skip the missed runs instead of running back to back.
+    t->next_due += t->period_now;
+    now = millis();
+    if ((int32_t)(now - t->next_due) > (int32_t) t->period_now)
+    {
+        t->overruns++;
+        t->next_due = now + t->period_now;
+    }
+}
+//
+// Task report for the console 'C' command
+void printSchedulerStats(void)
+{
+    for (uint8_t i = 0; i < sched_tasks; i++)
+    {
+        struct Sched_Task *t = &sched_task[i];
+        Serial.print(" Task ");
+        Serial.print(t->name);
+        Serial.print(" P");
+        Serial.print(t->priority);
+        Serial.print(" Period(ms): ");
+        Serial.print(t->period_now);
+        Serial.print(", Runs: ");
+        Serial.print(t->runs);
+        Serial.print(", Overruns: ");
+        Serial.print(t->overruns);
+        Serial.print(", Max(uS): ");
+        Serial.print(t->max_us);
+        Serial.print(", Last(uS): ");
+        Serial.println(t->last_us);
+        t->max_us = 0;
+    }
+}
@@ -1,50 +1,104 @@
 #include <RA8875.h>
-#include <Audio.h> 
-extern AudioAnalyzePeak_F32 S_Peak;  
+#include <Audio.h>
+extern AudioSDRsmeter_F32 S_Meter;
 extern RA8875 tft;
- 
+extern volatile uint32_t Freq;
 
-////////////////////////// this is the S meter code/////totall uncalibrated use at your own risk
+// S meter.  S_Meter measures the receive audio power with meter ballistics in the audio update, here it is turned
+// into dBm with the calibration for the current band (bandmem[].sm_cal) and shown as S units.  Only what changed is
+// redrawn: the dBm readout and bar when the reading moves by SMETER_STEP_DB, the S unit text and ring meter when
+// the S reading changes (whole S units up to S9, 10dB steps above).  The ring meter is the slow part.
+// To calibrate, feed in a known level and use the console 'S' command (sets the band so the reading is S9).
+#define SMETER_S9_DBM       -73.0f      // HF S9
+#define SMETER_DB_PER_S     6.0f
+#define SMETER_S0_DBM       (SMETER_S9_DBM - 9*SMETER_DB_PER_S)
+#define SMETER_TOP_DBM      (SMETER_S9_DBM + 60)    // right end of the bar, S9+60
+#define SMETER_STEP_DB      2           // dBm readout and bar resolution
+#define SMETER_OVER_STEP_DB 10          // S reading steps above S9
+#define SMETER_BAR_WIDTH    550
+#define SMETER_DRAW_OPS     7           // most display queue ops one redraw takes
+
+float   smeter_cal_general  = 0.0f;     // calibration outside the ham bands
+float   smeter_dBm          = SMETER_S0_DBM;    // last reading
+int16_t smeter_shown        = -32768;   // dBm reading on screen in SMETER_STEP_DB steps
+int16_t smeter_s_shown      = -32768;   // S reading on screen, see smeter_s_units()
+
+//function declarations
+float *smeter_cal(void);
+void   smeter_calibrate(float ref_dBm);
+int16_t smeter_s_units(float dBm);
+void   Peak_Ring(float s);
+void   Peak(void);
+
+//
+// Calibration value for the band we are on
+float *smeter_cal(void)
+{
+    int8_t b = nf_band_index(Freq);
+    return (b < BANDS) ? &bandmem[b].sm_cal : &smeter_cal_general;
+}
+//
+// Make the current reading equal ref_dBm
+void smeter_calibrate(float ref_dBm)
+{
+    float *cal = smeter_cal();
+    *cal += ref_dBm - smeter_dBm;
+    smeter_dBm = ref_dBm;
+    smeter_shown = smeter_s_shown = -32768;     // redraw
+    Serial.print("S Meter Calibration (dB) = ");
+    Serial.println(*cal, 1);
+}
+
+// S reading for dBm: 0 to 9 in whole S units, then 10, 11, .. for each SMETER_OVER_STEP_DB over S9
+int16_t smeter_s_units(float dBm)
+{
+    float over = dBm - SMETER_S9_DBM;
+    if (over > 0)
+        return 9 + (int16_t) (over / SMETER_OVER_STEP_DB);
+    return (int16_t) constrain(lroundf(9 + over / SMETER_DB_PER_S), 0L, 9L);
+}
+//
+// Runs from the display queue so the meter draw stays in order with the queued text
+void Peak_Ring(float s)
+{
+      tft.ringMeter(s, 0, 9, 550, 50, 64, "S-Units", 3, 1, 90, 10);
+}
+
+////////////////////////// this is the S meter code
 void Peak()
 {
-   float s_sample;  // Raw signal strength (max per 1ms)
-   float uv, dbuv, s;// microvolts, db-microvolts, s-units
    char string[80];   // print format stuff
- 
-  if (S_Peak.available())
+
+  if (S_Meter.available())
     {
-      s_sample =S_Peak.read();
-     
-      uv= s_sample * 1000;
-      dbuv = 20.0*log10(uv);
-     // Serial.print(dbuv);
-     // Serial.println();
-   
-      tft.fillRect(700, 38, 99,25,RA8875_BLACK);
-      tft.setFont(Arial_14);
-      tft.setCursor(720, 42);
-      tft.setTextColor(RA8875_GREEN);
-      tft.print(dbuv);
-      tft.fillRect(130, 47, 550,10, RA8875_BLACK);
-      tft.fillRect(130, 47,abs(dbuv*4),10,RA8875_GREEN );
-      
-      s = (dbuv-3)/6.0;
-     
-      if (s <0.0) s=0.0;
-      if (s>9.0)
+      smeter_dBm = S_Meter.getdBFS() + *smeter_cal();
+      int16_t step = (int16_t) floorf(smeter_dBm / SMETER_STEP_DB);
+      int16_t s    = smeter_s_units(smeter_dBm);
+      if (step == smeter_shown && s == smeter_s_shown)
+          return;           // nothing on screen would change
+      if (!displayQueue_room(SMETER_DRAW_OPS))
+          return;           // queue is backed up, try again with the next reading
+
+      if (step != smeter_shown)
       {
-      s = 9.0;
+          smeter_shown = step;
+          dq_fillRect(700, 38, 99,25,RA8875_BLACK);
+          snprintf(string, sizeof(string), "%.0fdBm", smeter_dBm);
+          dq_print(720, 42, Arial_14, RA8875_GREEN, string);
+          dq_fillRect(130, 47, 550,10, RA8875_BLACK);
+          int16_t bar = constrain((smeter_dBm - SMETER_S0_DBM) * SMETER_BAR_WIDTH / (SMETER_TOP_DBM - SMETER_S0_DBM), 0, SMETER_BAR_WIDTH);
+          if (bar > 0)
+              dq_fillRect(130, 47, bar, 10, RA8875_GREEN);
       }
-      else dbuv = 0;
-              
-      tft.fillRect(72, 38, 57,25,RA8875_BLACK);
-      tft.setFont(Arial_14);
-      tft.setCursor(1, 42);
-      tft.setTextColor(RA8875_GREEN);
-      if (dbuv == 0) sprintf(string,"S-Meter:%1.0f",s);
-      else sprintf(string,"S-Meter:9+%02.0f",dbuv);
-      tft.print(string);
 
-      tft.ringMeter(s, 0, 9, 550, 50, 64, "S-Units", 3, 1, 90, 10);
+      if (s != smeter_s_shown)
+      {
+          smeter_s_shown = s;
+          dq_fillRect(72, 38, 57,25,RA8875_BLACK);
+          if (s <= 9) sprintf(string,"S-Meter:%d", s);
+          else sprintf(string,"S-Meter:9+%02d", (s - 9) * SMETER_OVER_STEP_DB);
+          dq_print(1, 42, Arial_14, RA8875_GREEN, string);
+          dq_call(Peak_Ring, s < 9 ? s : 9);
+      }
      }
 }
@@ -0,0 +1,183 @@
+//
+// Spectrum_Average.h
+//
+// Frame to frame averaging of the spectrum FFT.  myFFT is run with FFT_POWER output so averaging is done on
+// linear power, then each bin is converted to dB once per frame for spectrum_update().  Averaging before the
+// log gives a steadier noise floor and signals that keep their true level.
+//
+// Modes:  Off        - no averaging, the dB of the latest frame
+//         Exp        - exponential, new = old + spec_avg_alpha * (frame - old)
+//         Boxcar     - mean of the last spec_avg_frames frames, kept as a running sum
+//         Peak Hold  - highest value seen, falls by spec_avg_decay_dB each frame
+//         Min Hold   - lowest value seen
+// Peak and min hold start over on a retune or a span change.
+//
+// The dB values come out in FFT bin order so FFT_Bin() and fft_map[] read them the same as the old FFT_DBFS output.
+// The boxcar history takes FFT_SIZE * SPEC_AVG_BOX_MAX floats so it lives in DMAMEM.
+//
+
+#define SPEC_AVG_BOX_MAX        8           // most frames in the boxcar average
+#define SPEC_AVG_FLOOR          1e-20f      // power floor, -200 dB.  Keeps log10 away from 0
+
+enum Spec_Avg_Mode {
+    SPEC_AVG_OFF,
+    SPEC_AVG_EXP,
+    SPEC_AVG_BOXCAR,
+    SPEC_AVG_PEAK,
+    SPEC_AVG_MIN,
+    SPEC_AVG_MODES
+};
+const char *Spec_Avg_Names[SPEC_AVG_MODES] = {"Off", "Exp", "Boxcar", "Peak Hold", "Min Hold"};
+
+extern volatile uint32_t Freq;
+
+float    spec_avg_pwr[FFT_SIZE] __attribute__ ((aligned (32)));    // averaged linear power
+float    spec_avg_db[FFT_SIZE]  __attribute__ ((aligned (32)));    // spec_avg_pwr in dB, what spectrum_update() draws from
+float    spec_avg_in[FFT_SIZE]  __attribute__ ((aligned (32)));    // cleaned copy of a frame that had NaN or Inf in it
+DMAMEM float spec_avg_box[SPEC_AVG_BOX_MAX][FFT_SIZE];             // boxcar history
+uint8_t  spec_avg_mode          = SPEC_AVG_EXP;
+float    spec_avg_alpha         = 0.4f;     // Exp mode weight of the newest frame, 1.0 = no averaging
+uint8_t  spec_avg_frames        = 4;        // Boxcar mode frame count, 1 to SPEC_AVG_BOX_MAX
+float    spec_avg_decay_dB      = 0.5f;     // Peak Hold fall rate per frame
+uint32_t spec_avg_us            = 0;        // time taken by the last spec_avg_process()
+
+static uint8_t  spec_avg_box_next   = 0;    // oldest boxcar frame, overwritten next
+static uint8_t  spec_avg_box_count  = 0;    // boxcar frames held so far
+static bool     spec_avg_restart    = true; // next frame replaces the average
+static uint32_t spec_avg_freq       = 0;    // Freq the held values are for
+
+//function declarations
+float *spec_avg_process(const float *pwr);
+void   spec_avg_reset(void);
+void   spec_avg_select(uint8_t mode);
+void   printSpecAvgStats(void);
+
+//
+// Average one FFT frame of linear power and return the dB array
+float *spec_avg_process(const float *pwr)
+{
+    uint32_t start = micros();
+    float   *avg = spec_avg_pwr;
+    int16_t  i;
+
+    // A NaN or Inf would stay in the average for good.  Replace them with the floor and count them.
+    for (i = 0; i < FFT_SIZE; i++)
+        if (!(pwr[i] >= 0.0f && pwr[i] <= FLT_MAX))
+            break;
+    if (i < FFT_SIZE)
+    {
+        for (i = 0; i < FFT_SIZE; i++)
+        {
+            spec_avg_in[i] = pwr[i];
+            if (!(pwr[i] >= 0.0f && pwr[i] <= FLT_MAX))
+            {
+                spec_avg_in[i] = SPEC_AVG_FLOOR;
+                spectrum_bad_bins++;
+            }
+        }
+        pwr = spec_avg_in;
+    }
+
+    if (spec_avg_freq != Freq && (spec_avg_mode == SPEC_AVG_PEAK || spec_avg_mode == SPEC_AVG_MIN))
+        spec_avg_restart = true;            // held values are for a different frequency
+    spec_avg_freq = Freq;
+
+    if (spec_avg_restart || spec_avg_mode == SPEC_AVG_OFF)
+    {
+        arm_copy_f32((float32_t *) pwr, avg, FFT_SIZE);
+        spec_avg_box_next = spec_avg_box_count = 0;
+        if (spec_avg_mode == SPEC_AVG_BOXCAR)
+        {
+            arm_copy_f32((float32_t *) pwr, spec_avg_box[0], FFT_SIZE);
+            spec_avg_box_next = spec_avg_box_count = 1;
+        }
+        spec_avg_restart = false;
+    }
+    else
+    {
+        switch (spec_avg_mode)
+        {
+            case SPEC_AVG_EXP:
+                for (i = 0; i < FFT_SIZE; i++)
+                    avg[i] += spec_avg_alpha * (pwr[i] - avg[i]);
+                break;
+            case SPEC_AVG_BOXCAR:
+            {
+                // avg[] holds the sum of the frames in the history.  Swap the oldest frame for this one.
+                float *old = spec_avg_box[spec_avg_box_next];
+                if (spec_avg_box_count < spec_avg_frames)
+                {
+                    arm_add_f32(avg, (float32_t *) pwr, avg, FFT_SIZE);
+                    spec_avg_box_count++;
+                }
+                else
+                {
+                    for (i = 0; i < FFT_SIZE; i++)
+                        avg[i] += pwr[i] - old[i];
+                }
+                arm_copy_f32((float32_t *) pwr, old, FFT_SIZE);
+                spec_avg_box_next = (spec_avg_box_next + 1) % spec_avg_frames;
+                if (spec_avg_box_next == 0 && spec_avg_box_count == spec_avg_frames)
+                {
+                    // Once around the history, redo the sum so rounding error in the running sum can not build up
+                    arm_copy_f32(spec_avg_box[0], avg, FFT_SIZE);
+                    for (uint8_t f = 1; f < spec_avg_frames; f++)
+                        arm_add_f32(avg, spec_avg_box[f], avg, FFT_SIZE);
+                }
+                break;
+            }
+            case SPEC_AVG_PEAK:
+            {
+                float decay = powf(10.0f, -spec_avg_decay_dB/10.0f);
+                for (i = 0; i < FFT_SIZE; i++)
+                {
+                    float p = avg[i] * decay;
+                    avg[i] = (pwr[i] > p) ? pwr[i] : p;
+                }
+                break;
+            }
+            case SPEC_AVG_MIN:
+                for (i = 0; i < FFT_SIZE; i++)
+                    if (pwr[i] < avg[i])
+                        avg[i] = pwr[i];
+                break;
+        }
+    }
+
+    // One log per bin for the whole frame.  Boxcar keeps a sum so scale it back to the mean first.
+    float scale = (spec_avg_mode == SPEC_AVG_BOXCAR && spec_avg_box_count > 0) ? 1.0f/spec_avg_box_count : 1.0f;
+    for (i = 0; i < FFT_SIZE; i++)
+    {
+        float p = avg[i] * scale;
+        spec_avg_db[i] = 10.0f * log10f(p > SPEC_AVG_FLOOR ? p : SPEC_AVG_FLOOR);
+    }
+    spec_avg_us = micros() - start;
+    return spec_avg_db;
+}
+//
+// Start the average over with the next frame
+void spec_avg_reset(void)
+{
+    spec_avg_restart = true;
+}
+//
+// Pick an averaging mode
+void spec_avg_select(uint8_t mode)
+{
+    if (mode >= SPEC_AVG_MODES)
+        mode = SPEC_AVG_OFF;
+    spec_avg_frames = constrain(spec_avg_frames, 1, SPEC_AVG_BOX_MAX);
+    spec_avg_mode = mode;
+    spec_avg_reset();
+    Serial.print("Spectrum Averaging = ");
+    Serial.println(Spec_Avg_Names[spec_avg_mode]);
+}
+//
+// Averaging report for the console 'C' command
+void printSpecAvgStats(void)
+{
+    Serial.print("Spectrum Averaging: ");
+    Serial.print(Spec_Avg_Names[spec_avg_mode]);
+    Serial.print(", Process Time (uS): ");
+    Serial.println(spec_avg_us);
+}
@@ -0,0 +1,70 @@
+//
+// Spectrum_Peaks.h
+//
+// Finds the strongest signals in the spectrum frame.  One pass over the averaged dB bins that are on screen picks
+// out local maxima at least SPEC_PEAK_SNR_DB above the noise floor and keeps the strongest SPEC_PEAKS_MAX of them
+// in spec_peaks[], strongest first.
+//
+// Each peak's frequency and level are refined by fitting a parabola through the peak bin and its two neighbors
+// (on dB values, which suits the Hanning window the FFT uses).  Frequencies are offsets in Hz from the dial
+// frequency, negative below it.  The FFT object is never touched.
+//
+// spectrum_update() shows the top peak in the P: and F: readouts.  The list is there for markers or click to tune.
+//
+
+#define SPEC_PEAKS_MAX          8           // most peaks kept per frame
+#define SPEC_PEAK_SNR_DB        10.0f       // a peak must be this far above the noise floor
+#define SPEC_PEAK_DC_BINS       5           // bins either side of 0Hz that are never peaks (DC carrier noise at Fc)
+
+struct Spec_Peak {
+    float   freq_Hz;                        // offset from the dial frequency, interpolated
+    float   dB;                             // interpolated level
+    int16_t bin;                            // bin offset from 0Hz, negative below
+};
+struct Spec_Peak spec_peaks[SPEC_PEAKS_MAX];   // strongest first
+uint8_t  spec_peak_count        = 0;
+
+//function declarations
+uint8_t spec_peaks_find(const float *dB, int16_t half_width, float floor_dB);
+
+//
+// Find the peaks among bins -half_width to +half_width from 0Hz.  dB[] is in FFT bin order.  Returns the count.
+uint8_t spec_peaks_find(const float *dB, int16_t half_width, float floor_dB)
+{
+    float   threshold = floor_dB + SPEC_PEAK_SNR_DB;
+    uint8_t n = 0;
+
+    if (half_width > FFT_SIZE/2 - 1)
+        half_width = FFT_SIZE/2 - 1;
+
+    for (int16_t k = -half_width+1; k < half_width-1; k++)
+    {
+        if (k >= -SPEC_PEAK_DC_BINS && k <= SPEC_PEAK_DC_BINS)
+            continue;
+        float b = dB[k & (FFT_SIZE-1)];
+        if (b < threshold || (n == SPEC_PEAKS_MAX && b <= spec_peaks[n-1].dB))
+            continue;
+        float a = dB[(k-1) & (FFT_SIZE-1)];
+        float c = dB[(k+1) & (FFT_SIZE-1)];
+        if (b <= a || b < c)
+            continue;                       // not a local maximum
+
+        // Parabola through a, b, c.  d is the vertex offset from k in bins, -0.5 to 0.5.
+        float den = a - 2*b + c;
+        float d = (den < 0.0f) ? 0.5f * (a - c) / den : 0.0f;
+        float level = b - 0.25f * (a - c) * d;
+
+        // Insert in order, dropping the weakest if the list is full
+        int8_t j = (n < SPEC_PEAKS_MAX) ? n++ : SPEC_PEAKS_MAX-1;
+        while (j > 0 && spec_peaks[j-1].dB < level)
+        {
+            spec_peaks[j] = spec_peaks[j-1];
+            j--;
+        }
+        spec_peaks[j].freq_Hz = (k + d) * fft_bin_size;
+        spec_peaks[j].dB      = level;
+        spec_peaks[j].bin     = k;
+    }
+    spec_peak_count = n;
+    return n;
+}
@@ -62,18 +62,56 @@ Metro fftFreq_timestamp = Metro(fftFreq_refresh);
 #define myYELLOW                RA8875_YELLOW
 #define myGREEN                 RA8875_GREEN
 
+// FFT_SIZE and the FFT_Analyzer class it picks are set in RX_Chain.h
+#define SPECTRUM_MAX_WIDTH      512         // widest graph area in pixels, sizes the per column arrays below
+
+static_assert((FFT_SIZE & (FFT_SIZE-1)) == 0, "FFT_SIZE must be a power of 2, the FFT shift masks with FFT_SIZE-1");
+static_assert(SPECTRUM_MAX_WIDTH <= FFT_SIZE, "graph wider than the FFT would leave columns with no bin");
+
 // From main file where sampling rate and other audio library features are set
-extern AudioAnalyzeFFT256_IQ_F32  myFFT;
-extern int16_t                  fft_bins;    //Number of FFT bins. 1024 FFT has 512 bins for 50Hz per bin   (sample rate / FFT size)
+extern FFT_Analyzer             myFFT;
+extern int16_t                  fft_bins;    //Number of FFT bins. 1024 FFT has 1024 bins for 50Hz per bin   (sample rate / FFT size)
 extern float                    fft_bin_size;       
+extern float                    sample_rate_Hz;
+extern AudioSDRzoomIQ_F32       FFT_Zoom;     // between the FFT source switches and myFFT
+extern AudioSDRpreProcessor_F32 RX_PreProc;   // I2S lag detection reads the spectrum, see spectrum_lag_check()
+extern AudioSDRiqBalance_F32    IQ_Balance;
+extern int16_t                  FFT_Source;   // 0 = IQ input, 1 = filtered audio output
 extern RA8875                   tft;
 
-#define FFT_SIZE                256        // need a constant for array size declarion so manually set this value here   Could try a macro later
-int16_t line_buffer[FFT_SIZE*2];            // Will only use the first x bytes defined by wf_sp_width var.  Could be 4096 FFT later which is larger than our width in pixels. 
+int16_t line_buffer[SPECTRUM_MAX_WIDTH] __attribute__ ((aligned (32)));   // Will only use the first x bytes defined by wf_sp_width var.
+float   pixelnew[SPECTRUM_MAX_WIDTH]    __attribute__ ((aligned (32)));   // Stores current pixel for spectrum portion only
+int16_t fft_map[SPECTRUM_MAX_WIDTH];        // Graph column to FFT output bin (FFT shift), -1 = no bin for this column.  Lets us read the FFT output in place.
+int16_t fft_map_width           = 0;        // wf_sp_width that fft_map[] was last built for
+uint32_t spectrum_update_us     = 0;        // time spent in the last spectrum_update() that had FFT data
+uint32_t spectrum_update_max_us = 0;        // worst case since the last stats print
+uint32_t spectrum_bad_bins      = 0;        // count of NaN or Inf values seen in the FFT output
+
+// Spectrum trace renderer.  Each graph column keeps the rows that are lit on screen so a new frame only rewrites 
+// the columns that changed.  Neighboring changed columns are written together as one writeRect when that is cheaper.
+#define SPECTRUM_SPAN_PIXELS    4096        // largest block written by one writeRect
+#define SPECTRUM_SPAN_MERGE     48          // unchanged pixels we will rewrite to save one more draw op (about the cost of a window setup)
+#define SPECTRUM_GRID_X         24          // grid lines start this far in from the left edge, the labels go to the left of it
+#define SPECTRUM_MAX_ROWS       480         // RA8875 display height
+#define SPECTRUM_BLANKING       3           // columns either side of Fc blanked in the waterfall to hide the DC line
+
+struct Trace_Column {
+    int16_t a0, a1;                         // first range of lit rows.  a0 > a1 means none
+    int16_t b0, b1;                         // second range, DOT mode uses this for the right half of the dot from the column before
+};
+struct Trace_Column trace_new[SPECTRUM_MAX_WIDTH];    // what this frame should look like
+struct Trace_Column trace_drawn[SPECTRUM_MAX_WIDTH];    // what is on the screen now
+uint8_t  trace_grid_row[SPECTRUM_MAX_ROWS];     // 1 = this display row has a grid line
+uint16_t trace_span_buf[SPECTRUM_SPAN_PIXELS] __attribute__ ((aligned (32)));   // composed block for writeRect
+bool     spectrum_trace_reset   = true;     // set by drawSpectrumFrame() to clear the window and redraw the grid
+uint32_t spectrum_draw_ops      = 0;        // draw calls (SPI transactions) the trace took last frame
+uint32_t spectrum_draw_cols     = 0;        // columns that changed last frame
+uint32_t spectrum_draw_pixels   = 0;        // pixels written by writeRect last frame
 int16_t spectrum_scale_maxdB    = 80;       // max value in dB above the spectrum floor we will plot signal values (dB scale max)
 int16_t spectrum_scale_mindB    = 10;       // min value in dB above the spectrum floor we will plot signal values (dB scale max)
 float   fftFrequency            = 0;        // Used to hold the FFT peak signal's frequency. Use a RF sig gen to measure its frequency and spot it on the display, useful for calibration
-float   fftMaxPower             = 0;        // Used to hold the FFT peak power for the strongest signal
+float   fftMaxPower             = 0;        // Used to hold the FFT peak power in dB for the strongest signal
+uint16_t spectrum_zoom          = 1;        // zoom FFT decimation, 1 2 4 8 or 16.  Set from the preset span or the pinch gesture
 
 //function declarations
 void Spectrum_Parm_Generator(int16_t parm_set);
@@ -81,7 +119,22 @@ void spectrum_update(int16_t s);
 void drawSpectrumFrame(uint8_t s);
 void initSpectrum_RA8875(void);
 int16_t colorMap(int16_t val, int16_t color_temp);
-void find_FFT_Max(void);
+void build_FFT_Map(int16_t width);
+static inline float FFT_Bin(float *pout, int16_t col);
+void printSpectrumStats(void);
+void spectrum_draw_trace(struct Spectrum_Parms *ptr);
+void spectrum_trace_clear(struct Spectrum_Parms *ptr);
+void spectrum_trace_labels(struct Spectrum_Parms *ptr);
+uint16_t spectrum_zoom_for_span(float span_Hz, int16_t width);
+void spectrum_zoom_set(uint16_t zoom);
+void spectrum_lag_check(const float *dB);
+
+#include "Waterfall_Palette.h"
+#include "Spectrum_Average.h"
+#include "NoiseFloor.h"
+#include "Spectrum_Peaks.h"
+#include "Spectrum_Recorder.h"
+#include "Host_Stream.h"       // sends the Spectrum_Recorder.h codes
 
 // Globals.  Generally these are only used to set up a new configuration set, or if a setting UI is built and the user is permitted to move and resize things.  
 // These globals are othewise ignored
@@ -106,11 +159,11 @@ int16_t spectrum_height         = 300;      // Total height of the window. Even
 int16_t spectrum_center         = 40;       // Value 0 to 100.  Smaller value = biggger waterfall. Specifies the relative size (%) between the spectrum and waterfall areas by moving the dividing line up or down as a percentage
                                             // Smaller value makes spectrum smaller, waterfall bigger
 int16_t spectrum_width          = 599;      // Total width of window. Even numbers are best. 552 is minimum to fit a full 512 pixel graph plus the min 20 pixel border used on each side. Can be smaller but will reduce graph area
-float   spectrum_span           = 25000;    // UNUSED for now.  Value in Hz.  Ths will be the maximum span shown in the display graphs.  
-                                            // The graph code knows how many Hz per bin so will scale down to magnify a smaller range.
-                                            // Max value and resolutoin (pixels per bin) is dependent on sample frequency
-                                            // 25000 is max for 1024 FFT with 500 bins at 1:1 bins per pixel
-                                            // 12500 would result in 2 pixels per bin. Bad numbers here should be corrected to best fit by the function
+float   spectrum_span           = 25000;    // Value in Hz.  Ths will be the maximum span shown in the display graphs.  
+                                            // The zoom FFT decimates the FFT input by 1, 2, 4, 8 or 16 to get as close as it can without going under.
+                                            // Bins stay 1:1 with pixels so a smaller span also gives finer bins.
+                                            // 25000 is max for 1024 FFT with 512 bins at 1:1 bins per pixel
+                                            // 12500 would be zoom 2 with 25Hz bins. Bad numbers here are corrected to best fit by spectrum_zoom_for_span()
 int16_t spectrum_wf_style       = 2;        // Range 1- 6. Specifies the Waterfall style.
 int16_t spectrum_wf_colortemp   = 90;      // Range 1 - 1023. Specifies the waterfall color temperature to tune it to your liking
 float   spectrum_wf_scale       = 0.7;      // 0.0f to 40.0f. Specifies thew waterfall zoom level - may be redundant when Span is worked out later.
@@ -192,6 +245,8 @@ struct Spectrum_Parms {
 
 struct Spectrum_Parms  Sp_Parms_Custom[PRESETS];
 
+#include "Waterfall_History.h"  // needs struct Spectrum_Parms
+
 //
 //------------------------------------------------------------  Waterfall and Spectrum  Display ------------------------------------------------------
 //         
@@ -206,15 +261,11 @@ void spectrum_update(int16_t s)
 
     struct Spectrum_Parms *ptr = &Sp_Parms_Def[s];
     
-    int16_t blanking = 3;  // used to remove the DC line from the graphs at Fc
-    int16_t pix_o16;
-    int16_t pix_n16;
+    int16_t blanking = SPECTRUM_BLANKING;  // used to remove the DC line from the graphs at Fc
     static int16_t spect_scale_last = 0;
     static int16_t spect_ref_last   = 0;
     static float fftFreq_max        = 0;
-    static float fftPower_pk        = ptr->spect_floor;
-    static float fftPower_pk_last   = ptr->spect_floor;
-    static float sp_floor_avg       = ptr->spect_floor;   // stat out here.
+    static float fftPower_pk_last   = 0;
         
     if (s >= PRESETS) s=PRESETS-1;   // Cycle back to 0
     // See Spectrum_Parm_Generator() below for details on Global values requires and how the woindows variables are used.    
@@ -225,173 +276,97 @@ void spectrum_update(int16_t s)
     
     int16_t i;
     float avg = 0.0;
-    float pixelnew[FFT_SIZE*2];           //  Stores current pixel fopr spectrum portion only
-    static float pixelold[FFT_SIZE*2];    //  Stores copy of current pixel so it can be erased in next update
-
-    float tempfft[FFT_SIZE*2];    
 
     if (myFFT.available()) 
     {         
-        float *pout = myFFT.getData();  // Get pointer to data array of powers, float output[512];
-
-        for (i=0; i< FFT_SIZE/2; i++)        
-            tempfft[i] = -500;
-        for (i=0; i< FFT_SIZE/2; i++)        
-            tempfft[i+FFT_SIZE] = *(pout+i);
-        for (i=FFT_SIZE/2; i< FFT_SIZE; i++)
-            tempfft[i] = *(pout+i);
-        for (i=(FFT_SIZE/2)*3; i< FFT_SIZE*2; i++)        
-            tempfft[i] = -500;
-        pout = tempfft;
-
-        //for (i = 2; i < (ptr->wf_sp_width-2)/2; i++)        // Grab all 512 values.  Need to do at one time since averaging is looking at many values in this array
-        for (i = 2; i < (ptr->wf_sp_width-2); i++)        // Grab all 512 values.  Need to do at one time since averaging is looking at many values in this array
+        uint32_t update_start = micros();
+        displayQueue_sync();    // last frame's waterfall scroll must be done before line_buffer is reused and before drawing directly
+        float *pout = spec_avg_process(myFFT.getData());  // FFT power averaged and converted to dB, in FFT bin order
+
+        if (ptr->wf_sp_width > SPECTRUM_MAX_WIDTH)
+            ptr->wf_sp_width = SPECTRUM_MAX_WIDTH;  // the per column arrays are only this wide
+        if (fft_map_width != ptr->wf_sp_width)
+            build_FFT_Map(ptr->wf_sp_width);    // only when the preset width changes
+        palette_check(ptr->spect_wf_style, ptr->spect_wf_colortemp, ptr->spect_wf_scale);  // only rebuilds the color table if something changed
+
+        // limit the upper and lower dB level to between these ranges (set scale) (User Setting)  Can be limited further by window heights   
+        spectrum_scale_maxdB = 10;     //scale most zoomed in.  This is +10dB above the spectrum floor value.   That value is adjustables and is our refence point set to the bottom line.  
+                                            //Forms the top range of values that line up with the top of our "window" on the FFT data set value range, typiclly -150 to -0dBm possible.
+        spectrum_scale_mindB = 80;   // scale most zoomed out.  This is +80 dB relative to the spectrum_floor so teh top end of our window.  Typically -150 to -0dBm possible range of signal.             
+                // range limit our settings.    This number is added to teh spectrum floor.  The pixel value will be plotted where ever it lands as along as it is in the window.
+        ptr->spect_sp_scale = constrain(ptr->spect_sp_scale, spectrum_scale_maxdB, spectrum_scale_mindB);
+
+        //#define DBG_SPECTRUM_SCALE
+        //#define DBG_SPECTRUM_PIXEL
+        //#define DBG_SPECTRUM_WINDOWLIMITS
+
+        #ifdef DBG_SPECTRUM_SCALE
+        Serial.print("   SC_LIM="); Serial.print(ptr->spect_sp_scale);                  
+        Serial.print("   HT="); Serial.print(ptr->sp_height-4);
+        Serial.print("   SC_FLR="); Serial.println(ptr->spect_floor);                  
+        #endif       
+
+        // One pass over the graph columns reading the FFT output in place through fft_map[].  A 5 value window slides 
+        // along with i so each bin is read once for the spike filter.  The waterfall color and the spectrum pixel 
+        // position for the column are both worked out here.
+        int16_t center = ptr->wf_sp_width/2;
+        float   pix_offset = ptr->sp_bottom_line-2 + ptr->spect_floor;   // spect_floor slides the trace relative to the bottom line
+        float   win[5];
+        nf_hist_clear();                        // noise floor histogram is filled in the loop below
+        for (i = 0; i < 5; i++)
+            win[i] = FFT_Bin(pout, i);          // columns 0 to 4, win[2] is the column being worked on
+
+        for (i = 2; i < (ptr->wf_sp_width-2); i++)
         { 
-            if (isnanf(*(pout+i)) || isinff (*(pout+i)))    // trap float 'NotaNumber NaN" and Infinity values
-            {
-                //tft.print(" FFT Out of Bounds   ");
-                Serial.println("FFT Invalid Data INF or NaN");
-                //Serial.println(*(pout+i));                
-                pixelnew[i] = -200;   // fill in the missing value with somting harmless
-                //pixelnew[i] = myFFT.read(i+1);  // hope the next one is better.
-            }
-            // Now capture Spectrum value for use later
-            pixelnew[i] = *(pout+i);
+            float bin = win[2];
 
-            // Several different ways to process the FFT data for display. Gather up a complete FFT sample to do averaging then go on to update the display with the results
+            // Several different ways to process the FFT data for display
             switch (ptr->spect_wf_style)
             { 
-              case 0: avg = *(pout+((i*16/10)))*0.5 + *(pout+((i-1)*16/10))*0.18 + *(pout+((i-2)*16/10))*0.07 + *(pout+((i+1)*16/10))*0.18 + *(pout+((i+2)*16/10))*0.07;                
-                      //line_buffer[i] = (LPFcoeff * 8 * sqrt (100+(abs(avg)*wf_scale)) + (1 - LPFcoeff) * line_buffer[i]);
-                      line_buffer[i] = (ptr->spect_LPFcoeff * 8 * sqrt (100+(abs(*(pout+i)*ptr->spect_wf_scale))) + (1 - ptr->spect_LPFcoeff) * line_buffer[i]);                      
+              case 0: line_buffer[i] = (ptr->spect_LPFcoeff * 8 * sqrt (100+(abs(bin*ptr->spect_wf_scale))) + (1 - ptr->spect_LPFcoeff) * line_buffer[i]);                      
                       break;
-              case 1: avg = *(pout+((i*16/10)))*0.5 + *(pout+((i-1)*16/10))*0.18 + *(pout+((i-2)*16/10))*0.07 + *(pout+((i+1)*16/10))*0.18 + *(pout+((i+2)*16/10))*0.07;                
+              case 1: avg = FFT_Bin(pout, (i*16/10))*0.5 + FFT_Bin(pout, (i-1)*16/10)*0.18 + FFT_Bin(pout, (i-2)*16/10)*0.07 + FFT_Bin(pout, (i+1)*16/10)*0.18 + FFT_Bin(pout, (i+2)*16/10)*0.07;                
                       line_buffer[i] = (ptr->spect_LPFcoeff * 8 * sqrt (abs(avg)*ptr->spect_wf_scale) + (1 - ptr->spect_LPFcoeff) * line_buffer[i]);
                       line_buffer[i] = colorMap(line_buffer[i]/1000, ptr->spect_wf_colortemp);
-                      Serial.println(line_buffer[i]);    
                       break;                  
-              case 2: avg = line_buffer[i] = colorMap(abs(*(pout+i)) * 1.8 *  ptr->spect_wf_scale, ptr->spect_wf_colortemp);                      
-                      break;
-              case 3: avg = line_buffer[i] = colorMap(abs(*(pout+i)) * 0.4 *  ptr->spect_wf_scale, ptr->spect_wf_colortemp);
-                      break;
-              case 4: avg = line_buffer[i] = colorMap(16000 - abs(*(pout+i)), ptr->spect_wf_colortemp) * ptr->spect_wf_scale;
-                      break;
+              case 2:       // styles 2 and up are precomputed in palette_lut[] by palette_check()
+              case 3:
+              case 4:
               case 5:
-             default: avg = line_buffer[i] = colorMap(abs(*(pout+i)), ptr->spect_wf_colortemp) * ptr->spect_wf_scale * 0.1;                          
+             default: line_buffer[i] = palette_color(bin);
                       break; 
             };
 
             // Fc Blanking
-            if (i >= (ptr->wf_sp_width/2)-blanking  && i <= (ptr->wf_sp_width/2)+blanking+1)
+            if (i >= center-blanking && i <= center+blanking+1)
             {
                 line_buffer[i] = myBLACK;    
-                if (i == (ptr->wf_sp_width)/2)
+                if (i == center)
                     line_buffer[i] = myLT_GREY;  // draw center Fc line in waterfall
             }
-        }   // Done with copying the FFT output array
-
-
-        // Takes a snapshot of the current window without the bottom row. Stores it in Layer 2 then brings it back beginning at the 2nd row. 
-        //    Then write new row data into the missing top row to get a scroll effect using display hardware, not the CPU.
-        //    Documentation for BTE: BTE_move(int16_t SourceX, int16_t SourceY, int16_t Width, int16_t Height, int16_t DestX, int16_t DestY, uint8_t SourceLayer=0, uint8_t DestLayer=0, bool Transparent = false, uint8_t ROP=RA8875_BTEROP_SOURCE, bool Monochrome=false, bool ReverseDir = false);                  
-        tft.BTE_move(ptr->l_graph_edge+1, ptr->wf_top_line+1, ptr->wf_sp_width, ptr->wf_height-4, ptr->l_graph_edge+1, ptr->wf_top_line+2, 1, 2);  // Layer 1 to Layer 2
-        while (tft.readStatus());  // Make sure it is done.  Memory moves can take time.
-        
-        // Move the block back on Layer 1 but place it 1 row down from the top
-        tft.BTE_move(ptr->l_graph_edge+1, ptr->wf_top_line+2, ptr->wf_sp_width, ptr->wf_height-4, ptr->l_graph_edge+1, ptr->wf_top_line+2, 2);  // Move layer 2 up to Layer 1 (1 is assumed).  0 means use current layer.
-        while (tft.readStatus());   // Make sure it is done.  Memory moves can take time.        
-    
-        // draw a periodic time stamp line
-        if (waterfall_timestamp.check() == 1)
-            //tft.drawRect(ptr->l_graph_edge+1, ptr->wf_top_line+1, ptr->wf_sp_width, 1, RA8875_GREEN);  // x start, y start, width, height, colors w x h           
-            tft.drawFastHLine(ptr->l_graph_edge+1, ptr->wf_top_line+2, ptr->wf_sp_width, myLT_GREY);  // x start, y start, width, height, colors w x h           
-        else  // Draw the new line at the top
-            tft.writeRect(ptr->l_graph_edge+1, ptr->wf_top_line+1, ptr->wf_sp_width, 1, (uint16_t*) &line_buffer);  // x start, y start, width, height, array of colors w x h
 
-        //
-        //--------------------------------  Spectrum Window ------------------------------------------
-        //
-        // Done with waterfall, now draw the spectrum section
-        
-        for (i = 2; i < (ptr->wf_sp_width-2); i++)   // Add SPAN control to spread things out here.  Currently 10KHz per side span with 96K sample rate  
-        //for  (i=2; i < (FFT_SIZE)-2; i++)   // Add SPAN control to spread things out here.  Currently 10KHz per side span with 96K sample rate  
-        {       
             // average a few values to smooth the line a bit
-            float avg_pix2 = (pixelnew[i]+pixelnew[i+1])/2;     // avg of 2 bins            
-            float avg_pix5 = (pixelnew[i-2]+pixelnew[i-1]+pixelnew[i]+pixelnew[i+1]+pixelnew[i+2])/5; //avg of 5 bins
-            
-            if (abs(pixelnew[i]) > abs(avg_pix2) * 1.6f)    // compare to a small average to toss out wild spikes
-                pixelnew[i] = avg_pix5;                     // average it out over a wider segment to patch the hole   
+            float avg_pix2 = (win[2]+win[3])/2;                             // avg of 2 bins            
+            float avg_pix5 = (win[0]+win[1]+win[2]+win[3]+win[4])/5;        // avg of 5 bins
+            if (spec_avg_mode == SPEC_AVG_OFF && abs(bin) > abs(avg_pix2) * 1.6f)    // compare to a small average to toss out wild spikes
+                bin = avg_pix5;                     // average it out over a wider segment to patch the hole.  Not needed with time averaging   
 
-            if (i >= (ptr->wf_sp_width/2)-blanking-1 && i <= (ptr->wf_sp_width/2)+blanking+1)
-                pixelnew[i] = -200; 
+            if (i >= center-blanking-1 && i <= center+blanking+1)
+                bin = -200; 
+            else if (i < center-5 || i > center+5)  // skip the DC carrier noise at Fc
+                nf_hist_add(bin);
 
-            //#define DBG_SPECTRUM_SCALE
-            //#define DBG_SPECTRUM_PIXEL
-            //#define DBG_SPECTRUM_WINDOWLIMITS
-            
             #ifdef DBG_SPECTRUM_PIXEL
             Serial.print(" raw =");
-            Serial.print(pixelnew[i],0);
+            Serial.print(bin,0);
             #endif
             
-            // limit the upper and lower dB level to between these ranges (set scale) (User Setting)  Can be limited further by window heights   
-            spectrum_scale_maxdB = 10;     //scale most zoomed in.  This is +10dB above the spectrum floor value.   That value is adjustables and is our refence point set to the bottom line.  
-                                                //Forms the top range of values that line up with the top of our "window" on the FFT data set value range, typiclly -150 to -0dBm possible.
-            spectrum_scale_mindB = 80;   // scale most zoomed out.  This is +80 dB relative to the spectrum_floor so teh top end of our window.  Typically -150 to -0dBm possible range of signal.             
-                    // range limit our settings.    This number is added to teh spectrum floor.  The pixel value will be plotted where ever it lands as along as it is in the window.
-
-            #ifdef DBG_SPECTRUM_SCALE
-            Serial.print("   SC_ORG="); Serial.print(ptr->spect_sp_scale);                  
-            #endif
-        
-            ptr->spect_sp_scale = constrain(ptr->spect_sp_scale, spectrum_scale_maxdB, spectrum_scale_mindB);
-
-            #ifdef DBG_SPECTRUM_SCALE
-            Serial.print("   SC_LIM="); Serial.print(ptr->spect_sp_scale);                  
-            #endif
-            
-            // if the window height changes and becomes less than our possible window pixel height reduce the scale. 
-            //if (abs(spect_floor + ptr->spect_sp_scale) > ptr->sp_height-4)
-            //    ptr->spect_sp_scale = ptr->sp_height -4 - abs(ptr->spect_floor);
-                
-            #ifdef DBG_SPECTRUM_SCALE
-            Serial.print("   SC_HT="); Serial.print(ptr->spect_sp_scale);
-            Serial.print("   HT="); Serial.print(ptr->sp_height-4);
-            Serial.print("   SC_FLR="); Serial.print(ptr->spect_floor);                  
-            #endif       
-            
-            // Plot out pixel in the windows if it lands between the bottom line and top lines        
-            // set the grass floor to just above the botom line.  These are the weakest signals. Typically -90 coming out of the FFT right now
-            
-            // find the strongest signal level in dB while we are here.  
-            if (pixelnew[i] < fftPower_pk)
-            {
-                fftPower_pk = pixelnew[i];
-                //Serial.println(pixelnew[i]);
-            }
-
             // Invert the sign since the display is also inverted, Increasing value = weaker signal strength, they are now going the same direction.  
             // Small value = bigger signal, closer to 0 on the display coordinates
-            pixelnew[i] = abs(pixelnew[i]);
-            
-            // Offset the pixel position relative to the bottom of the window
-            pixelnew[i] += ptr->sp_bottom_line-2 + ptr->spect_floor;     // spect_floor;
-            
-            // Now scale it            
-            //pixelnew[i] = map(pixelnew[i], ptr->spect_floor, ptr->spect_floor+ptr->spect_sp_scale, ptr->sp_bottom_line-2, ptr->sp_top_line+1);    
-            //pixelnew[i] = pixelnew[i] * (ptr->spect_sp_scale/10); // - ptr->spect_floor;
-            pixelnew[i] *= ptr->spect_wf_scale;
-            //Serial.println(pixelnew[i]);
-            // Various averaging  effects.  Ultimately need an averaging feature as well as peak hold but needs calibration to be most useful                            
-            //avg = myFFT.output[(i)*16/10]*0.5 + myFFT.output[(i-1)*16/10]*0.18 + myFFT.output[(i-2)*16/10]*0.07 + myFFT.output[(i+1)*16/10]*0.18 + myFFT.output[(i+2)*16/10]*0.07;
-            //pixelnew[i] = (20*(abs(LPFcoeff * 0.1 * sqrt (abs(avg)*wf_scale) + (1 - LPFcoeff) * pixelold[i])));
-            //pixelnew[i] = ptr->spect_LPFcoeff * 1 * sqrt (abs(avg)*ptr->spect_wf_scale) + (1 - ptr->spect_LPFcoeff) * pixelold[i];
-            //pixelnew[i] = ptr->spect_LPFcoeff * 1 * line_buffer[i] * pixelold[i];
-            //pixelnew[i] = avg;
-            
+            // Offset the pixel position relative to the bottom of the window then scale it
+            pixelnew[i] = (abs(bin) + pix_offset) * ptr->spect_wf_scale;
+
             #ifdef DBG_SPECTRUM_WINDOWLIMITS
-            //Serial.print("  win-ht:"); Serial.print(ptr->sp_height-4);
             Serial.print("  top line="); Serial.print(ptr->sp_top_line+2);
             #endif
             
@@ -403,127 +378,38 @@ void spectrum_update(int16_t s)
             Serial.print("  bottom line="); Serial.print(ptr->sp_bottom_line-2);
             #endif
 
-            //#define DBG_SHOW_OVR
-            #if defined(DBG_SPECTRUM_WINDOWLIMITS) || defined(DBG_SPECTRUM_PIXEL) || defined(DBG_SPECTRUM_SCALE) || defined(DBG_SHOW_OVR)
-            if (pixelnew[i] < ptr->sp_top_line+2)        
-            { Serial.print(" !!OVR!! = ");    Serial.println(pixelnew[i] - ptr->sp_top_line+2,0);}
-            if (pixelnew[i] > ptr->sp_bottom_line-2)        
-            { Serial.print(" !!UNDER!! = ");  Serial.println(pixelnew[i] - ptr->sp_top_line+2,0);}          
-            #endif
-            
-            pix_n16 = (int16_t) round(pixelnew[i]);  // convert float to uint16_t to match the draw functions type
-            pix_o16 = (int16_t) round(pixelold[i]);
+            // slide the window along one column
+            win[0] = win[1]; win[1] = win[2]; win[2] = win[3]; win[3] = win[4];
+            win[4] = FFT_Bin(pout, i+3);
+        }   // Done with the FFT output array
 
-            // Linit access to the spectrum box to control misbehaved pixel and bar draws
-            tft.setActiveWindow(ptr->l_graph_edge+1, ptr->r_graph_edge-1, ptr->sp_top_line+2, ptr->sp_bottom_line-2);
-            
-            //
-            //------------------------ Code below is writing only in the active spectrum window ----------------------
-            //
-
-            if (i < ptr->c_graph-5 || i > ptr->c_graph+5)   // blank the DC carrier noise at Fc
-            {    
-                if ((i < ptr->wf_sp_width-2) && (pix_n16 > ptr->sp_top_line+2) && (pix_n16 < ptr->sp_bottom_line-2)  ) // will blank out the center spike
-                {   
-                    if (pixelnew[i] <  ptr->sp_bottom_line + 40) // arbitrary cutoff to look for low level avg to act as AGC for noise floor adjustment.
-                    {
-                        sp_floor_avg += pixelnew[i];             // accumulate the next low sig level value
-                        sp_floor_avg /= ptr->wf_sp_width-2;     // first run through wil be off but rest will be OK after
-                        sp_floor_avg -= (sp_floor_avg - ptr-> sp_bottom_line-2)/2;
-                        //Serial.println(sp_floor_avg);
-                    }
-                    if (ptr->spect_dot_bar_mode == 0)   // BAR Mode 
-                    {
-                        if (pix_o16 != pix_n16) 
-                        {                               
-                            if (pix_n16 > ptr->sp_top_line+2 && pix_n16 < ptr->sp_bottom_line-2)
-                            {
-                                //common way: draw bars                                                                        
-                                tft.drawFastVLine(ptr->l_graph_edge+i, pix_o16, ptr->sp_bottom_line-pix_o16,    myBLACK); // GREEN);
-                                //tft.drawFastVLine(ptr->l_graph_edge+i, ptr->sp_top_line, pix_o16,    myBLACK); // BLACK);
-
-                                tft.drawFastVLine(ptr->l_graph_edge+i, pix_n16, ptr->sp_bottom_line-pix_n16,    myYELLOW); //BLACK);                         
-                                //tft.drawFastVLine(ptr->l_graph_edge+i, ptr->sp_top_line, pix_n16,    myBLACK); //BLACK);
-                                pixelold[i] = pixelnew[i];
-                            }
-                        }
-                    }
-                    else if (ptr->spect_dot_bar_mode == 1)  // DOT mode
-                    {   // DOT Mode
-                        // alternate way: draw pixels
-                        // only plot pixel, if at a new position
-                        if (pix_o16 != pix_n16) 
-                        {
-                            if (pix_n16 > ptr->sp_top_line+2 && pix_n16 < ptr->sp_bottom_line-2)
-                            {
-                                /*
-                                tft.drawPixel(ptr->l_graph_edge+1+i, pix_o16, myBLACK); // delete old pixel
-                                tft.drawPixel(ptr->l_graph_edge+1+i, pix_n16, myYELLOW); // write new pixel    
-                                                           
-                                // Double up the dots to make the spectrum more dense and visible                                
-                                tft.drawPixel(ptr->l_graph_edge+1+i, pix_o16-1, myBLACK); // delete old pixel
-                                tft.drawPixel(ptr->l_graph_edge+1+i, pix_n16-1, myYELLOW); // write new pixel  
-                                
-                                // Triple up the dots to make the spectrum more dense and visible                                
-                                tft.drawPixel(ptr->l_graph_edge+1+i, pix_o16-2, myBLACK); // delete old pixel
-                                tft.drawPixel(ptr->l_graph_edge+1+i, pix_n16-2, myYELLOW); // write new pixel  
-                                */
-                                //Serial.println(tft.grandient( (uint16_t) pix_n16));
-                                // Experimetnal  - draw a 2 pixel wide segment fopr more visibility
-                                tft.drawFastHLine(ptr->l_graph_edge+1+i, pix_o16, 2,   myBLACK); //BLACK);                         
-                                tft.drawFastHLine(ptr->l_graph_edge+1+i, pix_n16, 2,   myYELLOW); //BLACK);
-                                //tft.drawFastVLine(ptr->l_graph_edge+1+i, pix_o16-1, 2,   myBLACK); //BLACK);                         
-                                //tft.drawFastVLine(ptr->l_graph_edge+1+i, pix_n16-1, 2,   myYELLOW); //BLACK);                                
-
-                                pixelold[i] = pixelnew[i]; 
-
-                            }
-                        }
-                    }
-                    // Under Dev - attempting to draw connecting line between dots  Lines are drawn all over for some reason TBD.
-                    else if (pix_o16 != pix_n16) 
-                    { 
-                        //if ((pix_n16 > ptr->sp_top_line+10 && pix_n16 < ptr->sp_bottom_line-10) && 
-                         //       (pix_o16 > ptr->sp_top_line+10 && pix_o16 < ptr->sp_bottom_line-10))
-                        //{
-                            //Serial.println(pixelnew[i]);
-
-                            tft.drawLine(ptr->l_graph_edge+1+i,    (int16_t) pixelold[i-1],    ptr->l_graph_edge+1+i,   (int16_t) pixelold[i], myBLACK); // BLACK);                    
-                            tft.drawLine(ptr->l_graph_edge+1+i,    (int16_t) pixelnew[i-1],    ptr->l_graph_edge+1+i,   (int16_t) pixelnew[i], myYELLOW); // GREEN);                    
-                            
-                            //tft.drawLine(ptr->l_graph_edge+1+i,  (int16_t) pixelold[i-1], myBLACK); // delete old pixel
-                            //tft.drawLine(ptr->l_graph_edge+1+i,  (int16_t) pixelnew[i-1], myYELLOW); // write new pixel
-                            //tft.drawLine(ptr->l_graph_edge+1+i,  pix_o16,     myBLACK); // delete old pixel                             
-                            //tft.drawLine(ptr->l_graph_edge+1+i,  pix_n16,     myYELLOW); // write new pixel
-                            pixelold[i] = pixelnew[i]; 
-                        //}
-                    }
-                }
-            }
-            
-            // Draw Grid Lines
-            if (i == (ptr->wf_sp_width-2)/2)
-            {
-            // draw a grid line for XX dB level             
-                tft.setTextColor(myLT_GREY);
-                tft.setFont(Arial_10);
-                
-                int grid_step = ptr->spect_sp_scale;
-                for (int16_t j = grid_step; j < ptr->sp_height-10; j+=grid_step)
-                {        
-                    if (pix_n16 > ptr->sp_top_line+j+2 && pix_n16 < ptr->sp_bottom_line-2)
-                    {    
-                        // draw bottom most grid line
-                        tft.drawFastHLine(ptr->l_graph_edge+24, ptr->sp_bottom_line-j,   ptr->wf_sp_width-24,    myLT_GREY); // GREEN);
-                        // write the scale value for the grid line
-                        tft.setCursor(ptr->l_graph_edge+5, ptr->sp_bottom_line-j-5);
-                        tft.print(j); 
-                    }
-                }
-                // redraw the center line
-                //tft.drawFastVLine(ptr->c_graph, ptr->sp_top_line, ptr->sp_height-2 , myLT_GREY); //myLT_GREY);  
-            }
+        // Track the noise floor and the top of the signals for this band.  In auto mode put the floor
+        // NF_FLOOR_MARGIN percent up from the bottom of the box and size the scale to reach the strongest signals.
+        // The scale moves in whole grid steps with hysteresis, each change redraws the grid.
+        nf_update(Freq);
+        if (nf_auto && nf_band[nf_band_now].valid)
+        {
+            float floor_pix = ptr->sp_bottom_line-2 - (ptr->sp_height * NF_FLOOR_MARGIN/100);
+            ptr->spect_floor = floor_pix / ptr->spect_wf_scale + nf_floor_dB() - (ptr->sp_bottom_line-2);   // pixelnew[] math solved for spect_floor
+            ptr->spect_sp_scale = nf_scale(ptr->spect_sp_scale, nf_band[nf_band_now].top_dB - nf_floor_dB() + 10,
+                                           spectrum_scale_maxdB, spectrum_scale_mindB);
         }
+
+        //
+        //--------------------------------  Spectrum Window ------------------------------------------
+        //
+        // Waterfall line is ready, now draw the spectrum section.  The waterfall scroll is queued at the end.
+        
+        // Limit access to the spectrum box to control misbehaved pixel and bar draws.  Set once for the whole frame.
+        tft.setActiveWindow(ptr->l_graph_edge+1, ptr->r_graph_edge-1, ptr->sp_top_line+2, ptr->sp_bottom_line-2);
+        
+        //
+        //------------------------ Code below is writing only in the active spectrum window ----------------------
+        //
+
+        // Compare the new trace to what is on screen and write only the changed spans
+        spectrum_draw_trace(ptr);
+
         tft.setActiveWindow();  // restore access to whole screen
         //
         //------------------------ Code above is writing only in the active spectrum window ----------------------
@@ -534,24 +420,28 @@ void spectrum_update(int16_t s)
         tft.setTextColor(myLT_GREY);
         tft.setFont(Arial_12);
 
-        find_FFT_Max();   // get new frequency and power values for streongest signal 
-        
-        // Calculate and print the power of the strongest signal if possible
-        //if (!isnanf(fftMaxPower) && !isinff(fftMaxPower) && 
-        if (fftPower_pk != fftPower_pk_last)  // filter out invalid data and DC noise
+        // Strongest signals on screen.  The top one goes in the P: and F: readouts.
+        if (spec_peaks_find(pout, ptr->wf_sp_width/2, nf_floor_dB()) > 0)
+        {
+            fftMaxPower  = spec_peaks[0].dB;
+            fftFrequency = spec_peaks[0].freq_Hz;
+        }
+        spectrum_lag_check(pout);
+
+        // Print the power of the strongest signal if possible
+        if (spec_peak_count > 0 && (int16_t) fftMaxPower != (int16_t) fftPower_pk_last)
         {           
-            //Serial.print("Ppk="); Serial.println((fftPower_pk+fftPower_pk_last)/2-ptr->spect_sp_scale);       
-            tft.fillRect(ptr->l_graph_edge+39,         ptr->sp_txt_row, 50, 13, RA8875_BLACK);  // clear the text space
+            tft.fillRect(ptr->l_graph_edge+39,         ptr->sp_txt_row+30, 50, 13, RA8875_BLACK);  // clear the text space
             tft.setCursor(ptr->l_graph_edge+40,        ptr->sp_txt_row+30); // Write the legend
             tft.print("P: "); 
             tft.setCursor(ptr->l_graph_edge+54,        ptr->sp_txt_row+30);  // write the value
-            tft.print((fftPower_pk+fftPower_pk_last)/2-ptr->spect_sp_scale,0);
-            fftPower_pk_last = fftPower_pk;        
+            tft.print(fftMaxPower,0);
+            fftPower_pk_last = fftMaxPower;        
             fftFreq_timestamp.reset();  // reset the timer since we have new good data
         }
                 
-        // Calculate and print the frequency of the strongest signal if possible 
-        if (!isnanf(fftFrequency) && !isinff(fftFrequency) && fftFrequency > 80.0f && fftFreq_max != fftFrequency)  // filter out invalid data and DC noise
+        // Print the frequency of the strongest signal if possible 
+        if (spec_peak_count > 0 && fftFreq_max != fftFrequency)
         {
             //Serial.print("Freq="); Serial.println(fftFrequency, 3); 
             tft.fillRect(ptr->l_graph_edge+99,    ptr->sp_txt_row+30, 90, 13, RA8875_BLACK);
@@ -566,7 +456,7 @@ void spectrum_update(int16_t s)
         
         if (fftFreq_timestamp.check() == 1)   // clear after no recent data
         {
-            fftPower_pk = ptr->spect_floor;
+            fftPower_pk_last = 0;
             fftFreq_max = 0.0f;
         }    
         
@@ -589,9 +479,8 @@ void spectrum_update(int16_t s)
             tft.fillRect( ptr->l_graph_edge+(ptr->wf_sp_width/2)+114, ptr->sp_txt_row+30, 32, 13, RA8875_BLACK);
             tft.setCursor(ptr->l_graph_edge+(ptr->wf_sp_width/2)+114, ptr->sp_txt_row+30);
             //tft.print(ptr->spect_floor);
-            tft.print(sp_floor_avg,0);
-            //spect_ref_last = ptr->spect_floor;   // update memory
-            spect_ref_last = sp_floor_avg;   // update memory
+            tft.print(nf_floor_dB(),0);         // noise floor in dB
+            spect_ref_last = ptr->spect_floor;   // update memory
         }    
             
         tft.setTextColor(myLT_GREY);
@@ -599,7 +488,7 @@ void spectrum_update(int16_t s)
 
         tft.fillRect( ptr->l_graph_edge, ptr->sp_txt_row, 80, 13, RA8875_BLACK);
         tft.setCursor(ptr->l_graph_edge, ptr->sp_txt_row);
-        tft.print( (float) (Freq/1000) - (ptr->wf_sp_width*fft_bin_size/1000),1);       // Write left side of graph Freq
+        tft.print( (float) (Freq/1000) - (ptr->wf_sp_width/2*fft_bin_size/1000),1);       // Write left side of graph Freq
         
         tft.fillRect( ptr->c_graph-27, ptr->sp_txt_row, 80, 13, RA8875_BLACK);
         tft.setCursor(ptr->c_graph-27, ptr->sp_txt_row);
@@ -607,7 +496,7 @@ void spectrum_update(int16_t s)
         
         tft.fillRect( ptr->r_graph_edge - 60, ptr->sp_txt_row, 80, 13, RA8875_BLACK);
         tft.setCursor(ptr->r_graph_edge - 60, ptr->sp_txt_row);
-        tft.print( (float) (Freq/1000) + (ptr->wf_sp_width*fft_bin_size/1000),1);  // Write right side of graph Freq
+        tft.print( (float) (Freq/1000) + (ptr->wf_sp_width/2*fft_bin_size/1000),1);  // Write right side of graph Freq
         
         // Write the dB range of the window 
         tft.setTextColor(myLT_GREY);
@@ -616,9 +505,298 @@ void spectrum_update(int16_t s)
         tft.print("H:   ");  // actual value is updated elsewhere
         tft.setCursor(ptr->r_graph_edge-28, ptr->sp_top_line+8);
         tft.print(ptr->sp_height);
+
+        //
+        //--------------------------------  Waterfall Scroll ------------------------------------------
+        //
+        // Takes a snapshot of the current window without the bottom row. Stores it in Layer 2 then brings it back beginning at the 2nd row. 
+        //    Then write new row data into the missing top row to get a scroll effect using display hardware, not the CPU.
+        //    Documentation for BTE: BTE_move(int16_t SourceX, int16_t SourceY, int16_t Width, int16_t Height, int16_t DestX, int16_t DestY, uint8_t SourceLayer=0, uint8_t DestLayer=0, bool Transparent = false, uint8_t ROP=RA8875_BTEROP_SOURCE, bool Monochrome=false, bool ReverseDir = false);                  
+        //    These go through the display queue.  It waits for each move to finish between passes of loop() instead of spinning here.
+        //    While the view is scrolled back in the waterfall history the live waterfall is paused, the history keeps recording.
+        bool stamp = (waterfall_timestamp.check() == 1);
+        wf_hist_add(pout, stamp);
+        spec_rec_add(pout);
+        stream_fft_add(pout);
+        if (wf_hist_offset == 0)
+        {
+            dq_BTE_move(ptr->l_graph_edge+1, ptr->wf_top_line+1, ptr->wf_sp_width, ptr->wf_height-4, ptr->l_graph_edge+1, ptr->wf_top_line+2, 1, 2);  // Layer 1 to Layer 2
+            
+            // Move the block back on Layer 1 but place it 1 row down from the top
+            dq_BTE_move(ptr->l_graph_edge+1, ptr->wf_top_line+2, ptr->wf_sp_width, ptr->wf_height-4, ptr->l_graph_edge+1, ptr->wf_top_line+2, 2, 0);  // Move layer 2 up to Layer 1 (1 is assumed).  0 means use current layer.
+        
+            // draw a periodic time stamp line
+            if (stamp)
+                dq_drawFastHLine(ptr->l_graph_edge+1, ptr->wf_top_line+2, ptr->wf_sp_width, myLT_GREY);  // x start, y start, width, height, colors w x h           
+            else  // Draw the new line at the top.  line_buffer is not touched again until the next frame has synced the queue.
+                dq_writeRect(ptr->l_graph_edge+1, ptr->wf_top_line+1, ptr->wf_sp_width, 1, (uint16_t*) line_buffer);  // x start, y start, width, height, array of colors w x h
+        }
+
+        spectrum_update_us = micros() - update_start;
+        if (spectrum_update_us > spectrum_update_max_us)
+            spectrum_update_max_us = spectrum_update_us;
     }  
 }
 //
+//____________________________________________________FFT Bin Mapping _____________________________________
+//
+// Build the graph column to FFT bin table.  The FFT output has DC at bin 0 with the negative frequencies in 
+// the upper half, so the graph center column gets bin 0, columns left of center get the upper half bins and 
+// columns right of center get the lower half bins.  Columns wider than the FFT get -1 and read as no signal.
+void build_FFT_Map(int16_t width)
+{
+    int16_t center = width/2;
+    
+    for (int16_t i = 0; i < SPECTRUM_MAX_WIDTH; i++)
+    {
+        int16_t c = i - center;
+        if (i < width && c >= -FFT_SIZE/2 && c < FFT_SIZE/2)
+            fft_map[i] = c & (FFT_SIZE-1);
+        else
+            fft_map[i] = -1;
+    }
+    fft_map_width = width;
+}
+//
+// Read the FFT output for a graph column through fft_map[].  Columns with no bin return -500 (the old tempfft 
+// fill value) and NaN or Inf values are replaced with something harmless and counted.
+static inline float FFT_Bin(float *pout, int16_t col)
+{
+    if (col < 0 || col >= SPECTRUM_MAX_WIDTH || fft_map[col] < 0)
+        return -500;
+    float v = pout[fft_map[col]];
+    if (isnanf(v) || isinff(v))  // trap float 'NotaNumber NaN" and Infinity values
+    {
+        spectrum_bad_bins++;
+        return -200;
+    }
+    return v;
+}
+//
+// Spectrum timing report for the console 'C' command
+void printSpectrumStats(void)
+{
+    Serial.print("Spectrum Update Time (uS): ");
+    Serial.print(spectrum_update_us);
+    Serial.print(", Max: ");
+    Serial.print(spectrum_update_max_us);
+    Serial.print(", Bad FFT Bins: ");
+    Serial.print(spectrum_bad_bins);
+    Serial.print(", Palette Build (uS): ");
+    Serial.println(palette_build_us);
+    printSpecAvgStats();
+    printNoiseFloorStats();
+    printWfHistStats();
+    printSpecRecStats();
+    Serial.print("Spectrum Trace Draw Ops: ");
+    Serial.print(spectrum_draw_ops);
+    Serial.print(", Changed Columns: ");
+    Serial.print(spectrum_draw_cols);
+    Serial.print(", Pixels Written: ");
+    Serial.println(spectrum_draw_pixels);
+    spectrum_update_max_us = 0;
+}
+//
+//____________________________________________________Spectrum Trace Renderer _____________________________________
+//
+// Display row for graph column k, or -1 if nothing is drawn for it.  BAR mode clamps strong signals to the top.
+static int16_t trace_row(struct Spectrum_Parms *ptr, int16_t k, bool clamp_top)
+{
+    if (k < 2 || k >= ptr->wf_sp_width-2)
+        return -1;
+    if (k >= ptr->wf_sp_width/2-5 && k <= ptr->wf_sp_width/2+5)   // blank the DC carrier noise at Fc
+        return -1;
+
+    int16_t y = (int16_t) round(pixelnew[k]);
+    if (y >= ptr->sp_bottom_line-2)
+        return -1;
+    if (y <= ptr->sp_top_line+2)
+        return (clamp_top) ? ptr->sp_top_line+3 : -1;
+    return y;
+}
+//
+static inline bool trace_lit(struct Trace_Column *c, int16_t row)
+{
+    return (row >= c->a0 && row <= c->a1) || (row >= c->b0 && row <= c->b1);
+}
+//
+static inline bool trace_same(struct Trace_Column *a, struct Trace_Column *b)
+{
+    return a->a0 == b->a0 && a->a1 == b->a1 && a->b0 == b->b0 && a->b1 == b->b1;
+}
+//
+// Rows touched by a changed column, the union of what is there now and what will be there
+static void trace_band(struct Trace_Column *o, struct Trace_Column *n, int16_t *lo, int16_t *hi)
+{
+    *lo = SPECTRUM_MAX_ROWS;
+    *hi = -1;
+    struct Trace_Column *c[2] = {o, n};
+    for (int16_t j = 0; j < 2; j++)
+    {
+        if (c[j]->a0 <= c[j]->a1) { *lo = min(*lo, c[j]->a0); *hi = max(*hi, c[j]->a1); }
+        if (c[j]->b0 <= c[j]->b1) { *lo = min(*lo, c[j]->b0); *hi = max(*hi, c[j]->b1); }
+    }
+}
+//
+// Compose screen columns x0 to x1, rows lo to hi, from the new trace plus grid and center lines, then write it in one go
+static void trace_write_span(struct Spectrum_Parms *ptr, int16_t x0, int16_t x1, int16_t lo, int16_t hi)
+{
+    int16_t  w = x1 - x0 + 1;
+    int16_t  c_line = ptr->wf_sp_width/2+1;     // same column drawSpectrumFrame() puts the center line on
+    uint16_t *p = trace_span_buf;
+
+    for (int16_t row = lo; row <= hi; row++)
+    {
+        for (int16_t x = x0; x <= x1; x++)
+        {
+            if (trace_lit(&trace_new[x], row))
+                *p++ = myYELLOW;
+            else if (x == c_line || (trace_grid_row[row] && x >= SPECTRUM_GRID_X))
+                *p++ = myLT_GREY;
+            else
+                *p++ = myBLACK;
+        }
+    }
+    tft.writeRect(ptr->l_graph_edge+x0, lo, w, hi-lo+1, trace_span_buf);
+    
+    memcpy(&trace_drawn[x0], &trace_new[x0], w*sizeof(struct Trace_Column));
+    spectrum_draw_ops++;
+    spectrum_draw_pixels += w*(hi-lo+1);
+}
+//
+// Draw the spectrum trace.  Call with the active window already set to the spectrum box.
+// BAR mode lights column k from its row to the bottom.  DOT mode lights 2 pixels wide starting 1 column right of k.  
+// LINE mode joins the rows of columns k-1 and k with a vertical segment 1 column right of k.
+void spectrum_draw_trace(struct Spectrum_Parms *ptr)
+{
+    static struct Spectrum_Parms *ptr_last = NULL;
+    static int16_t scale_last = -1;
+    static int16_t mode_last  = -1;
+    int16_t  w = ptr->wf_sp_width;
+    int16_t  y, y0;
+    int16_t  x0 = -1, x1 = 0, lo = 0, hi = 0;
+    bool     labels_hit = false;
+
+    spectrum_draw_ops    = 0;
+    spectrum_draw_cols   = 0;
+    spectrum_draw_pixels = 0;
+
+    if (spectrum_trace_reset || ptr != ptr_last || ptr->spect_sp_scale != scale_last || ptr->spect_dot_bar_mode != mode_last)
+    {
+        spectrum_trace_clear(ptr);
+        ptr_last   = ptr;
+        scale_last = ptr->spect_sp_scale;
+        mode_last  = ptr->spect_dot_bar_mode;
+    }
+
+    // Work out the new lit rows for every screen column
+    for (int16_t x = 0; x < w; x++)
+    {
+        struct Trace_Column *c = &trace_new[x];
+        c->a0 = c->b0 = 1;      // empty
+        c->a1 = c->b1 = 0;
+        if (x == 0)             // left edge belongs to the frame
+            continue;
+        switch (ptr->spect_dot_bar_mode)
+        {
+            case 0: y = trace_row(ptr, x, true);    // BAR
+                    if (y >= 0) { c->a0 = y; c->a1 = ptr->sp_bottom_line-2; }
+                    break;
+            case 1: y = trace_row(ptr, x-1, false); // DOT
+                    if (y >= 0) c->a0 = c->a1 = y;
+                    y = trace_row(ptr, x-2, false);
+                    if (y >= 0) c->b0 = c->b1 = y;
+                    break;
+           default: y  = trace_row(ptr, x-1, false); // LINE
+                    y0 = trace_row(ptr, x-2, false);
+                    if (y >= 0 && y0 >= 0) { c->a0 = min(y, y0); c->a1 = max(y, y0); }
+                    else if (y >= 0) c->a0 = c->a1 = y;
+                    break;
+        }
+    }
+
+    // Walk the changed columns.  Add each to the open span if one bigger writeRect costs less than two.
+    for (int16_t x = 1; x < w; x++)
+    {
+        int16_t blo, bhi;
+
+        if (trace_same(&trace_new[x], &trace_drawn[x]))
+            continue;
+        spectrum_draw_cols++;
+        trace_band(&trace_drawn[x], &trace_new[x], &blo, &bhi);
+        if (x0 >= 0)
+        {
+            int16_t  mlo = min(lo, blo), mhi = max(hi, bhi);
+            uint32_t merged   = (x - x0 + 1) * (mhi - mlo + 1);
+            uint32_t separate = (x1 - x0 + 1) * (hi - lo + 1) + (bhi - blo + 1) + SPECTRUM_SPAN_MERGE;
+            if (merged <= separate && merged <= SPECTRUM_SPAN_PIXELS)
+            {
+                x1 = x; lo = mlo; hi = mhi;
+                continue;
+            }
+            trace_write_span(ptr, x0, x1, lo, hi);
+            if (x0 < SPECTRUM_GRID_X)
+                labels_hit = true;
+        }
+        x0 = x1 = x; lo = blo; hi = bhi;
+    }
+    if (x0 >= 0)
+    {
+        trace_write_span(ptr, x0, x1, lo, hi);
+        if (x0 < SPECTRUM_GRID_X)
+            labels_hit = true;
+    }
+    if (labels_hit)     // the trace went through the grid labels
+        spectrum_trace_labels(ptr);
+}
+//
+// Clear the spectrum box, draw the grid and center lines, and mark nothing as drawn
+void spectrum_trace_clear(struct Spectrum_Parms *ptr)
+{
+    tft.fillRect(ptr->l_graph_edge+1, ptr->sp_top_line+1, ptr->wf_sp_width, ptr->sp_height-2, myBLACK);
+    tft.drawFastVLine(ptr->l_graph_edge+ptr->wf_sp_width/2+1, ptr->sp_top_line+1, ptr->sp_height, myLT_GREY);
+    spectrum_draw_ops += 2;
+
+    memset(trace_grid_row, 0, sizeof(trace_grid_row));
+    int grid_step = ptr->spect_sp_scale;
+    for (int16_t j = grid_step; j < ptr->sp_height-10; j+=grid_step)
+    {
+        int16_t row = ptr->sp_bottom_line-j;
+        if (row > ptr->sp_top_line+2 && row < SPECTRUM_MAX_ROWS)
+        {
+            trace_grid_row[row] = 1;
+            tft.drawFastHLine(ptr->l_graph_edge+SPECTRUM_GRID_X, row, ptr->wf_sp_width-SPECTRUM_GRID_X, myLT_GREY);
+            spectrum_draw_ops++;
+        }
+    }
+    spectrum_trace_labels(ptr);
+
+    for (int16_t x = 0; x < SPECTRUM_MAX_WIDTH; x++)
+    {
+        trace_drawn[x].a0 = trace_drawn[x].b0 = 1;
+        trace_drawn[x].a1 = trace_drawn[x].b1 = 0;
+    }
+    spectrum_trace_reset = false;
+}
+//
+// Write the dB scale value next to each grid line
+void spectrum_trace_labels(struct Spectrum_Parms *ptr)
+{
+    tft.setTextColor(myLT_GREY);
+    tft.setFont(Arial_10);
+    int grid_step = ptr->spect_sp_scale;
+    for (int16_t j = grid_step; j < ptr->sp_height-10; j+=grid_step)
+    {
+        int16_t row = ptr->sp_bottom_line-j;
+        if (row > ptr->sp_top_line+2 && row < SPECTRUM_MAX_ROWS)
+        {
+            tft.setCursor(ptr->l_graph_edge+5, row-5);
+            tft.print(j);
+            spectrum_draw_ops++;
+        }
+    }
+}
+//
 //____________________________________________________Color Mapping _____________________________________
 //       
 
@@ -666,6 +844,8 @@ void drawSpectrumFrame(uint8_t s)
     struct Spectrum_Parms *ptr = &Sp_Parms_Def[s];
     
     tft.fillRect(ptr->spect_x, ptr->spect_y, ptr->spect_width, ptr->spect_height, myBLACK);  // x start, y start, width, height, array of colors w x h
+    spectrum_trace_reset = true;    // spectrum_update() must redraw the grid and forget the old trace
+    spectrum_zoom_set(spectrum_zoom_for_span(ptr->spect_span, ptr->wf_sp_width));   // zoom FFT to the preset span
     //tft.drawRect(ptr->spect_x, ptr->spect_y, ptr->spect_width, ptr->spect_height, myBLUE);  // x start, y start, width, height, array of colors w x h
     
     // This section updates the globals from the chosen preset
@@ -681,6 +861,7 @@ void drawSpectrumFrame(uint8_t s)
     //These 2 lines are used to test alignments, normally leave them commented out.  The scroll region is over the same area
     tft.drawRect(ptr->l_graph_edge,    ptr->wf_top_line,    ptr->wf_sp_width+2,   ptr->wf_height,    myLT_GREY);  // x start, y start, width, height, array of colors w x h
     tft.fillRect(ptr->l_graph_edge+1,  ptr->wf_top_line+1,  ptr->wf_sp_width,     ptr->wf_height-2,  myBLACK);
+    wf_hist_repaint(ptr);   // put the waterfall back from the history at the new size and place
     // Set the scroll region for the watefall.  We only need to write 1 new top line and block shift the rest down 1.
     //tft.setScrollWindow(l_graph_edge, r_graph_edge, wf_top_line+1, wf_bottom_line-1);  //Specifies scrolling activity area   XL, XR, Ytop, Ybottom
   
@@ -706,6 +887,75 @@ void drawSpectrumFrame(uint8_t s)
     tft.drawLine(ptr->l_graph_edge+ptr->wf_sp_width-1,        ptr->wf_bottom_line,   ptr->l_graph_edge+ptr->wf_sp_width-1,       ptr->wf_tick_row, myLT_GREY);    
 }
 
+//
+//--------------------------------------------------  Zoom FFT ------------------------------------------------------------------------
+//
+// The graph shows width bins 1:1 so the span is width * sample rate / (zoom * FFT_SIZE).  Pick the largest
+// zoom that still shows at least span_Hz.
+uint16_t spectrum_zoom_for_span(float span_Hz, int16_t width)
+{
+    uint16_t zoom = 1;
+
+    while (zoom < ZOOM_MAX_FACTOR && width * sample_rate_Hz / (zoom * 2 * FFT_SIZE) >= span_Hz)
+        zoom *= 2;
+    return zoom;
+}
+//
+// Set the zoom FFT decimation and the bin size that goes with it.  FFT size and cost stay the same at any zoom.
+void spectrum_zoom_set(uint16_t zoom)
+{
+    AudioNoInterrupts();
+    FFT_Zoom.begin(zoom, sample_rate_Hz);
+    AudioInterrupts();
+    spectrum_zoom = FFT_Zoom.getFactor();
+    spec_avg_reset();       // old frames are for the other span
+    fft_bin_size  = sample_rate_Hz / (spectrum_zoom * FFT_SIZE);
+    spectrum_span = Sp_Parms_Def[spectrum_preset].wf_sp_width * fft_bin_size;
+    Sp_Parms_Def[spectrum_preset].spect_span = spectrum_span;
+    Serial.print("Zoom x"); Serial.print(spectrum_zoom);
+    Serial.print("  Span(Hz) = "); Serial.print(spectrum_span,0);
+    Serial.print("  Bin(Hz) = "); Serial.println(fft_bin_size,2);
+}
+//
+//--------------------------------------------------  I2S lag detection ---------------------------------------------------------------
+//
+// While RX_PreProc is looking for the Teensy I2S one sample IQ lag, feed it the strongest line found this frame
+// and its mirror image bin.  Two bins per frame instead of an FFT per audio block.  Only valid when the
+// spectrum is looking at the IQ input with no zoom, so the image lands on the mirror bin about 0Hz.
+// IQ_Balance is held off while this runs, it would otherwise tune out the very image being looked for.
+// With no usable signal for LAG_MAX_IDLE_FRAMES the search gives up and leaves the lag correction off.
+#define LAG_MAX_IDLE_FRAMES     500         // about 30 seconds of frames at the normal waterfall rate
+void spectrum_lag_check(const float *dB)
+{
+    static uint16_t idle_frames = 0;
+
+    if (!RX_PreProc.getAutoI2SerrorDetectionStatus())
+        return;
+    if (spec_peak_count == 0 || FFT_Source != 0 || spectrum_zoom != 1)
+    {
+        if (++idle_frames > LAG_MAX_IDLE_FRAMES)
+        {
+            RX_PreProc.stopAutoI2SerrorDetection();
+            Serial.println("I2S Lag Detection: no strong signal, giving up");
+        }
+    }
+    else
+    {
+        idle_frames = 0;
+        int16_t k = spec_peaks[0].bin;
+        if (RX_PreProc.checkImage(dB[k & (FFT_SIZE-1)], dB[(-k) & (FFT_SIZE-1)]))
+            spec_avg_reset();   // frames from before the change still carry the old image
+    }
+
+    if (!RX_PreProc.getAutoI2SerrorDetectionStatus())
+    {
+        Serial.print("I2S Lag Correction = ");
+        Serial.println(RX_PreProc.getI2SerrorCompensation());
+        IQ_Balance.reset();
+        IQ_Balance.enable(true);
+    }
+}
+
 //
 //--------------------------------------------------  Spectrum init ------------------------------------------------------------------------
 //
@@ -758,11 +1008,10 @@ void Spectrum_Parm_Generator(int16_t parm_set)
 //  int16_t spectrum_center         // Value 0 to 100.  Smaller value = biggger waterfall. Specifies the relative size (%) between the spectrum and waterfall areas by moving the dividing line up or down as a percentage
 //                                  // Smaller value makes spectrum smaller, waterfall bigger
 //  int16_t spectrum_width          // Total width of window. Even numbers are best. 552 is minimum to fit a full 512 pixel graph plus the min 20 pixel border used on each side. Can be smaller but will reduce graph area
-//  float   spectrum_span           // UNUSED for now.  Value in Hz.  Ths will be the maximum span shown in the display graphs.  
-                                    // The graph code knows how many Hz per bin so will scale down to magnify a smaller range.
-                                    // Max value and resolutoin (pixels per bin) is dependent on sample frequency
-                                    // 25000 is max for 1024 FFT with 500 bins at 1:1 bins per pixel
-                                    // 12500 would result in 2 pixels per bin. Bad numbers here should be corrected to best fit by the function
+//  float   spectrum_span           // Value in Hz.  Ths will be the maximum span shown in the display graphs.  
+                                    // Sets the zoom FFT decimation, see spectrum_zoom_for_span().
+                                    // 25000 is max for 1024 FFT with 512 bins at 1:1 bins per pixel
+                                    // 12500 would be zoom 2 with 25Hz bins. Bad numbers here are corrected to best fit by the function
 //  int16_t spectrum_sp_scale       // 10 to 80. Spectrum scale factor in dB. This is the height of the scale (if possible by windows sizes). Will plot the spectrum window of values between the floor and the scale value creating a zoom effect.  int16_t spectrum_floor          = -240;      // 0 to -150. The reference point for plotting values.  Anything signal value > than this (less negative) will be plotted until stronger than the window height*scale factor.
 //  float   spectrum_wf_scale       // 0.0f to 40.0f. Specifies thew waterfall zoom level - may be redundant when Span is worked out later.
 //  float   spectrum_LPFcoeff       // 1.0f to 0.0f. Data smoothing
@@ -786,11 +1035,11 @@ void Spectrum_Parm_Generator(int16_t parm_set)
     ptr->border_space = ptr->border_space_min;
     if (spectrum_width > tft.width())
         spectrum_width = tft.width();
-    if (spectrum_width > (fft_bins*2) + (ptr->border_space_min*2))
+    if (spectrum_width > SPECTRUM_MAX_WIDTH + (ptr->border_space_min*2))
     {  
-        // space is wider than max graph size fft_bins to pad with border space and center graph area
-        ptr->border_space = (spectrum_width - (fft_bins*2))/2;   // padding for each side
-        ptr->wf_sp_width  = fft_bins*2;
+        // space is wider than max graph size to pad with border space and center graph area
+        ptr->border_space = (spectrum_width - SPECTRUM_MAX_WIDTH)/2;   // padding for each side
+        ptr->wf_sp_width  = SPECTRUM_MAX_WIDTH;
     }
     else  // make smaller than FFT_bins
     {
@@ -876,57 +1125,4 @@ void Spectrum_Parm_Generator(int16_t parm_set)
     Serial.print("  Current Color Temp=");
     Serial.println(spectrum_wf_colortemp);
 }
-//
-//--------------------------------------------------  find_FFT_Max() ------------------------------------------------------------------------
-//
-// Return the estimated frequency and max power level, based on powers in FFT bins. -------------------------------------
-// Adapted from OpenAudio_ArduinoLibrary example FFTFrequencyMeter.ino by Bob Larkin, 2021
-  // Following from DerekR
-  // https://forum.pjrc.com/threads/36358-A-New-Accurate-FFT-Interpolator-for-Frequency-Estimation
-  // " 1) A record of length 1024 samples is windowed with a Hanning window
-  //   2) The magnitude spectrum is computed from the FFT, and the two (adjacent)
-  //      largest amplitude lines are found.  Let the largest be line L, and the
-  //      other be either L+1, of L-1.
-  //   3) Compute the ratio R of the amplitude of the two largest lines.
-  //   4) If the amplitude of L+1 is greater than L-1 then
-  //              f = (L + (2-R)/(1+R))*f_sample/1024
-  //        otherwise
-  //              f = (L - (2-R)/(1+R))*f_sample/1024  "
-void find_FFT_Max(void)  
-{
-    float specMax = 0.0f;
-    uint16_t iiMax = 0;
-
-    myFFT.setOutputType(FFT_POWER);   // change to power, return it to FFT_DBFS at end
-    myFFT.windowFunction(AudioWindowHanning1024);
-
-    // Get pointer to data array of powers, float output[512];
-    float* pPwr = myFFT.getData();
-    // Find biggest bin
-    for(int ii=2; ii<FFT_SIZE; ii++)  
-    {
-        if (*(pPwr + ii) > specMax) 
-        { // Find highest peak of 512
-          specMax = *(pPwr + ii);
-          iiMax = ii;
-        }
-    }
-    float vm = sqrtf( *(pPwr + iiMax - 1) );
-    float vc = sqrtf( *(pPwr + iiMax) );
-    float vp = sqrtf( *(pPwr + iiMax + 1) );
-    if(vp > vm)  
-    {
-        myFFT.setOutputType(FFT_DBFS);   // change to power, return it to FFT_DBFS at end
-        fftMaxPower = vc/vp;  // set global fftMaxPower = Power of the strongest signal if possible
-        float R = vc/vp;
-        fftFrequency = ( (float32_t)iiMax + (2-R)/(1+R) )*fft_bin_size;   // *44100.0f/1024.0f;
-    }
-    else  
-    {
-        myFFT.setOutputType(FFT_DBFS);   // return it to FFT_DBFS
-        fftMaxPower = vc/vm;  // set global fftMaxPower = Power of the strongest signal if possible
-        float R = vc/vm;
-        fftFrequency = ( (float32_t)iiMax - (2-R)/(1+R) )*fft_bin_size;  // fftFrequency is global to this module
-    }
-}
 
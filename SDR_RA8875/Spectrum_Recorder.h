@@ -0,0 +1,456 @@
+//
+// Spectrum_Recorder.h
+//
+// Records the spectrum to the Teensy 4.1 built in SD card.  Every spectrum frame is stored as one byte per bin for
+// the SPEC_REC_BINS bins around 0Hz, in 1 dB steps from SPEC_REC_MIN_DB (code 0 is not used), the same levels the
+// waterfall history keeps.  Console 'R' starts and stops a recording.
+//
+// spectrum_update() calls spec_rec_add() once per frame.  That only encodes the frame into a RAM ring, it never
+// touches the card.  task_SpecRec() runs from the scheduler at the lowest priority and writes the ring out in whole
+// SPEC_REC_SECTOR pieces, one write per run, so a slow card write costs one pass of loop() and never holds up a
+// spectrum frame or the audio interrupt.  If the card falls so far behind that the ring fills, frames are dropped
+// and counted, the next frame stored is a key frame so the file still decodes.  A short card write (card full or
+// failing) stops the recording: everything queued after the gap would sit at the wrong offset and the IDX entries
+// would point into the wrong frames, so the rest is dropped and the file ends at the last good write.
+//
+// Files are SPECnnnn.SPC with a SPECnnnn.IDX beside them, numbered from 0 on each card.  All values little endian.
+//
+//   SPC header, 32 bytes:   char[4] "KSPC", u16 version, u16 header bytes, u16 bins, u16 FFT size, f32 min dB,
+//                           f32 dB per code, u32 index period ms, u32 RTC time at start (unix), u32 millis at start
+//   Frame, 24 byte header:  u8 0xA5, u8 'F', u8 flags, u8 0, u16 payload bytes, u16 frame number (wraps),
+//                           u32 ms since start, u32 VFO Hz, f32 bin Hz, f32 0 (was a zoom center offset)
+//                           then the payload.  Bin c of the frame is FFT bin c - bins/2, lowest frequency first.
+//   Flags:  SPEC_REC_DELTA  payload is the difference from the frame before, mod 256.  Otherwise a key frame.
+//           SPEC_REC_RLE    payload is PackBits coded.  Control byte n < 128 is n+1 literal bytes,
+//                           n > 128 is the next byte repeated 257-n times.  Without it the payload is the bins as is.
+//   IDX entry, 16 bytes:    u32 minute, u32 ms since start, u32 SPC offset of the key frame, u32 frame count.
+//                           Entry k is for minute k and sits at k*16, so a reader can seek straight to any minute.
+//
+// The first frame of each minute is a key frame, as is the first one after a retune, a span change or a drop.
+// The 0xA5 'F' pair lets a reader that lost the IDX file scan for frames.
+//
+
+#include <SD.h>
+
+#define SPEC_REC_BINS           SPECTRUM_MAX_WIDTH  // bins stored per frame, centered on 0Hz
+#define SPEC_REC_MIN_DB         -200.0f     // code c is this + c dB
+#define SPEC_REC_VERSION        1
+#define SPEC_REC_RING           32768       // bytes of encoded frames held for the card, power of 2
+#define SPEC_REC_SECTOR         512         // card writes are whole multiples of this
+#define SPEC_REC_CHUNK          4096        // most written by one task run
+#define SPEC_REC_INDEX_MS       60000       // one IDX entry and key frame per minute
+#define SPEC_REC_IDX_QUEUE      8           // IDX entries waiting for the task
+#define SPEC_REC_PERIOD         20          // task period in ms
+#define SPEC_REC_DELTA          0x01        // frame flags
+#define SPEC_REC_RLE            0x02
+#define SPEC_REC_SYNC           0xA5
+
+enum Spec_Rec_Compress {
+    SPEC_REC_RAW,                           // bins as is
+    SPEC_REC_PACK,                          // PackBits on every frame
+    SPEC_REC_DELTA_PACK                     // difference from the last frame, then PackBits
+};
+
+struct __attribute__ ((packed)) Spec_Rec_File_Header {
+    char     magic[4];
+    uint16_t version;
+    uint16_t header_bytes;
+    uint16_t bins;
+    uint16_t fft_size;
+    float    min_dB;
+    float    step_dB;
+    uint32_t index_ms;
+    uint32_t start_unix;
+    uint32_t start_ms;
+};
+struct __attribute__ ((packed)) Spec_Rec_Frame_Header {
+    uint8_t  sync;
+    uint8_t  type;
+    uint8_t  flags;
+    uint8_t  pad;
+    uint16_t payload_bytes;
+    uint16_t frame;
+    uint32_t time_ms;
+    uint32_t freq_Hz;
+    float    bin_Hz;
+    float    center_Hz;
+};
+struct Spec_Rec_Index {
+    uint32_t minute;
+    uint32_t time_ms;
+    uint32_t offset;
+    uint32_t frames;
+};
+static_assert(sizeof(struct Spec_Rec_File_Header) == 32, "SPC header layout");
+static_assert(sizeof(struct Spec_Rec_Frame_Header) == 24, "SPC frame header layout");
+static_assert(sizeof(struct Spec_Rec_Index) == 16, "IDX entry layout");
+
+extern volatile uint32_t        Freq;
+extern float                    fft_bin_size;
+extern AudioSDRzoomIQ_F32       FFT_Zoom;
+
+DMAMEM uint8_t spec_rec_ring[SPEC_REC_RING];   // encoded frames waiting for the card
+uint8_t  spec_rec_last[SPEC_REC_BINS];      // codes of the last frame stored, delta reference
+uint8_t  spec_rec_now[SPEC_REC_BINS];       // codes of this frame
+uint8_t  spec_rec_diff[SPEC_REC_BINS];      // this frame minus the last one
+uint8_t  spec_rec_pack[SPEC_REC_BINS + SPEC_REC_BINS/128 + 2];    // PackBits output, worst case
+struct Spec_Rec_Index spec_rec_idx_queue[SPEC_REC_IDX_QUEUE];
+File     spec_rec_file;
+File     spec_rec_idx_file;
+char     spec_rec_name[16];                 // SPC file name being written
+bool     spec_rec_on            = false;
+bool     sd_card_ok             = false;    // SD.begin() worked, the IQ recorder shares the card
+uint8_t  spec_rec_compress      = SPEC_REC_DELTA_PACK;
+uint32_t spec_rec_head          = 0;        // ring write count, masked for the position
+uint32_t spec_rec_tail          = 0;        // ring read count
+uint32_t spec_rec_offset        = 0;        // SPC file offset the next queued frame will land at
+uint8_t  spec_rec_idx_head      = 0;
+uint8_t  spec_rec_idx_tail      = 0;
+uint32_t spec_rec_start_ms      = 0;
+uint32_t spec_rec_minute        = 0;        // next IDX entry due
+uint32_t spec_rec_frames        = 0;        // frames stored
+uint32_t spec_rec_key_frames    = 0;
+uint32_t spec_rec_dropped       = 0;        // frames lost to a full ring
+uint32_t spec_rec_raw_bytes     = 0;        // bins given to the encoder
+uint32_t spec_rec_bytes         = 0;        // bytes queued for the card, headers included
+uint32_t spec_rec_written       = 0;        // bytes on the card
+uint32_t spec_rec_errors        = 0;        // short card writes, the first one stops the recording
+uint32_t spec_rec_write_max_us  = 0;        // slowest card write since the last stats print
+uint32_t spec_rec_encode_us     = 0;        // time taken by the last spec_rec_add()
+bool     spec_rec_need_key      = true;     // next frame must be a key frame
+uint32_t spec_rec_last_freq     = 0;
+float    spec_rec_last_bin      = 0.0f;
+
+//function declarations
+bool     sd_card_ready(void);
+void     spec_rec_quantize(const float *pout, uint8_t *codes);
+void     spec_rec_start(void);
+void     spec_rec_stop(void);
+static void spec_rec_close(const char *why);
+void     spec_rec_toggle(void);
+void     spec_rec_add(const float *pout);
+void     task_SpecRec(void);
+uint16_t spec_rec_packbits(const uint8_t *src, uint16_t n, uint8_t *dst);
+void     printSpecRecStats(void);
+
+//
+// Start the built in SD card the first time it is needed
+bool sd_card_ready(void)
+{
+    if (!sd_card_ok)
+        sd_card_ok = SD.begin(BUILTIN_SDCARD);
+    return sd_card_ok;
+}
+//
+// One byte per bin for the SPEC_REC_BINS bins around 0Hz.  Host_Stream.h sends the same codes.
+void spec_rec_quantize(const float *pout, uint8_t *codes)
+{
+    for (int16_t c = 0; c < SPEC_REC_BINS; c++)
+    {
+        float q = pout[(c - SPEC_REC_BINS/2) & (FFT_SIZE-1)] - SPEC_REC_MIN_DB;
+        codes[c] = (q >= 1.0f) ? ((q < 255.0f) ? (uint8_t) (q + 0.5f) : 255) : 1;    // NaN lands on 1, the bottom
+    }
+}
+//
+// PackBits code n bytes of src into dst.  Returns the bytes written, at most n + n/128 + 1.
+uint16_t spec_rec_packbits(const uint8_t *src, uint16_t n, uint8_t *dst)
+{
+    uint16_t i = 0, o = 0;
+
+    while (i < n)
+    {
+        uint16_t run = 1;
+        while (i + run < n && run < 128 && src[i + run] == src[i])
+            run++;
+        if (run >= 3)
+        {
+            dst[o++] = (uint8_t) (257 - run);
+            dst[o++] = src[i];
+            i += run;
+            continue;
+        }
+        // Literals up to the next run of 3 or more
+        uint16_t start = i, lit = 0;
+        while (i < n && lit < 128)
+        {
+            if (i + 2 < n && src[i] == src[i+1] && src[i] == src[i+2])
+                break;
+            i++;
+            lit++;
+        }
+        dst[o++] = (uint8_t) (lit - 1);
+        memcpy(&dst[o], &src[start], lit);
+        o += lit;
+    }
+    return o;
+}
+//
+// Bytes free in the ring
+static inline uint32_t spec_rec_ring_free(void)
+{
+    return SPEC_REC_RING - (spec_rec_head - spec_rec_tail);
+}
+//
+// Copy into the ring.  The caller has checked there is room.
+static void spec_rec_ring_put(const void *data, uint32_t n)
+{
+    const uint8_t *src = (const uint8_t *) data;
+    uint32_t pos = spec_rec_head & (SPEC_REC_RING-1);
+    uint32_t first = min(n, SPEC_REC_RING - pos);
+
+    memcpy(&spec_rec_ring[pos], src, first);
+    memcpy(spec_rec_ring, src + first, n - first);
+    spec_rec_head += n;
+}
+//
+// Open the next free SPECnnnn file pair and start recording
+void spec_rec_start(void)
+{
+    char idx_name[16];
+    uint16_t n;
+
+    if (!sd_card_ready())
+    {
+        Serial.println("Spectrum Recorder: no SD card");
+        return;
+    }
+    for (n = 0; n < 10000; n++)
+    {
+        snprintf(spec_rec_name, sizeof(spec_rec_name), "SPEC%04u.SPC", n);
+        if (!SD.exists(spec_rec_name))
+            break;
+    }
+    snprintf(idx_name, sizeof(idx_name), "SPEC%04u.IDX", n);
+    spec_rec_file = SD.open(spec_rec_name, FILE_WRITE);
+    spec_rec_idx_file = SD.open(idx_name, FILE_WRITE);
+    if (n == 10000 || !spec_rec_file || !spec_rec_idx_file)
+    {
+        if (spec_rec_file)     spec_rec_file.close();
+        if (spec_rec_idx_file) spec_rec_idx_file.close();
+        Serial.println("Spectrum Recorder: can not create a file");
+        return;
+    }
+
+    spec_rec_head = spec_rec_tail = 0;
+    spec_rec_idx_head = spec_rec_idx_tail = 0;
+    spec_rec_start_ms = millis();
+    spec_rec_minute = 0;
+    spec_rec_frames = spec_rec_key_frames = spec_rec_dropped = 0;
+    spec_rec_raw_bytes = spec_rec_bytes = spec_rec_written = spec_rec_errors = 0;
+    spec_rec_need_key = true;
+
+    struct Spec_Rec_File_Header h;
+    memcpy(h.magic, "KSPC", 4);
+    h.version      = SPEC_REC_VERSION;
+    h.header_bytes = sizeof(h);
+    h.bins         = SPEC_REC_BINS;
+    h.fft_size     = FFT_SIZE;
+    h.min_dB       = SPEC_REC_MIN_DB;
+    h.step_dB      = 1.0f;
+    h.index_ms     = SPEC_REC_INDEX_MS;
+    h.start_unix   = Teensy3Clock.get();
+    h.start_ms     = spec_rec_start_ms;
+    spec_rec_ring_put(&h, sizeof(h));
+    spec_rec_offset = spec_rec_bytes = sizeof(h);
+
+    spec_rec_on = true;
+    Serial.print("Spectrum Recorder: recording to ");
+    Serial.println(spec_rec_name);
+}
+//
+// Write out what is left in the ring and close the files
+void spec_rec_stop(void)
+{
+    if (!spec_rec_on)
+        return;
+    spec_rec_on = false;
+    while (spec_rec_file && (spec_rec_head != spec_rec_tail || spec_rec_idx_head != spec_rec_idx_tail))
+        task_SpecRec();                     // stopping is a user action, it may wait for the card
+    if (spec_rec_file)                      // not already closed by a failed write
+        spec_rec_close("stopped");
+}
+//
+// Close the files and say why
+static void spec_rec_close(const char *why)
+{
+    spec_rec_on = false;
+    spec_rec_file.close();
+    spec_rec_idx_file.close();
+    Serial.print("Spectrum Recorder: ");
+    Serial.print(why);
+    Serial.print(", ");
+    Serial.print(spec_rec_frames);
+    Serial.print(" frames, ");
+    Serial.print(spec_rec_written);
+    Serial.print(" bytes in ");
+    Serial.println(spec_rec_name);
+}
+//
+void spec_rec_toggle(void)
+{
+    if (spec_rec_on)
+        spec_rec_stop();
+    else
+        spec_rec_start();
+}
+//
+// Queue one frame.  pout is the frame's dB array in FFT bin order.  Never waits on the card.
+void spec_rec_add(const float *pout)
+{
+    if (!spec_rec_on)
+        return;
+
+    uint32_t start = micros();
+    uint32_t t = millis() - spec_rec_start_ms;
+    struct Spec_Rec_Frame_Header h;
+
+    spec_rec_quantize(pout, spec_rec_now);
+
+    // A new minute gets an IDX entry pointing at this frame, which is then a key frame.  A minute with no
+    // frames (card stopped, scheduler stalled) repeats the entry so entry k is always at k*16.
+    bool index = (t / SPEC_REC_INDEX_MS) >= spec_rec_minute;
+    bool key = spec_rec_need_key || index || spec_rec_compress != SPEC_REC_DELTA_PACK ||
+               Freq != spec_rec_last_freq || fft_bin_size != spec_rec_last_bin;
+
+    const uint8_t *src = spec_rec_now;
+    uint8_t flags = 0;
+    if (key)
+        spec_rec_key_frames++;
+    else
+    {
+        for (int16_t c = 0; c < SPEC_REC_BINS; c++)
+            spec_rec_diff[c] = spec_rec_now[c] - spec_rec_last[c];
+        src = spec_rec_diff;
+        flags |= SPEC_REC_DELTA;
+    }
+    uint16_t n = SPEC_REC_BINS;
+    if (spec_rec_compress != SPEC_REC_RAW)
+    {
+        uint16_t packed = spec_rec_packbits(src, SPEC_REC_BINS, spec_rec_pack);
+        if (packed < SPEC_REC_BINS)         // keep it raw if PackBits did not help
+        {
+            src = spec_rec_pack;
+            n = packed;
+            flags |= SPEC_REC_RLE;
+        }
+    }
+
+    if (spec_rec_ring_free() < sizeof(h) + n)
+    {
+        spec_rec_dropped++;
+        spec_rec_need_key = true;           // the reader will not have the frame this one would follow
+        spec_rec_encode_us = micros() - start;
+        return;
+    }
+    if (index)
+    {
+        while (spec_rec_minute <= t / SPEC_REC_INDEX_MS &&
+               (uint8_t) (spec_rec_idx_head - spec_rec_idx_tail) < SPEC_REC_IDX_QUEUE)
+        {
+            struct Spec_Rec_Index *e = &spec_rec_idx_queue[spec_rec_idx_head++ % SPEC_REC_IDX_QUEUE];
+            e->minute  = spec_rec_minute++;
+            e->time_ms = t;
+            e->offset  = spec_rec_offset;
+            e->frames  = spec_rec_frames;
+        }
+    }
+
+    h.sync          = SPEC_REC_SYNC;
+    h.type          = 'F';
+    h.flags         = flags;
+    h.pad           = 0;
+    h.payload_bytes = n;
+    h.frame         = (uint16_t) spec_rec_frames;
+    h.time_ms       = t;
+    h.freq_Hz       = Freq;
+    h.bin_Hz        = fft_bin_size;
+    h.center_Hz     = 0.0f;                 // the zoom is always centered on the VFO
+    spec_rec_ring_put(&h, sizeof(h));
+    spec_rec_ring_put(src, n);
+
+    memcpy(spec_rec_last, spec_rec_now, SPEC_REC_BINS);
+    spec_rec_last_freq   = Freq;
+    spec_rec_last_bin    = fft_bin_size;
+    spec_rec_need_key    = false;
+    spec_rec_offset     += sizeof(h) + n;
+    spec_rec_bytes      += sizeof(h) + n;
+    spec_rec_raw_bytes  += SPEC_REC_BINS;
+    spec_rec_frames++;
+    spec_rec_encode_us = micros() - start;
+}
+//
+// Scheduler task.  Writes at most SPEC_REC_CHUNK bytes of the ring, whole sectors only while recording, plus any
+// IDX entries.  The card is flushed with each IDX entry so a power loss costs at most a minute.
+void task_SpecRec(void)
+{
+    uint32_t used = spec_rec_head - spec_rec_tail;
+    uint32_t n = min(used, (uint32_t) SPEC_REC_CHUNK);
+
+    if (spec_rec_on)
+        n -= n % SPEC_REC_SECTOR;           // partial sectors wait for more data
+    if (n > 0)
+    {
+        uint32_t pos = spec_rec_tail & (SPEC_REC_RING-1);
+        n = min(n, SPEC_REC_RING - pos);    // up to the end of the ring, the rest goes next run
+        uint32_t start = micros();
+        size_t done = spec_rec_file.write(&spec_rec_ring[pos], n);
+        uint32_t us = micros() - start;
+        if (us > spec_rec_write_max_us)
+            spec_rec_write_max_us = us;
+        spec_rec_written += done;
+        if (done != n)
+        {
+            // Nothing after the gap can be placed or indexed.  IDX entries already out point at frames on the card.
+            spec_rec_errors++;
+            spec_rec_tail = spec_rec_head;
+            spec_rec_idx_tail = spec_rec_idx_head;
+            spec_rec_close("card write failed, recording stopped");
+            return;
+        }
+        spec_rec_tail += n;
+    }
+
+    // IDX entries only go out once the frames they point at are on the card
+    while (spec_rec_idx_head != spec_rec_idx_tail)
+    {
+        struct Spec_Rec_Index *e = &spec_rec_idx_queue[spec_rec_idx_tail % SPEC_REC_IDX_QUEUE];
+        if (e->offset >= spec_rec_written && spec_rec_head != spec_rec_tail)
+            break;
+        if (spec_rec_idx_file.write((const uint8_t *) e, sizeof(*e)) != sizeof(*e))
+            spec_rec_errors++;
+        spec_rec_idx_tail++;
+        spec_rec_file.flush();
+        spec_rec_idx_file.flush();
+    }
+}
+//
+// Recorder report for the console 'C' command
+void printSpecRecStats(void)
+{
+    Serial.print("Spectrum Recorder: ");
+    if (!spec_rec_on)
+    {
+        Serial.println("off");
+        return;
+    }
+    Serial.print(spec_rec_name);
+    Serial.print(", Frames: ");
+    Serial.print(spec_rec_frames);
+    Serial.print(" (");
+    Serial.print(spec_rec_key_frames);
+    Serial.print(" key), Dropped: ");
+    Serial.print(spec_rec_dropped);
+    Serial.print(", Ratio: ");
+    Serial.print(spec_rec_bytes > 0 ? (float) spec_rec_raw_bytes / spec_rec_bytes : 0.0f, 2);
+    Serial.print(", Written: ");
+    Serial.print(spec_rec_written);
+    Serial.print(", Queued: ");
+    Serial.print(spec_rec_head - spec_rec_tail);
+    Serial.print(", Errors: ");
+    Serial.print(spec_rec_errors);
+    Serial.print(", Encode Time (uS): ");
+    Serial.print(spec_rec_encode_us);
+    Serial.print(", Max Write Time (uS): ");
+    Serial.println(spec_rec_write_max_us);
+    spec_rec_write_max_us = 0;
+}
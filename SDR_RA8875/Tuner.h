@@ -11,6 +11,20 @@ extern volatile uint32_t fstep;
 static const long topFreq = 51000000;  // sets receiver upper  frequency limit 30 MHz
 static const long bottomFreq = 1000000; // sets the receiver lower frequency limit 1.6 MHz
 
+// Encoder acceleration.  The count rate is smoothed with a ENC_RATE_TAU_MS time constant and the step is multiplied
+// by 1 + (rate/ENC_ACCEL_RATE)^3, so slow turns move one fstep per count and a fast spin can cross a band.
+#define ENC_COUNTS_PER_STEP     1       // encoder counts for one fstep.  Raise for encoders that count 4 per detent.
+#define ENC_RATE_TAU_MS         100     // smoothing of the count rate
+#define ENC_ACCEL_RATE          40.0f   // counts/sec where acceleration starts to be felt
+#define ENC_ACCEL_MAX           1000    // largest step multiplier
+
+float    enc_rate       = 0;            // smoothed encoder counts/sec
+uint32_t enc_mult_last  = 1;            // multiplier used on the last tuning burst, for display or debug
+
+//function declarations
+void selectFrequency();
+void tuneEncoder();
+
 ///////////////////////////spin the encoder win a frequency!!////////////////////////////
 void selectFrequency()
 {
@@ -41,3 +55,49 @@ void selectFrequency()
     oldFreq=newFreq; //update oldFreq
  
 }
+
+////////////////// Encoder tuning.  Call often, it only does work when the knob moved.////////////////////
+// The Encoder library counts on pin interrupts so no counts are lost between calls.  Every count since the last
+// call is applied at once, with one SetFreq() and one displayFreq() for the whole burst.
+void tuneEncoder()
+{
+    static uint32_t last_ms = millis();
+    uint32_t now = millis();
+    uint32_t dt  = now - last_ms;
+    
+    newFreq = Position.read();
+    long counts = (newFreq - oldFreq) / ENC_COUNTS_PER_STEP;
+    if (dt == 0 && counts == 0)
+        return;
+    last_ms = now;
+
+    // Smoothed count rate.  Idle calls let it decay back toward 0.
+    if (dt > 0)
+    {
+        float inst = abs(counts) * 1000.0f / dt;
+        enc_rate += (inst - enc_rate) * dt / (ENC_RATE_TAU_MS + dt);
+    }
+    if (counts == 0)
+        return;
+
+    float    r    = enc_rate / ENC_ACCEL_RATE;
+    uint32_t mult = 1 + (uint32_t) (r*r*r);
+    if (mult > ENC_ACCEL_MAX)
+        mult = ENC_ACCEL_MAX;
+    enc_mult_last = mult;
+
+    int64_t f = (int64_t) Freq + (int64_t) counts * fstep * mult;
+    if (mult > 1)
+        f -= f % fstep;             // stay on the tuning step grid
+    if (f >= topFreq)
+        f = topFreq;
+    if (f <= bottomFreq)
+        f = bottomFreq;
+    
+    oldFreq += counts * ENC_COUNTS_PER_STEP;    // keep any partial step for next time
+    if ((uint32_t) f == Freq)
+        return;
+    Freq = (uint32_t) f;
+    SetFreq();      // send freq to SI5351
+    displayFreq();  // show freq on display
+}
@@ -51,6 +51,7 @@ extern void RampVolume(float vol, int16_t rampType);
 void Button_Handler(int16_t x, uint16_t y); 
 void Set_Spectrum_Scale(int8_t zoom_dir);
 void Set_Spectrum_RefLvl(int8_t zoom_dir);
+void Set_Spectrum_Span(int8_t zoom_dir);
 void Gesture_Handler(uint8_t gesture);
 uint32_t HamBands(uint32_t band);
 
@@ -236,7 +237,11 @@ void Gesture_Handler(uint8_t gesture)
                 Serial.print(" T1_Y="); Serial.print(T1_Y);                
                 #endif
 
-                if ( abs(T1_Y) > abs(T1_X)) // Y moved, not X, vertical swipe
+                if ( abs(T1_Y) > abs(T1_X) && wf_hist_in_window(touch_evt.start_coordinates[0][0], touch_evt.start_coordinates[0][1]))
+                {
+                    wf_hist_scroll(-T1_Y);  // drag in the waterfall, up goes back in time 1 row per pixel, down comes forward
+                }
+                else if ( abs(T1_Y) > abs(T1_X)) // Y moved, not X, vertical swipe
                 {
                     //Serial.println("\nSwipe Vertical");
                     if (T1_Y > 0)  // y is negative so must be vertical swipe down direction                    
@@ -253,12 +258,10 @@ void Gesture_Handler(uint8_t gesture)
                 else  // X moved, not Y, horiznatal swipe
                 {
                     //Serial.println("\nSwipe Horizontal");
-                    if (T1_X < 0)  // y is negative so must be vertical swipe down direction                    
-                        //  will use for span zoom OUT
-                        Serial.println(" Swipe LEFT");
+                    if (T1_X < 0)  // x is negative so must be horizontal swipe left direction                    
+                        Set_Spectrum_Scale(-1);     // Swipe LEFT
                     else  // Swipe 
-                        Serial.println(" Swipe RIGHT");
-                          //  will use for span zoom in   
+                        Set_Spectrum_Scale(1);      // Swipe RIGHT
                 }                                 
                 break;
         }
@@ -283,9 +286,9 @@ void Gesture_Handler(uint8_t gesture)
                 #endif
                 // Calculate the distance between T1 and T2 at the end   
                 if (dist_end < dist_start)                        
-                    Set_Spectrum_Scale(-1); // Was a pinch in.  Just pass on direction, the end function can look for distance if needed
+                    Set_Spectrum_Span(-1); // Was a pinch in, zoom out to a wider span.  Just pass on direction, the end function can look for distance if needed
                 else
-                    Set_Spectrum_Scale(1); // was a pinch out   
+                    Set_Spectrum_Span(1); // was a pinch out, zoom in   
                 break;
         }
         case 0: // nothing applicable, leave
@@ -478,7 +481,7 @@ void Button_Handler(int16_t x, uint16_t y)
     }     
 }
 
-// Use gestures (pinch) to adjust the the vertical scaling.  This affects both watefall and spectrum.  YMMV :-)
+// Use gestures (horizontal swipe) to adjust the the vertical scaling.  This affects both watefall and spectrum.  YMMV :-)
 void Set_Spectrum_Scale(int8_t zoom_dir)
 {
     Serial.println(zoom_dir);
@@ -500,10 +503,24 @@ void Set_Spectrum_Scale(int8_t zoom_dir)
     Serial.println(Sp_Parms_Def[spectrum_preset].spect_wf_scale);
 }
 
+// Use gestures (pinch) to change the spectrum span through the zoom FFT.  Each step halves or doubles the span.
+void Set_Spectrum_Span(int8_t zoom_dir)
+{
+    uint16_t zoom = spectrum_zoom;
+
+    if (zoom_dir == 1 && zoom < ZOOM_MAX_FACTOR)
+        zoom *= 2;
+    else if (zoom_dir == -1 && zoom > 1)
+        zoom /= 2;
+    spectrum_zoom_set(zoom);
+}
+
 // Use gestures to raise and lower the spectrum reference level relative to the bottom of the window (noise floor)
 void Set_Spectrum_RefLvl(int8_t zoom_dir)
 {
     Serial.println(zoom_dir);    
+    if (nf_auto)
+        nf_auto_set(false);     // the user is setting it by hand now
     
     if (zoom_dir == 1)
     {
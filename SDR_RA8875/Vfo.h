@@ -1,7 +1,136 @@
-#include <si5351mcu.h> 
+#include <si5351mcu.h>
+#include <Wire.h>
 extern Si5351mcu si5351;
 extern volatile uint32_t Freq;
 extern volatile uint32_t Fc;
+
+// Si5351 register writer for CLK0.  The si5351mcu library is still used to bring the chip up but retuning is done here.
+// The last PLLA (regs 26-33) and MultiSynth0 (regs 42-49) values written are kept and a retune only sends the bytes
+// that changed, as one burst per register block.  The MultiSynth is an even integer divider and is left alone as long
+// as the VCO stays in its 600-900 MHz range, so tuning within a band only moves the PLL fraction (usually 3-4 bytes).
+// When the MultiSynth does change the PLL is reset so the output comes back in phase.
+#define SI5351_ADDR         0x60
+#define VFO_I2C_CLOCK       400000      // Si5351 is rated for 400 kHz fast mode
+#define VFO_XTAL            25000000
+#define VFO_CORRECTION      1330        // Hz added to the crystal frequency for calibration
+#define VFO_FVCO_MIN        600000000ULL
+#define VFO_FVCO_MAX        900000000ULL
+#define VFO_DIVBY4_FREQ     150000000   // above this the MultiSynth must use divide by 4
+#define VFO_FRAC_DENOM      1048575     // largest 20 bit PLL fraction denominator
+#define VFO_DRIVE           3           // CLK0 drive, 3 = 8mA
+#define SI5351_PLLA_REG     26
+#define SI5351_MS0_REG      42
+#define SI5351_CLK0_CTRL    16
+#define SI5351_PLL_RESET    177
+#define SI5351_MS_DIVBY4    0x0C        // MultiSynth byte 2 bits for divide by 4 mode
+
+struct Vfo_Regs {
+    uint8_t  pll[8];                    // regs 26-33
+    uint8_t  ms[8];                     // regs 42-49
+    uint32_t ms_div;                    // MultiSynth divider the ms[] bytes are for
+};
+struct Vfo_Regs vfo_regs;               // last written to the chip
+bool     vfo_regs_valid     = false;    // false = chip contents unknown, write everything next time
+bool     vfo_fixed_ms       = true;     // false = pick the best MultiSynth divider on every retune
+uint32_t vfo_bytes_last     = 0;        // I2C bytes sent by the last retune, register address bytes included
+uint32_t vfo_bytes_total    = 0;
+uint32_t vfo_retunes        = 0;
+uint32_t vfo_ms_changes     = 0;        // retunes that had to change the MultiSynth and reset the PLL
+
+//function declarations
+void initVfo();
+void SetFreq();
+void vfo_compute(uint32_t fout, uint32_t ms_div_now, struct Vfo_Regs *r);
+void printVfoStats(void);
+
+// Pack a+b/c into the 8 byte P1/P2/P3 register layout shared by the PLL and MultiSynth blocks.
+// ms_bits goes in byte 2 above P1 (R divider and divide by 4 bits for a MultiSynth).
+static void si5351_pack(uint32_t a, uint32_t b, uint32_t c, uint8_t ms_bits, uint8_t *reg)
+{
+    uint32_t f  = (uint32_t) (((uint64_t) b * 128) / c);
+    uint32_t p1 = 128*a + f - 512;
+    uint32_t p2 = 128*b - c*f;
+    uint32_t p3 = c;
+
+    reg[0] = (p3 >> 8) & 0xFF;
+    reg[1] = p3 & 0xFF;
+    reg[2] = ms_bits | ((p1 >> 16) & 0x03);
+    reg[3] = (p1 >> 8) & 0xFF;
+    reg[4] = p1 & 0xFF;
+    reg[5] = ((p3 >> 12) & 0xF0) | ((p2 >> 16) & 0x0F);
+    reg[6] = (p2 >> 8) & 0xFF;
+    reg[7] = p2 & 0xFF;
+}
+//
+// Work out the register values for fout.  Keeps ms_div_now if the VCO stays in range with it.
+void vfo_compute(uint32_t fout, uint32_t ms_div_now, struct Vfo_Regs *r)
+{
+    uint64_t xtal = VFO_XTAL + VFO_CORRECTION;
+    uint32_t d    = ms_div_now;
+
+    if (fout > VFO_DIVBY4_FREQ)
+        d = 4;
+    else if (!vfo_fixed_ms || d < 6 || (uint64_t) fout*d < VFO_FVCO_MIN || (uint64_t) fout*d > VFO_FVCO_MAX)
+    {
+        d = (VFO_FVCO_MAX / fout) & ~1UL;   // largest even divider that keeps the VCO under the max
+        d = constrain(d, 6UL, 1800UL);
+    }
+    r->ms_div = d;
+
+    if (d == 4)
+    {
+        // Divide by 4 mode takes P1 = 0, P2 = 0, P3 = 1 (AN619).  These are not the a+b/c packing of any divider,
+        // packing 0+0/1 would underflow P1 to 0x3FE00, so they are written as they are.
+        memset(r->ms, 0, sizeof(r->ms));
+        r->ms[1] = 1;                       // P3 = 1
+        r->ms[2] = SI5351_MS_DIVBY4;
+    }
+    else
+        si5351_pack(d, 0, 1, 0x00, r->ms);
+
+    // PLL = xtal * (a + b/c) lands on fout * d
+    uint64_t fvco = (uint64_t) fout * d;
+    uint32_t a    = fvco / xtal;
+    uint32_t b    = ((fvco % xtal) * VFO_FRAC_DENOM + xtal/2) / xtal;
+    if (b >= VFO_FRAC_DENOM)
+    {
+        a++;
+        b = 0;
+    }
+    si5351_pack(a, b, VFO_FRAC_DENOM, 0x00, r->pll);
+}
+//
+// Send the bytes of one register block that differ from what the chip already has, as a single burst
+static uint32_t vfo_write_block(uint8_t reg, const uint8_t *now, const uint8_t *was, uint8_t n, bool all)
+{
+    int16_t first = -1, last = -1;
+
+    for (int16_t i = 0; i < n; i++)
+    {
+        if (all || now[i] != was[i])
+        {
+            if (first < 0) first = i;
+            last = i;
+        }
+    }
+    if (first < 0)
+        return 0;
+
+    Wire.beginTransmission(SI5351_ADDR);
+    Wire.write(reg + first);
+    for (int16_t i = first; i <= last; i++)
+        Wire.write(now[i]);
+    Wire.endTransmission();
+    return last - first + 2;        // data bytes plus the register address
+}
+//
+static void vfo_write_reg(uint8_t reg, uint8_t val)
+{
+    Wire.beginTransmission(SI5351_ADDR);
+    Wire.write(reg);
+    Wire.write(val);
+    Wire.endTransmission();
+}
 //////////////////////////Initialize VFO/DDS//////////////////////////////////////////////////////
 void initVfo()
 {
@@ -9,16 +138,49 @@ delay(100);
 si5351.init(25000000, SI5351_CRYSTAL_LOAD_8PF);   // Si5351mcu library modified by K7MDL to accept load capacitor setting.
 // use the below statement for unmodified library.
 //si5351.init(25000000);
-si5351.correction(1330);
+Wire.setClock(VFO_I2C_CLOCK);  // after init() which starts Wire at the default 100KHz
+si5351.correction(VFO_CORRECTION);
 si5351.setPower(0, SIOUT_8mA);   // 0 is Clock 0
-si5351.setFreq(0, (Freq+Fc)*4);  
 si5351.enable(0);   // these enable/disables are optional
 si5351.disable(1);
 si5351.disable(2);
-si5351.reset();   // Only do for very large change and after initial setup.
+// From here on CLK0 is written directly.  Integer MultiSynth mode, source PLLA, MultiSynth as the clock source.
+vfo_write_reg(SI5351_CLK0_CTRL, 0x40 | 0x0C | VFO_DRIVE);
+vfo_regs_valid = false;
+SetFreq();        // writes every PLL and MultiSynth register and resets the PLL
 }
 
 void SetFreq()
-{ 
- si5351.setFreq(0, (Freq+Fc)*4);  
+{
+ struct Vfo_Regs r;
+
+ vfo_compute((Freq+Fc)*4, vfo_regs_valid ? vfo_regs.ms_div : 0, &r);
+
+ vfo_bytes_last  = vfo_write_block(SI5351_PLLA_REG, r.pll, vfo_regs.pll, 8, !vfo_regs_valid);
+ if (!vfo_regs_valid || r.ms_div != vfo_regs.ms_div)
+ {
+    vfo_bytes_last += vfo_write_block(SI5351_MS0_REG, r.ms, vfo_regs.ms, 8, !vfo_regs_valid);
+    vfo_write_reg(SI5351_PLL_RESET, 0x20);     // reset PLLA
+    vfo_bytes_last += 2;
+    vfo_ms_changes++;
+ }
+ vfo_regs = r;
+ vfo_regs_valid = true;
+ vfo_bytes_total += vfo_bytes_last;
+ vfo_retunes++;
+}
+
+// VFO report for the console 'C' command
+void printVfoStats(void)
+{
+    Serial.print("VFO Retunes: ");
+    Serial.print(vfo_retunes);
+    Serial.print(", MS Changes: ");
+    Serial.print(vfo_ms_changes);
+    Serial.print(", MS Divider: ");
+    Serial.print(vfo_regs.ms_div);
+    Serial.print(", I2C Bytes Last: ");
+    Serial.print(vfo_bytes_last);
+    Serial.print(", Total: ");
+    Serial.println(vfo_bytes_total);
 }
@@ -0,0 +1,161 @@
+//
+// Waterfall_History.h
+//
+// The waterfall on screen is only held in the RA8875 display memory, so redrawing the frame (Dsply button, preset
+// change, resize) used to wipe it.  This keeps the last WF_HIST_ROWS waterfall lines in the Teensy 4.1 PSRAM as
+// one byte per FFT bin, the SPECTRUM_MAX_WIDTH bins around 0Hz.  That is wide enough for any preset layout since
+// the graph shows bins 1:1, so a different width is just a different slice of the same rows.
+//
+// spectrum_update() calls wf_hist_add() once per frame.  It writes one row in place in the ring, nothing is
+// allocated or moved.  wf_hist_repaint() rebuilds the whole waterfall window from the history into one pixel
+// buffer and sends it as a single writeRect.  drawSpectrumFrame() calls it after clearing the window.
+//
+// Scrollback: a vertical drag that starts in the waterfall moves back (drag up) or forward (drag down) through
+// the history.  While scrolled back the live scroll stops and the view stays put as new rows come in.  Dragging
+// back down to the newest row goes live again.
+//
+// Levels are stored in 1 dB steps from WF_HIST_MIN_DB, 0 means no data.  Rows are quantized by spec_rec_quantize(),
+// the same codes the SD card recorder and the host stream use.  With no PSRAM fitted the history is off
+// and the waterfall works as before.
+//
+
+#define WF_HIST_ROWS            8192        // power of 2.  About 8 minutes at the normal 60ms waterfall rate, 4MB
+#define WF_HIST_WIDTH           SPEC_REC_BINS       // bins kept per row, centered on 0Hz
+#define WF_HIST_MIN_DB          SPEC_REC_MIN_DB     // code c is this + c dB
+#define WF_HIST_MARK            0x01        // wf_hist_flags[] bit for a time stamp line
+
+extern "C" uint8_t external_psram_size;    // MB of PSRAM found at startup, 0 if none
+extern int16_t waterfall_speed;
+
+EXTMEM uint8_t  wf_hist[WF_HIST_ROWS][WF_HIST_WIDTH];
+EXTMEM uint8_t  wf_hist_flags[WF_HIST_ROWS];
+EXTMEM uint16_t wf_hist_pixels[WF_HIST_WIDTH * SPECTRUM_MAX_ROWS];  // repaint buffer, one writeRect
+uint32_t wf_hist_head           = 0;        // next row written
+uint32_t wf_hist_count          = 0;        // rows held, up to WF_HIST_ROWS
+uint32_t wf_hist_offset         = 0;        // rows back from the newest the view starts at, 0 = live
+uint32_t wf_hist_repaint_us     = 0;        // time taken by the last wf_hist_repaint()
+
+//function declarations
+bool   wf_hist_ok(void);
+void   wf_hist_add(const float *pout, bool mark);
+void   wf_hist_repaint(struct Spectrum_Parms *ptr);
+void   wf_hist_scroll(int16_t rows);
+bool   wf_hist_in_window(int16_t x, int16_t y);
+void   printWfHistStats(void);
+
+//
+// True if there is PSRAM to keep the history in
+bool wf_hist_ok(void)
+{
+    return external_psram_size > 0;
+}
+//
+// Store one waterfall line.  pout is the frame's dB array in FFT bin order.
+void wf_hist_add(const float *pout, bool mark)
+{
+    if (!wf_hist_ok())
+        return;
+
+    spec_rec_quantize(pout, wf_hist[wf_hist_head]);
+    wf_hist_flags[wf_hist_head] = mark ? WF_HIST_MARK : 0;
+    wf_hist_head = (wf_hist_head + 1) & (WF_HIST_ROWS-1);
+    if (wf_hist_count < WF_HIST_ROWS)
+        wf_hist_count++;
+    if (wf_hist_offset > 0 && wf_hist_offset < wf_hist_count-1)
+        wf_hist_offset++;           // scrolled back, keep the same rows in view
+}
+//
+// Redraw the whole waterfall window from the history, newest row (less wf_hist_offset) at the top
+void wf_hist_repaint(struct Spectrum_Parms *ptr)
+{
+    if (!wf_hist_ok())
+        return;
+
+    uint32_t start  = micros();
+    int16_t  w      = min(ptr->wf_sp_width, WF_HIST_WIDTH);
+    int16_t  rows   = min(ptr->wf_height-3, SPECTRUM_MAX_ROWS);
+    int16_t  center = w/2;
+    int16_t  first  = WF_HIST_WIDTH/2 - center;     // history column of graph column 0
+    bool     table  = ptr->spect_wf_style >= 2;     // styles 0 and 1 have no color table, use the style 2 math
+
+    if (rows <= 0)
+        return;
+    displayQueue_sync();            // the buffer may still be going out from the last repaint
+    palette_check(ptr->spect_wf_style, ptr->spect_wf_colortemp, ptr->spect_wf_scale);
+
+    for (int16_t r = 0; r < rows; r++)
+    {
+        uint16_t *dst = &wf_hist_pixels[r * w];
+        uint32_t  age = wf_hist_offset + r;
+        if (age >= wf_hist_count)
+        {
+            memset(dst, 0, w * sizeof(uint16_t));
+            continue;
+        }
+        uint32_t n = (wf_hist_head - 1 - age) & (WF_HIST_ROWS-1);
+        if (wf_hist_flags[n] & WF_HIST_MARK)
+        {
+            for (int16_t i = 0; i < w; i++)
+                dst[i] = myLT_GREY;
+            continue;
+        }
+        const uint8_t *src = &wf_hist[n][first];
+        for (int16_t i = 0; i < w; i++)
+        {
+            if (i < 2 || i >= w-2 || src[i] == 0)
+                dst[i] = myBLACK;
+            else if (i >= center-SPECTRUM_BLANKING && i <= center+SPECTRUM_BLANKING+1)
+                dst[i] = (i == center) ? myLT_GREY : myBLACK;     // Fc blanking, same as the live line
+            else
+            {
+                float dB = src[i] + WF_HIST_MIN_DB;
+                dst[i] = table ? palette_color(dB) : colorMap(palette_style_val(2, dB, ptr->spect_wf_scale), ptr->spect_wf_colortemp);
+            }
+        }
+    }
+    dq_writeRect(ptr->l_graph_edge+1, ptr->wf_top_line+1, w, rows, wf_hist_pixels);
+    wf_hist_repaint_us = micros() - start;
+}
+//
+// Move the view rows back in time (negative toward live) and redraw the waterfall
+void wf_hist_scroll(int16_t rows)
+{
+    if (!wf_hist_ok() || wf_hist_count == 0)
+        return;
+
+    int32_t offset = (int32_t) wf_hist_offset + rows;
+    wf_hist_offset = constrain(offset, 0, (int32_t) wf_hist_count-1);
+    wf_hist_repaint(&Sp_Parms_Def[spectrum_preset]);
+    Serial.print("Waterfall History: ");
+    if (wf_hist_offset == 0)
+        Serial.println("Live");
+    else
+    {
+        Serial.print(wf_hist_offset * waterfall_speed / 1000.0f, 1);
+        Serial.println(" seconds back");
+    }
+}
+//
+// True if a screen point is inside the current preset's waterfall window
+bool wf_hist_in_window(int16_t x, int16_t y)
+{
+    struct Spectrum_Parms *ptr = &Sp_Parms_Def[spectrum_preset];
+    return x > ptr->l_graph_edge && x <= ptr->l_graph_edge + ptr->wf_sp_width &&
+           y > ptr->wf_top_line  && y <  ptr->wf_top_line + ptr->wf_height;
+}
+//
+// History report for the console 'C' command
+void printWfHistStats(void)
+{
+    Serial.print("Waterfall History: ");
+    if (!wf_hist_ok())
+    {
+        Serial.println("no PSRAM, off");
+        return;
+    }
+    Serial.print(wf_hist_count);
+    Serial.print(" rows, View Offset: ");
+    Serial.print(wf_hist_offset);
+    Serial.print(", Repaint Time (uS): ");
+    Serial.println(wf_hist_repaint_us);
+}
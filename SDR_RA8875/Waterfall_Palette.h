@@ -0,0 +1,148 @@
+//
+// Waterfall_Palette.h
+//
+// Lookup table of RGB565 waterfall colors indexed by signal level.  The table is built once for the current
+// palette, waterfall style, color temperature and waterfall scale, then spectrum_update() gets each waterfall
+// pixel color with a single indexed load instead of running colorMap() per pixel per line.
+//
+// The index is the FFT bin value (dB, sign dropped) in 1/100 dB steps, so 64K entries cover 0 to 655 dB which
+// includes the -500 value used for columns with no FFT bin.  128KB lives in DMAMEM (OCRAM) to leave DTCM alone.
+//
+// Palette 0 "Classic" runs the original colorMap() math for each style so it looks the same as before.  The others
+// are color gradients stored in flash.  Color temperature still stretches the level range on all of them.
+// Waterfall styles 0 and 1 smooth over time using the previous line so they stay on the per-pixel path.
+//
+
+#define PALETTE_LUT_SIZE        65536       // number of table entries
+#define PALETTE_STEPS_PER_DB    100         // table resolution
+#define PALETTE_STOPS           8           // color stops in each gradient palette
+
+extern RA8875   tft;
+int16_t colorMap(int16_t val, int16_t color_temp);
+
+DMAMEM uint16_t palette_lut[PALETTE_LUT_SIZE];
+
+struct Palette_Def {
+    const char *name;
+    uint8_t     rgb[PALETTE_STOPS][3];      // weakest to strongest.  All zero for Classic which uses colorMap()
+};
+
+const struct Palette_Def Palettes[] = {
+    {"Classic",     {{0}}},
+    {"Grayscale",   {{0,0,0},{36,36,36},{73,73,73},{109,109,109},{146,146,146},{182,182,182},{219,219,219},{255,255,255}}},
+    {"Ironbow",     {{0,0,20},{40,0,90},{120,0,140},{190,30,110},{230,90,40},{250,160,0},{255,220,60},{255,255,220}}},
+    {"Blue-Yellow", {{0,0,0},{0,0,120},{0,60,220},{0,180,255},{120,255,120},{255,255,0},{255,120,0},{255,0,0}}},
+    {"Phosphor",    {{0,0,0},{0,30,0},{0,70,0},{0,110,10},{0,160,20},{40,200,40},{120,240,100},{220,255,200}}}
+};
+#define PALETTES (sizeof(Palettes)/sizeof(Palettes[0]))
+
+uint8_t  palette_index          = 0;        // selected entry in Palettes[]
+uint32_t palette_build_us       = 0;        // time taken by the last table rebuild
+
+// What the current table was built for.  palette_index of 255 forces a rebuild.
+static uint8_t  palette_built_index     = 255;
+static int16_t  palette_built_style     = -1;
+static int16_t  palette_built_colortemp = -1;
+static float    palette_built_scale     = -1;
+
+//function declarations
+void palette_build(int16_t style, int16_t color_temp, float scale);
+void palette_check(int16_t style, int16_t color_temp, float scale);
+void palette_select(uint8_t index);
+static inline uint16_t palette_color(float dB);
+
+//
+// Style dependent level to color input value.  Same math the waterfall styles 2-5 used to feed colorMap().
+static int16_t palette_style_val(int16_t style, float dB, float scale)
+{
+    float val;
+
+    switch (style)
+    {
+        case 2:  val = dB * 1.8 * scale;    break;
+        case 3:  val = dB * 0.4 * scale;    break;
+        case 4:  val = 16000 - dB;          break;
+        default: val = dB;                  break;
+    }
+    return constrain(val, -32768.0f, 32767.0f);
+}
+//
+// Color for one gradient palette at val using the same val to 0-1 scaling as colorMap()
+static uint16_t palette_gradient(const struct Palette_Def *pal, int16_t val, int16_t color_temp)
+{
+    float t = val / 65536.0 * color_temp;
+    t = constrain(t, 0.0f, 1.0f) * (PALETTE_STOPS-1);
+    int16_t n = (int16_t) t;
+    if (n >= PALETTE_STOPS-1)
+        n = PALETTE_STOPS-2;
+    float f = t - n;
+
+    uint8_t r = pal->rgb[n][0] + (pal->rgb[n+1][0] - pal->rgb[n][0]) * f;
+    uint8_t g = pal->rgb[n][1] + (pal->rgb[n+1][1] - pal->rgb[n][1]) * f;
+    uint8_t b = pal->rgb[n][2] + (pal->rgb[n+1][2] - pal->rgb[n][2]) * f;
+    return tft.Color565(r, g, b);
+}
+//
+// Fill the table.  Takes a few mS so only call when something it depends on changes.
+void palette_build(int16_t style, int16_t color_temp, float scale)
+{
+    uint32_t start = micros();
+    const struct Palette_Def *pal = &Palettes[palette_index];
+    int16_t  last_val = 0;
+    uint16_t color    = 0;
+
+    for (uint32_t i = 0; i < PALETTE_LUT_SIZE; i++)
+    {
+        int16_t val = palette_style_val(style, (float) i / PALETTE_STEPS_PER_DB, scale);
+        if (i == 0 || val != last_val)      // val moves in whole steps, many entries in a row share a color
+        {
+            if (palette_index == 0)
+            {
+                color = colorMap(val, color_temp);
+                if (style == 4)
+                    color = (int16_t) (((int16_t) color) * scale);
+                else if (style > 4)
+                    color = (int16_t) (((int16_t) color) * scale * 0.1);
+            }
+            else
+                color = palette_gradient(pal, val, color_temp);
+            last_val = val;
+        }
+        palette_lut[i] = color;
+    }
+
+    palette_built_index     = palette_index;
+    palette_built_style     = style;
+    palette_built_colortemp = color_temp;
+    palette_built_scale     = scale;
+    palette_build_us = micros() - start;
+}
+//
+// Called once per spectrum frame.  Rebuilds only if the palette, style, color temp or scale changed.
+void palette_check(int16_t style, int16_t color_temp, float scale)
+{
+    if (style < 2)      // styles 0 and 1 do not use the table
+        return;
+    if (palette_built_index != palette_index || palette_built_style != style ||
+        palette_built_colortemp != color_temp || palette_built_scale != scale)
+        palette_build(style, color_temp, scale);
+}
+//
+// Pick a palette.  The table is rebuilt on the next spectrum frame.
+void palette_select(uint8_t index)
+{
+    if (index >= PALETTES)
+        index = 0;
+    palette_index = index;
+    Serial.print("Waterfall Palette = ");
+    Serial.println(Palettes[palette_index].name);
+}
+//
+// Waterfall color for a FFT bin value
+static inline uint16_t palette_color(float dB)
+{
+    uint32_t idx = fabsf(dB) * PALETTE_STEPS_PER_DB;
+    if (idx >= PALETTE_LUT_SIZE)
+        idx = PALETTE_LUT_SIZE-1;
+    return palette_lut[idx];
+}
@@ -0,0 +1,295 @@
+//
+// rx_bench.cpp
+//
+// Host build of the SDR_RA8875 receive chain for offline IQ replay and benchmarking.  The graph is RX_Chain.h from
+// the sketch, built against the stand-in scheduler and library objects in stub/.  An IQ recording (a 16 bit stereo
+// WAV such as the radio's IQnnnn.WAV, or raw int16 I,Q pairs) is played into the chain through RX_Play and the
+// audio updates are run back to back as fast as the PC allows.  Reports samples/sec, the realtime factor and the
+// time each object spends in update() per block.  The demodulated audio can be written out as a WAV to compare
+// runs by ear or by diff.
+//
+//   rx_bench IQ0003.WAV                      USB, 4KHz bandwidth, slow AGC
+//   rx_bench --raw --rate 51200 iq.raw       raw int16 I,Q pairs
+//   rx_bench --synth 10 --repeat 5           10 seconds of a synthetic test signal, played 5 times
+//   rx_bench --mode lsb --out audio.wav IQ0003.WAV
+//
+// The sample rate, decimation and FFT size are the sketch's compile time settings, see host/Makefile.
+//
+#include <chrono>
+#include <vector>
+#include <OpenAudio_ArduinoLibrary.h>
+#include "AudioFilterIQPhasing_F32.h"
+#include "AudioSDRresample_F32.h"
+#include "AudioSDRzoomIQ_F32.h"
+#include "AudioSDRsmeter_F32.h"
+#include "AudioSDRagc_F32.h"
+#include "AudioSDRpreProcessor_F32.h"
+#include "AudioSDRiqBalance_F32.h"
+#include "AudioSDRrecordIQ_F32.h"
+#include "AudioSDRplayIQ_F32.h"
+#include "RX_Chain.h"
+#include "RadioConfig.h"
+
+static std::vector<int16_t> iq;             // I,Q pairs
+static std::vector<int16_t> audio_out;
+static bool   keep_audio = false;
+static double out_power = 0.0;
+static uint64_t out_samples = 0;
+static int    rec_i2s = 0;                  // I2S lag correction from the ksdr chunk
+static bool   rec_i2s_found = false;        // the recording says which correction it needs
+
+static void output_sink(const float32_t *left, const float32_t *right, int n)
+{
+    (void) right;
+    for (int i = 0; i < n; i++)
+    {
+        out_power += (double) left[i] * left[i];
+        if (keep_audio)
+            audio_out.push_back((int16_t) constrain(lrintf(left[i] * 32767.0f), -32768L, 32767L));
+    }
+    out_samples += n;
+}
+
+static uint32_t get32(const uint8_t *p) {return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);}
+static uint16_t get16(const uint8_t *p) {return p[0] | (p[1] << 8);}
+
+// 16 bit stereo PCM WAV.  The I2S lag correction is taken from the radio's ksdr chunk (version 2 on) if the lag
+// check had finished when it was recorded, other chunks are skipped.
+static bool load_wav(const char *name, float *rate)
+{
+    FILE *f = fopen(name, "rb");
+    if (!f) {perror(name); return false;}
+    std::vector<uint8_t> b;
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        b.insert(b.end(), buf, buf + n);
+    fclose(f);
+    if (b.size() < 12 || memcmp(&b[0], "RIFF", 4) || memcmp(&b[8], "WAVE", 4))
+    {
+        fprintf(stderr, "%s: not a WAV file\n", name);
+        return false;
+    }
+    bool fmt_ok = false;
+    for (size_t p = 12; p + 8 <= b.size(); )
+    {
+        uint32_t len = get32(&b[p + 4]);
+        const uint8_t *c = &b[p + 8];
+        if (!memcmp(&b[p], "fmt ", 4) && len >= 16)
+        {
+            if (get16(c) != 1 || get16(c + 2) != 2 || get16(c + 14) != 16)
+            {
+                fprintf(stderr, "%s: need 16 bit stereo PCM\n", name);
+                return false;
+            }
+            *rate = get32(c + 4);
+            fmt_ok = true;
+        }
+        else if (!memcmp(&b[p], "ksdr", 4) && len >= 60 && get32(c) >= 2)
+        {
+            rec_i2s = (int16_t) get16(c + 56);
+            rec_i2s_found = c[58] != 0;
+        }
+        else if (!memcmp(&b[p], "data", 4) && fmt_ok)
+        {
+            if (len == 0 || p + 8 + len > b.size())     // size never filled in, recording cut short
+                len = b.size() - p - 8;
+            iq.resize(len / 2 & ~1u);
+            memcpy(iq.data(), c, iq.size() * 2);
+            return true;
+        }
+        p += 8 + len + (len & 1);
+    }
+    fprintf(stderr, "%s: no data chunk\n", name);
+    return false;
+}
+
+static bool load_raw(const char *name)
+{
+    FILE *f = fopen(name, "rb");
+    if (!f) {perror(name); return false;}
+    int16_t buf[8192];
+    size_t n;
+    while ((n = fread(buf, 2, 8192, f)) > 0)
+        iq.insert(iq.end(), buf, buf + n);
+    fclose(f);
+    iq.resize(iq.size() & ~(size_t) 1);
+    return true;
+}
+
+// A tone 1KHz off the center at -20dBFS, a weaker one 1KHz the other side, a 2% gain and 2 degree phase error so
+// the IQ balance has work to do, and noise at about -70dBFS
+static void make_synth(float seconds)
+{
+    uint32_t pairs = seconds * sample_rate_Hz;
+    uint32_t seed = 1;
+    iq.resize(2 * pairs);
+    for (uint32_t k = 0; k < pairs; k++)
+    {
+        double t = k / (double) sample_rate_Hz;
+        double a = 2 * M_PI * 1000.0 * t;
+        double i = 0.1 * cos(a) + 0.01 * cos(-a);
+        double q = 0.1 * sin(a) + 0.01 * sin(-a);
+        q = 1.02 * (q * cos(2 * M_PI / 180) + i * sin(2 * M_PI / 180));
+        seed = seed * 1664525u + 1013904223u;
+        i += ((int32_t) seed >> 8) / 8388608.0 * 0.0005;
+        seed = seed * 1664525u + 1013904223u;
+        q += ((int32_t) seed >> 8) / 8388608.0 * 0.0005;
+        iq[2*k]   = (int16_t) lrint(i * 32767.0);
+        iq[2*k+1] = (int16_t) lrint(q * 32767.0);
+    }
+}
+
+static void put32(FILE *f, uint32_t v) {uint8_t b[4] = {(uint8_t) v, (uint8_t) (v >> 8), (uint8_t) (v >> 16), (uint8_t) (v >> 24)}; fwrite(b, 1, 4, f);}
+static void put16(FILE *f, uint16_t v) {uint8_t b[2] = {(uint8_t) v, (uint8_t) (v >> 8)}; fwrite(b, 1, 2, f);}
+
+static void write_wav(const char *name, const std::vector<int16_t> &s, uint32_t rate)
+{
+    FILE *f = fopen(name, "wb");
+    if (!f) {perror(name); return;}
+    uint32_t bytes = s.size() * 2;
+    fwrite("RIFF", 1, 4, f); put32(f, 36 + bytes); fwrite("WAVEfmt ", 1, 8, f);
+    put32(f, 16); put16(f, 1); put16(f, 1); put32(f, rate); put32(f, rate * 2); put16(f, 2); put16(f, 16);
+    fwrite("data", 1, 4, f); put32(f, bytes);
+    fwrite(s.data(), 2, s.size(), f);
+    fclose(f);
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+        "usage: rx_bench [options] [file]\n"
+        "  file             16 bit stereo WAV, I left, Q right (the radio's IQnnnn.WAV)\n"
+        "  --raw            file is raw int16 I,Q pairs\n"
+        "  --rate HZ        sample rate of a raw file, default the sketch's capture rate\n"
+        "  --synth SECONDS  use a synthetic test signal instead of a file\n"
+        "  --repeat N       play the recording N times, default 1\n"
+        "  --mode usb|lsb   default usb\n"
+        "  --bw LOW HIGH    Hilbert passband in Hz, default 150 4500 (the 4.0 kHz setting)\n"
+        "  --agc N          agc_set[] entry, 0 off to 3 fast, default 1\n"
+        "  --i2s N          I2S lag correction for RX_PreProc, -1 0 or 1, default the recording's or 0\n"
+        "  --out FILE       write the demodulated audio as a mono WAV\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    const char *file = NULL, *out = NULL;
+    bool  raw = false, usb = true;
+    float synth = 0.0f, rate = 0.0f, bw_lo = 150.0f, bw_hi = 4500.0f;
+    int   repeat = 1, agc_index = AGC_SLOW, i2s = 0;
+    bool  i2s_given = false;
+
+    for (int a = 1; a < argc; a++)
+    {
+        std::string o = argv[a];
+        bool more = a + 1 < argc;
+        if (o == "--raw") raw = true;
+        else if (o == "--rate" && more) rate = atof(argv[++a]);
+        else if (o == "--synth" && more) synth = atof(argv[++a]);
+        else if (o == "--repeat" && more) repeat = std::max(1, atoi(argv[++a]));
+        else if (o == "--mode" && more) usb = std::string(argv[++a]) != "lsb";
+        else if (o == "--bw" && a + 2 < argc) {bw_lo = atof(argv[++a]); bw_hi = atof(argv[++a]);}
+        else if (o == "--agc" && more) agc_index = constrain(atoi(argv[++a]), 0, AGS_SET_NUM - 1);
+        else if (o == "--i2s" && more) {i2s = constrain(atoi(argv[++a]), -1, 1); i2s_given = true;}
+        else if (o == "--out" && more) out = argv[++a];
+        else if (o[0] == '-') usage();
+        else file = argv[a];
+    }
+    if (file)
+    {
+        if (raw ? !load_raw(file) : !load_wav(file, &rate))
+            return 1;
+        if (rec_i2s_found && !i2s_given)
+        {
+            i2s = constrain(rec_i2s, -1, 1);
+            printf("I2S lag correction %d, from the recording\n", i2s);
+        }
+    }
+    else
+        make_synth(synth > 0.0f ? synth : 10.0f);
+    if (rate == 0.0f)
+        rate = sample_rate_Hz;
+    if (rate != sample_rate_Hz)
+        printf("Note: recording is %.0fHz, the chain is built for %.0fHz and plays it at that rate\n", rate, sample_rate_Hz);
+    uint32_t pairs = iq.size() / 2;
+    if (pairs < (uint32_t) audio_block_samples)
+    {
+        fprintf(stderr, "recording too short\n");
+        return 1;
+    }
+
+    // Same setup as setup() in the sketch, for the parts that are not display or codec
+    AudioMemory_F32(50, audio_settings);
+    rx_chain_begin();
+    RX_PreProc.stopAutoI2SerrorDetection();     // the lag check runs off the spectrum display on the radio
+    RX_PreProc.setI2SerrorCompensation(i2s);
+    IQ_Balance.enable(true);
+    if (RX_Decimate.getFactor() == 1)
+        RX_Hilbert.design(bw_lo, bw_hi, 151, sample_rate_Hz);
+    else
+        RX_Hilbert.design(bw_lo, bw_hi, 151, rx_sample_rate_Hz);
+    RX_Hilbert.setSideband(usb ? IQ_PHASING_USB : IQ_PHASING_LSB);     // as selectMode()
+    struct AGC *g = &agc_set[agc_index];
+    RX_AGC.setParams(g->agc_maxGain, g->agc_threshold, g->agc_attack, g->agc_decay, g->agc_hang, g->agc_hardlimit);
+    RX_AGC.enable(agc_index != AGC_OFF);
+    FFT_Switch1.gain(0, 1.0f);
+    FFT_Switch1.gain(1, 0.0f);
+    FFT_Switch2.gain(0, 1.0f);
+    FFT_Switch2.gain(1, 0.0f);
+    myFFT.setOutputType(FFT_POWER);
+    myFFT.windowFunction(AudioWindowHanning1024);
+    keep_audio = (out != NULL);
+    AudioOutputI2S_F32::host_sink = output_sink;
+
+    // Run it
+    uint64_t blocks = 0, fft_frames = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeat; r++)
+    {
+        RX_Play.playMemory(iq.data(), pairs, false);
+        while (RX_Play.isPlaying())
+        {
+            host_audio_update();
+            blocks++;
+            if (myFFT.available())
+                fft_frames++;
+        }
+    }
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    // Report
+    double samples  = (double) blocks * audio_block_samples;
+    double block_us = audio_block_samples / sample_rate_Hz * 1e6;
+    double chain_ns = 0.0;
+    for (uint16_t i = 0; i < RX_CHAIN_OBJECTS; i++)
+        chain_ns += rx_chain[i].obj->host_ns_total;
+    printf("RX chain: %.0fHz capture, %d samples/block, decimate by %d, FFT %d\n",
+           sample_rate_Hz, audio_block_samples, RX_DECIMATION, FFT_SIZE);
+    printf("Input: %s, %u sample pairs (%.2f s), played %d time%s\n", file ? file : "synthetic",
+           pairs, pairs / sample_rate_Hz, repeat, repeat > 1 ? "s" : "");
+    printf("Blocks: %llu, %.0f samples in %.3f s wall\n", (unsigned long long) blocks, samples, wall);
+    printf("Throughput: %.0f samples/sec, %.1fx realtime (update() time only: %.0f samples/sec, %.1fx)\n",
+           samples / wall, samples / sample_rate_Hz / wall,
+           samples / (chain_ns * 1e-9), samples / sample_rate_Hz / (chain_ns * 1e-9));
+    printf("%-16s %10s %10s %7s\n", "object", "avg us/blk", "max us", "share");
+    for (uint16_t i = 0; i < RX_CHAIN_OBJECTS; i++)
+    {
+        AudioStream *s = rx_chain[i].obj;
+        double avg = s->host_updates ? s->host_ns_total / 1000.0 / s->host_updates : 0.0;
+        printf("%-16s %10.3f %10.3f %6.1f%%\n", rx_chain[i].name, avg, s->host_ns_max / 1000.0,
+               chain_ns > 0 ? 100.0 * s->host_ns_total / chain_ns : 0.0);
+    }
+    printf("%-16s %10.3f            of %.1f us per block\n", "total", chain_ns / 1000.0 / blocks, block_us);
+    printf("FFT frames: %llu, S meter: %.1f dBFS, IQ image rejection: %.1f dB (%.1f dB uncorrected), "
+           "audio out: %.1f dBFS rms, most blocks in use: %d\n",
+           (unsigned long long) fft_frames, S_Meter.getdBFS(), IQ_Balance.getImageRejection_dB(),
+           IQ_Balance.getRawImageRejection_dB(),
+           10.0 * log10(out_power / std::max<uint64_t>(out_samples, 1) + 1e-20), AudioMemoryUsageMax_F32());
+    if (out)
+    {
+        write_wav(out, audio_out, (uint32_t) sample_rate_Hz);
+        printf("Audio written to %s\n", out);
+    }
+    return 0;
+}
@@ -0,0 +1,53 @@
+//
+// Arduino.cpp
+//
+// Host Serial, time and test hooks, see Arduino.h
+//
+#include <chrono>
+#include <deque>
+#include <thread>
+#include "Arduino.h"
+
+HostSerial Serial;
+int64_t host_time_us = -1;
+int host_serial_room = 6144;                    // about what the Teensy USB serial buffers hold
+
+static std::deque<uint8_t> serial_in;
+static std::string *serial_capture = NULL;
+
+static uint64_t clock_us(void)
+{
+    static auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+uint32_t micros(void) {return host_time_us >= 0 ? (uint32_t) host_time_us : (uint32_t) clock_us();}
+uint32_t millis(void) {return host_time_us >= 0 ? (uint32_t) (host_time_us / 1000) : (uint32_t) (clock_us() / 1000);}
+void delay(uint32_t ms)
+{
+    if (host_time_us >= 0)
+        host_time_us += (int64_t) ms * 1000;
+    else
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+size_t HostSerial::write(const uint8_t *p, size_t n)
+{
+    if (serial_capture)
+        serial_capture->append((const char *) p, n);
+    else
+        fwrite(p, 1, n, stdout);
+    return n;
+}
+int HostSerial::availableForWrite(void) {return host_serial_room;}
+int HostSerial::available(void)         {return (int) serial_in.size();}
+int HostSerial::read(void)
+{
+    if (serial_in.empty())
+        return -1;
+    int c = serial_in.front();
+    serial_in.pop_front();
+    return c;
+}
+
+void host_serial_feed(const uint8_t *p, size_t n) {serial_in.insert(serial_in.end(), p, p + n);}
+void host_serial_capture(std::string *buf)        {serial_capture = buf;}
@@ -0,0 +1,97 @@
+//
+// Arduino.h
+//
+// Host stand-in for the parts of the Teensy core the sketch files use.  Serial prints to stdout and reads from
+// a byte queue a test can fill with host_serial_feed().  Interrupt masking and barriers do nothing, everything
+// here runs on one thread.  millis() and micros() are real time since start unless a test sets host_time_us.
+//
+#ifndef host_arduino_h_
+#define host_arduino_h_
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+typedef bool boolean;
+
+#define DMAMEM
+#define EXTMEM
+#define PROGMEM
+#define FASTRUN
+#ifndef PI
+#define PI                  3.1415926535897932384626433832795
+#endif
+#ifndef AUDIO_BLOCK_SAMPLES
+#define AUDIO_BLOCK_SAMPLES 128
+#endif
+#define AUDIO_SAMPLE_RATE_EXACT 44117.64706f
+#define DEC 10
+#define HEX 16
+
+using std::min;
+using std::max;
+template <class T, class L, class H> static inline T constrain(T x, L lo, H hi)
+{
+    return x < (T) lo ? (T) lo : (x > (T) hi ? (T) hi : x);
+}
+
+static inline void __disable_irq(void) {}
+static inline void __enable_irq(void) {}
+static inline void __DMB(void) {}
+static inline int32_t __SSAT(int32_t v, int bits)
+{
+    int32_t m = 1 << (bits - 1);
+    return v < -m ? -m : (v > m - 1 ? m - 1 : v);
+}
+static inline void AudioNoInterrupts(void) {}
+static inline void AudioInterrupts(void) {}
+
+extern int64_t host_time_us;        // >= 0 makes millis() and micros() return this instead of the clock
+uint32_t millis(void);
+uint32_t micros(void);
+void     delay(uint32_t ms);
+
+class String : public std::string {
+  public:
+    String() {}
+    String(const char *s) : std::string(s) {}
+    String(const std::string &s) : std::string(s) {}
+    const char *c_str(void) const {return std::string::c_str();}
+};
+
+class HostSerial {
+  public:
+    void   begin(uint32_t) {}
+    size_t print(const char *s)        {return fputs(s, stdout) >= 0 ? strlen(s) : 0;}
+    size_t print(const String &s)      {return print(s.c_str());}
+    size_t print(char c)               {return putchar(c) == EOF ? 0 : 1;}
+    size_t print(int v, int b = DEC)            {return b == HEX ? printf("%X", v) : printf("%d", v);}
+    size_t print(unsigned v, int b = DEC)       {return b == HEX ? printf("%X", v) : printf("%u", v);}
+    size_t print(long v, int b = DEC)           {return b == HEX ? printf("%lX", v) : printf("%ld", v);}
+    size_t print(unsigned long v, int b = DEC)  {return b == HEX ? printf("%lX", v) : printf("%lu", v);}
+    size_t print(long long v)          {return printf("%lld", v);}
+    size_t print(unsigned long long v) {return printf("%llu", v);}
+    size_t print(double v, int digits = 2)      {return printf("%.*f", digits, v);}
+    size_t println(void)               {return print("\n");}
+    template <class T> size_t println(T v)            {size_t n = print(v); return n + println();}
+    template <class T> size_t println(T v, int f)     {size_t n = print(v, f); return n + println();}
+    size_t write(const uint8_t *p, size_t n);
+    size_t write(uint8_t b)            {return write(&b, 1);}
+    int    availableForWrite(void);
+    int    available(void);
+    int    read(void);
+    void   flush(void) {fflush(stdout);}
+    operator bool() {return true;}
+};
+extern HostSerial Serial;
+
+// Test hooks.  Bytes fed here come back from Serial.read().  Serial.write() goes to stdout unless a capture
+// buffer is set, and availableForWrite() reports host_serial_room.
+void host_serial_feed(const uint8_t *p, size_t n);
+void host_serial_capture(std::string *buf);
+extern int host_serial_room;
+#endif
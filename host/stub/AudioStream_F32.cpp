@@ -0,0 +1,178 @@
+//
+// AudioStream_F32.cpp
+//
+// Host block pool and update scheduler, see AudioStream_F32.h
+//
+#include <chrono>
+#include <vector>
+#include "AudioStream_F32.h"
+
+struct AudioConnection_F32_Link {
+    AudioStream_F32          *dst;
+    unsigned char             src_index;
+    unsigned char             dst_index;
+    AudioConnection_F32_Link *next_dest;
+};
+
+AudioStream *AudioStream::host_first = NULL;
+
+static std::vector<audio_block_f32_t> pool;
+static std::vector<audio_block_f32_t *> pool_free;
+static int pool_block_samples = AUDIO_BLOCK_SAMPLES;
+static int pool_used = 0;
+static int pool_used_max = 0;
+static uint64_t cycle_ns_last = 0;
+static uint64_t cycle_ns_max = 0;
+static float    host_block_period_ns = AUDIO_BLOCK_SAMPLES / AUDIO_SAMPLE_RATE_EXACT * 1e9f;
+
+static uint64_t now_ns(void)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ---- AudioStream
+AudioStream::AudioStream()
+{
+    AudioStream **p = &host_first;
+    while (*p) p = &(*p)->host_next;
+    *p = this;
+}
+float AudioStream::processorUsage(void)
+{
+    return host_ns_last * 100.0f / host_block_period_ns;
+}
+float AudioStream::processorUsageMax(void)
+{
+    return host_ns_max * 100.0f / host_block_period_ns;
+}
+
+// ---- AudioSettings_F32, figures for the whole update cycle
+float AudioSettings_F32::processorUsage(void)    {return cycle_ns_last * 100.0f / host_block_period_ns;}
+float AudioSettings_F32::processorUsageMax(void) {return cycle_ns_max * 100.0f / host_block_period_ns;}
+void  AudioSettings_F32::processorUsageMaxReset(void) {cycle_ns_max = 0;}
+
+// ---- AudioStream_F32
+AudioStream_F32::AudioStream_F32(unsigned char ninput, audio_block_f32_t **iqueue) :
+    num_inputs(ninput), inputQueue(iqueue)
+{
+    for (int i = 0; i < ninput; i++)
+        inputQueue[i] = NULL;
+}
+
+audio_block_f32_t *AudioStream_F32::allocate_f32(void)
+{
+    if (pool_free.empty())
+        return NULL;
+    audio_block_f32_t *b = pool_free.back();
+    pool_free.pop_back();
+    b->ref_count = 1;
+    b->length = b->full_length = pool_block_samples;
+    if (++pool_used > pool_used_max) pool_used_max = pool_used;
+    return b;
+}
+
+void AudioStream_F32::release(audio_block_f32_t *block)
+{
+    if (!block || block->ref_count == 0)
+        return;
+    if (--block->ref_count == 0)
+    {
+        pool_free.push_back(block);
+        pool_used--;
+    }
+}
+
+// Same rule as the library: a destination input that still holds a block does not get this one
+void AudioStream_F32::transmit(audio_block_f32_t *block, unsigned char index)
+{
+    for (AudioConnection_F32_Link *c = destination_list; c; c = c->next_dest)
+    {
+        if (c->src_index == index && c->dst->inputQueue[c->dst_index] == NULL)
+        {
+            c->dst->inputQueue[c->dst_index] = block;
+            block->ref_count++;
+        }
+    }
+}
+
+audio_block_f32_t *AudioStream_F32::receiveReadOnly_f32(unsigned int index)
+{
+    if (index >= num_inputs)
+        return NULL;
+    audio_block_f32_t *b = inputQueue[index];
+    inputQueue[index] = NULL;
+    return b;
+}
+
+audio_block_f32_t *AudioStream_F32::receiveWritable_f32(unsigned int index)
+{
+    audio_block_f32_t *b = receiveReadOnly_f32(index);
+    if (b && b->ref_count > 1)
+    {
+        audio_block_f32_t *copy = allocate_f32();
+        if (copy)
+        {
+            memcpy(copy->data, b->data, sizeof(copy->data));
+            copy->length = b->length;
+            copy->fs_Hz = b->fs_Hz;
+            copy->id = b->id;
+        }
+        release(b);
+        b = copy;
+    }
+    return b;
+}
+
+// ---- AudioConnection_F32
+AudioConnection_F32::AudioConnection_F32(AudioStream_F32 &source, unsigned char sourceOutput,
+                                         AudioStream_F32 &destination, unsigned char destinationInput)
+{
+    AudioConnection_F32_Link *l = new AudioConnection_F32_Link {&destination, sourceOutput, destinationInput, NULL};
+    AudioConnection_F32_Link **p = &source.destination_list;
+    while (*p) p = &(*p)->next_dest;
+    *p = l;
+}
+
+// ---- Pool
+void AudioMemory_F32(int num, const AudioSettings_F32 &settings)
+{
+    pool.assign(num, audio_block_f32_t());
+    pool_free.clear();
+    for (int i = num - 1; i >= 0; i--)
+    {
+        pool[i].ref_count = 0;
+        pool[i].pool_index = i;
+        pool_free.push_back(&pool[i]);
+    }
+    pool_block_samples = settings.audio_block_samples;
+    host_block_period_ns = settings.audio_block_samples / settings.sample_rate_Hz * 1e9f;
+    pool_used = pool_used_max = 0;
+}
+int AudioMemoryUsage_F32(void)    {return pool_used;}
+int AudioMemoryUsageMax_F32(void) {return pool_used_max;}
+
+// ---- Scheduler
+void host_audio_update(void)
+{
+    uint64_t start = now_ns();
+    for (AudioStream *s = AudioStream::host_first; s; s = s->host_next)
+    {
+        uint64_t t = now_ns();
+        s->update();
+        uint64_t dt = now_ns() - t;
+        s->host_ns_last   = dt;
+        s->host_ns_total += dt;
+        s->host_updates++;
+        if (dt > s->host_ns_max) s->host_ns_max = dt;
+    }
+    cycle_ns_last = now_ns() - start;
+    if (cycle_ns_last > cycle_ns_max) cycle_ns_max = cycle_ns_last;
+}
+
+void host_audio_reset_times(void)
+{
+    for (AudioStream *s = AudioStream::host_first; s; s = s->host_next)
+        s->host_ns_last = s->host_ns_max = s->host_ns_total = s->host_updates = 0;
+    cycle_ns_last = cycle_ns_max = 0;
+}
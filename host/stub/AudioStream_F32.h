@@ -0,0 +1,86 @@
+//
+// AudioStream_F32.h
+//
+// Host stand-in for the Teensy AudioStream and OpenAudio AudioStream_F32 scheduler.  Same block pool, reference
+// counting, transmit and receive rules as the library, so the sketch's F32 objects build and behave unchanged.
+// There is no audio interrupt.  host_audio_update() runs one update cycle, calling every object's update() in the
+// order the objects were constructed just like the library's update list, and times each call.
+//
+#ifndef host_audio_stream_f32_h_
+#define host_audio_stream_f32_h_
+#include "Arduino.h"
+#include "arm_math.h"
+
+class AudioStream_F32;
+
+typedef struct audio_block_f32_struct {
+    uint8_t   ref_count;
+    uint8_t   pool_index;
+    int       length;                   // samples in data[] that are in use
+    int       full_length;
+    float32_t fs_Hz;
+    uint32_t  id;
+    float32_t data[AUDIO_BLOCK_SAMPLES];
+} audio_block_f32_t;
+
+class AudioSettings_F32 {
+  public:
+    AudioSettings_F32(float fs_Hz, int block_size) : sample_rate_Hz(fs_Hz), audio_block_samples(block_size) {}
+    const float sample_rate_Hz;
+    const int   audio_block_samples;
+    float processorUsage(void);
+    float processorUsageMax(void);
+    void  processorUsageMaxReset(void);
+};
+
+// The core library base class.  On the host the cpu figures are kept in ns of wall clock time per update().
+class AudioStream {
+  public:
+    AudioStream();
+    virtual ~AudioStream() {}
+    virtual void update(void) = 0;
+    float    processorUsage(void);      // percent of the core library block period, as on the Teensy
+    float    processorUsageMax(void);
+    void     processorUsageMaxReset(void) {host_ns_max = 0;}
+    // host only
+    uint64_t host_ns_last   = 0;
+    uint64_t host_ns_max    = 0;
+    uint64_t host_ns_total  = 0;
+    uint32_t host_updates   = 0;
+    AudioStream *host_next  = NULL;     // update list, construction order
+    static AudioStream *host_first;
+};
+
+struct AudioConnection_F32_Link;
+
+class AudioStream_F32 : public AudioStream {
+  public:
+    AudioStream_F32(unsigned char ninput, audio_block_f32_t **iqueue);
+    static audio_block_f32_t *allocate_f32(void);
+    static void release(audio_block_f32_t *block);
+  protected:
+    void transmit(audio_block_f32_t *block, unsigned char index = 0);
+    audio_block_f32_t *receiveReadOnly_f32(unsigned int index = 0);
+    audio_block_f32_t *receiveWritable_f32(unsigned int index = 0);
+  private:
+    unsigned char       num_inputs;
+    audio_block_f32_t **inputQueue;
+    AudioConnection_F32_Link *destination_list = NULL;
+    friend class AudioConnection_F32;
+};
+
+class AudioConnection_F32 {
+  public:
+    AudioConnection_F32(AudioStream_F32 &source, unsigned char sourceOutput,
+                        AudioStream_F32 &destination, unsigned char destinationInput);
+};
+
+// Block pool, same calls as the library
+void     AudioMemory_F32(int num, const AudioSettings_F32 &settings);
+int      AudioMemoryUsage_F32(void);
+int      AudioMemoryUsageMax_F32(void);
+
+// Host scheduler
+void     host_audio_update(void);                   // one update cycle of every object
+void     host_audio_reset_times(void);
+#endif
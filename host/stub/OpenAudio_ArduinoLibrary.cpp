@@ -0,0 +1,132 @@
+//
+// OpenAudio_ArduinoLibrary.cpp
+//
+// Host stand-ins for the OpenAudio F32 objects, see OpenAudio_ArduinoLibrary.h
+//
+#include "OpenAudio_ArduinoLibrary.h"
+
+void (*AudioOutputI2S_F32::host_sink)(const float32_t *left, const float32_t *right, int n) = NULL;
+
+// ---- I2S input, silence
+void AudioInputI2S_F32::update(void)
+{
+    audio_block_f32_t *l = allocate_f32();
+    audio_block_f32_t *r = allocate_f32();
+    if (l && r)
+    {
+        memset(l->data, 0, sizeof(l->data));
+        memset(r->data, 0, sizeof(r->data));
+        transmit(l, 0);
+        transmit(r, 1);
+    }
+    release(l);
+    release(r);
+}
+
+// ---- I2S output
+void AudioOutputI2S_F32::update(void)
+{
+    audio_block_f32_t *l = receiveReadOnly_f32(0);
+    audio_block_f32_t *r = receiveReadOnly_f32(1);
+    if (host_sink && l)
+        host_sink(l->data, r ? r->data : l->data, l->length);
+    release(l);
+    release(r);
+}
+
+// ---- Mixer
+void AudioMixer4_F32::update(void)
+{
+    audio_block_f32_t *out = NULL;
+
+    for (int ch = 0; ch < 4; ch++)
+    {
+        audio_block_f32_t *in = receiveReadOnly_f32(ch);
+        if (!in)
+            continue;
+        if (!out)
+        {
+            out = allocate_f32();
+            if (!out) {release(in); return;}
+            out->length = in->length;
+            arm_scale_f32(in->data, multiplier[ch], out->data, in->length);
+        }
+        else
+        {
+            for (int i = 0; i < in->length && i < out->length; i++)
+                out->data[i] += in->data[i] * multiplier[ch];
+        }
+        release(in);
+    }
+    if (out)
+    {
+        transmit(out);
+        release(out);
+    }
+}
+
+// ---- Biquad, RBJ cookbook coefficients
+void AudioFilterBiquad_F32::setStage(uint32_t stage, double b0, double b1, double b2, double a0, double a1, double a2)
+{
+    if (stage >= 4)
+        return;
+    float *c = &coeff[5 * stage];
+    c[0] = b0 / a0;  c[1] = b1 / a0;  c[2] = b2 / a0;
+    c[3] = -a1 / a0; c[4] = -a2 / a0;               // CMSIS adds the feedback terms
+    if (stage + 1 > stages)
+        stages = stage + 1;
+    arm_biquad_cascade_df1_init_f32(&iir, stages, coeff, state);
+}
+void AudioFilterBiquad_F32::setLowpass(uint32_t stage, float frequency, float q)
+{
+    double w = 2.0 * M_PI * frequency / sampleRate_Hz, a = sin(w) / (2.0 * q), c = cos(w);
+    setStage(stage, (1.0 - c) / 2.0, 1.0 - c, (1.0 - c) / 2.0, 1.0 + a, -2.0 * c, 1.0 - a);
+}
+void AudioFilterBiquad_F32::setHighpass(uint32_t stage, float frequency, float q)
+{
+    double w = 2.0 * M_PI * frequency / sampleRate_Hz, a = sin(w) / (2.0 * q), c = cos(w);
+    setStage(stage, (1.0 + c) / 2.0, -(1.0 + c), (1.0 + c) / 2.0, 1.0 + a, -2.0 * c, 1.0 - a);
+}
+void AudioFilterBiquad_F32::setBandpass(uint32_t stage, float frequency, float q)
+{
+    double w = 2.0 * M_PI * frequency / sampleRate_Hz, a = sin(w) / (2.0 * q), c = cos(w);
+    setStage(stage, a, 0.0, -a, 1.0 + a, -2.0 * c, 1.0 - a);
+}
+void AudioFilterBiquad_F32::update(void)
+{
+    audio_block_f32_t *b = receiveWritable_f32(0);
+    if (!b)
+        return;
+    if (stages)
+        arm_biquad_cascade_df1_f32(&iir, b->data, b->data, b->length);
+    transmit(b);
+    release(b);
+}
+
+// ---- Peak
+void AudioAnalyzePeak_F32::update(void)
+{
+    audio_block_f32_t *b = receiveReadOnly_f32(0);
+    if (!b)
+        return;
+    for (int i = 0; i < b->length; i++)
+    {
+        if (b->data[i] > max_v) max_v = b->data[i];
+        if (b->data[i] < min_v) min_v = b->data[i];
+    }
+    new_output = true;
+    release(b);
+}
+
+// ---- RMS
+void AudioAnalyzeRMS_F32::update(void)
+{
+    audio_block_f32_t *b = receiveReadOnly_f32(0);
+    if (!b)
+        return;
+    float p;
+    arm_power_f32(b->data, b->length, &p);
+    accum += p;
+    count += b->length;
+    release(b);
+}
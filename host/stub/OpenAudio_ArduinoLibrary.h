@@ -0,0 +1,163 @@
+//
+// OpenAudio_ArduinoLibrary.h
+//
+// Host stand-ins for the OpenAudio F32 library objects the receive chain uses.  Same class names, constructors and
+// control calls as the library, doing the same kind of work per block (mixer sums, biquad cascade, windowed FFT,
+// peak and RMS), so the chain builds unchanged and the timings are in proportion.  They are not copies of the
+// library code, the numbers they produce are close but not bit exact.
+//
+// The I2S input sends silence, a recording is played into the chain through RX_Play.  The I2S output hands its
+// blocks to AudioOutputI2S_F32::host_sink if one is set.
+//
+#ifndef host_openaudio_h_
+#define host_openaudio_h_
+#include "Arduino.h"
+#include "AudioStream_F32.h"
+
+// ---- I2S
+class AudioInputI2S_F32 : public AudioStream_F32 {
+  public:
+    AudioInputI2S_F32(const AudioSettings_F32 &settings) : AudioStream_F32(0, NULL) {(void) settings;}
+    virtual void update(void);
+};
+
+class AudioOutputI2S_F32 : public AudioStream_F32 {
+  public:
+    AudioOutputI2S_F32(const AudioSettings_F32 &settings) : AudioStream_F32(2, inputQueueArray) {(void) settings;}
+    virtual void update(void);
+    static void (*host_sink)(const float32_t *left, const float32_t *right, int n);
+  private:
+    audio_block_f32_t *inputQueueArray[2];
+};
+
+// ---- Mixer
+class AudioMixer4_F32 : public AudioStream_F32 {
+  public:
+    AudioMixer4_F32() : AudioStream_F32(4, inputQueueArray) {for (int i = 0; i < 4; i++) multiplier[i] = 1.0f;}
+    virtual void update(void);
+    void gain(unsigned int channel, float g) {if (channel < 4) multiplier[channel] = g;}
+  private:
+    audio_block_f32_t *inputQueueArray[4];
+    float multiplier[4];
+};
+
+// ---- Biquad, up to 4 stages.  Passes blocks through until a stage is set, like the library.
+class AudioFilterBiquad_F32 : public AudioStream_F32 {
+  public:
+    AudioFilterBiquad_F32() : AudioStream_F32(1, inputQueueArray) {}
+    AudioFilterBiquad_F32(const AudioSettings_F32 &settings) : AudioStream_F32(1, inputQueueArray)
+        {sampleRate_Hz = settings.sample_rate_Hz;}
+    virtual void update(void);
+    void setSampleRate_Hz(float fs_Hz) {sampleRate_Hz = fs_Hz;}
+    void setLowpass(uint32_t stage, float frequency, float q = 0.7071f);
+    void setHighpass(uint32_t stage, float frequency, float q = 0.7071f);
+    void setBandpass(uint32_t stage, float frequency, float q = 1.0f);
+  private:
+    audio_block_f32_t *inputQueueArray[1];
+    float    sampleRate_Hz = AUDIO_SAMPLE_RATE_EXACT;
+    float    coeff[5 * 4];
+    float    state[4 * 4];
+    uint32_t stages = 0;
+    arm_biquad_casd_df1_inst_f32 iir;
+    void     setStage(uint32_t stage, double b0, double b1, double b2, double a0, double a1, double a2);
+};
+
+// ---- Analyzers
+class AudioAnalyzePeak_F32 : public AudioStream_F32 {
+  public:
+    AudioAnalyzePeak_F32() : AudioStream_F32(1, inputQueueArray) {}
+    virtual void update(void);
+    bool  available(void) {bool a = new_output; new_output = false; return a;}
+    float read(void) {float r = max_v > -min_v ? max_v : -min_v; min_v = max_v = 0.0f; return r;}
+    float readPeakToPeak(void) {float r = max_v - min_v; min_v = max_v = 0.0f; return r;}
+  private:
+    audio_block_f32_t *inputQueueArray[1];
+    float min_v = 0.0f, max_v = 0.0f;
+    bool  new_output = false;
+};
+
+class AudioAnalyzeRMS_F32 : public AudioStream_F32 {
+  public:
+    AudioAnalyzeRMS_F32() : AudioStream_F32(1, inputQueueArray) {}
+    virtual void update(void);
+    bool  available(void) {return count > 0;}
+    float read(void) {float r = count ? sqrtf(accum / count) : 0.0f; accum = 0.0; count = 0; return r;}
+  private:
+    audio_block_f32_t *inputQueueArray[1];
+    double   accum = 0.0;
+    uint32_t count = 0;
+};
+
+// ---- IQ FFT.  N point complex FFT of I and Q, half overlapped, Hanning window if one is selected.
+#define FFT_RMS                 0
+#define FFT_POWER               1
+#define FFT_DBFS                2
+#define AudioWindowNone         0
+#define AudioWindowHanning1024  1
+
+template <int N>
+class AudioAnalyzeFFT_IQ_F32 : public AudioStream_F32 {
+  public:
+    AudioAnalyzeFFT_IQ_F32() : AudioStream_F32(2, inputQueueArray) {}
+    virtual void update(void);
+    void   setOutputType(int t) {outputType = t;}
+    void   windowFunction(int w) {window = w;}
+    bool   available(void) {bool a = outputflag; outputflag = false; return a;}
+    float *getData(void) {return output;}
+    float  read(unsigned int bin) {return bin < N ? output[bin] : 0.0f;}
+  private:
+    audio_block_f32_t *inputQueueArray[2];
+    float    bufI[N], bufQ[N];          // newest N samples
+    float    work[2 * N];
+    float    output[N];
+    uint32_t fill = 0;                  // samples since the last FFT
+    int      outputType = FFT_RMS;
+    int      window = AudioWindowHanning1024;
+    bool     outputflag = false;
+};
+typedef AudioAnalyzeFFT_IQ_F32<1024> AudioAnalyzeFFT1024_IQ_F32;
+typedef AudioAnalyzeFFT_IQ_F32<2048> AudioAnalyzeFFT2048_IQ_F32;
+typedef AudioAnalyzeFFT_IQ_F32<4096> AudioAnalyzeFFT4096_IQ_F32;
+
+template <int N>
+void AudioAnalyzeFFT_IQ_F32<N>::update(void)
+{
+    audio_block_f32_t *bi = receiveReadOnly_f32(0);
+    audio_block_f32_t *bq = receiveReadOnly_f32(1);
+    if (!bi || !bq)
+    {
+        if (bi) release(bi);
+        if (bq) release(bq);
+        return;
+    }
+    int n = bi->length;
+    memmove(bufI, bufI + n, (N - n) * sizeof(float));
+    memmove(bufQ, bufQ + n, (N - n) * sizeof(float));
+    memcpy(bufI + N - n, bi->data, n * sizeof(float));
+    memcpy(bufQ + N - n, bq->data, n * sizeof(float));
+    release(bi);
+    release(bq);
+    fill += n;
+    if (fill < N / 2)
+        return;
+    fill = 0;
+    for (int k = 0; k < N; k++)
+    {
+        float w = window ? 0.5f - 0.5f * cosf(2.0f * (float) M_PI * k / (N - 1)) : 1.0f;
+        work[2*k]   = bufI[k] * w;
+        work[2*k+1] = bufQ[k] * w;
+    }
+    static const arm_cfft_instance_f32 inst = {N};
+    arm_cfft_f32(&inst, work, 0, 1);
+    arm_cmplx_mag_squared_f32(work, output, N);
+    float scale = 1.0f / ((float) N * N);
+    for (int k = 0; k < N; k++)
+    {
+        float p = output[k] * scale;
+        if (outputType == FFT_RMS)       output[k] = sqrtf(p);
+        else if (outputType == FFT_DBFS) output[k] = 10.0f * log10f(p + 1e-20f);
+        else                             output[k] = p;
+    }
+    outputflag = true;
+}
+#endif
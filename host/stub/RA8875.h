@@ -0,0 +1,32 @@
+//
+// RA8875.h
+//
+// Host stand-in for the RA8875 display library, only the calls DisplayQueue.h makes.  Nothing is drawn.  The
+// display tests swap in their own DQ_Transport, this is just enough for the RA8875 transport to build.
+//
+#ifndef host_ra8875_h_
+#define host_ra8875_h_
+#include "Arduino.h"
+
+typedef struct {
+    const unsigned char *index, *unicode, *data;
+    unsigned char version, reserved, index1_first, index1_last, index2_first, index2_last;
+    unsigned char bits_index, bits_width, bits_height, bits_xoffset, bits_yoffset, bits_delta;
+    unsigned char line_space, cap_height;
+} ILI9341_t3_font_t;
+
+class RA8875 {
+  public:
+    void    fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {}
+    void    writeRect(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *pixels) {}
+    void    drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {}
+    void    drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {}
+    void    BTE_move(int16_t sx, int16_t sy, int16_t w, int16_t h, int16_t dx, int16_t dy,
+                     uint8_t src_layer = 0, uint8_t dst_layer = 0) {}
+    void    setFont(const ILI9341_t3_font_t &font) {}
+    void    setTextColor(uint16_t color) {}
+    void    setCursor(int16_t x, int16_t y) {}
+    void    print(const char *text) {}
+    uint8_t readStatus(void) {return 0;}
+};
+#endif
@@ -0,0 +1,34 @@
+//
+// Wire.h
+//
+// Host stand-in for the Teensy Wire library.  Writes land in a 256 register image of one I2C device, the first
+// byte of a transmission is the register address and the rest auto increment from it like the Si5351.  Every
+// byte sent is counted so tests can check how much bus traffic a change cost.
+//
+#ifndef host_wire_h_
+#define host_wire_h_
+#include "Arduino.h"
+
+class TwoWire {
+  public:
+    void    begin(void) {}
+    void    setClock(uint32_t hz) {clock_hz = hz;}
+    void    beginTransmission(uint8_t address) {addr = address; reg = -1;}
+    size_t  write(uint8_t b) {
+        bytes++;
+        if (reg < 0) reg = b;
+        else regs[reg++ & 0xFF] = b;
+        return 1;
+    }
+    uint8_t endTransmission(void) {transmissions++; return 0;}
+    // host only
+    uint8_t  regs[256]     = {};
+    uint32_t bytes         = 0;         // bytes written, register addresses included
+    uint32_t transmissions = 0;
+    uint32_t clock_hz      = 100000;
+    uint8_t  addr          = 0;
+  private:
+    int      reg           = -1;
+};
+extern TwoWire Wire;
+#endif
@@ -0,0 +1,209 @@
+//
+// arm_math.h
+//
+// Portable versions of the CMSIS-DSP functions the sketch and the library stand-ins call.  They follow the CMSIS
+// argument order, state layouts and results (FIR coefficients in time reversed order, decimator and interpolator
+// state sizes) but are plain C loops, so host timings show relative cost, not Cortex-M7 cycle counts.
+//
+#ifndef host_arm_math_h_
+#define host_arm_math_h_
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+typedef float   float32_t;
+typedef double  float64_t;
+typedef int16_t q15_t;
+typedef int32_t q31_t;
+
+typedef enum {
+    ARM_MATH_SUCCESS        = 0,
+    ARM_MATH_ARGUMENT_ERROR = -1,
+    ARM_MATH_LENGTH_ERROR   = -2
+} arm_status;
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static inline void arm_copy_f32(const float32_t *s, float32_t *d, uint32_t n) {memmove(d, s, n * sizeof(float32_t));}
+static inline void arm_fill_f32(float32_t v, float32_t *d, uint32_t n) {for (uint32_t i = 0; i < n; i++) d[i] = v;}
+static inline void arm_add_f32(const float32_t *a, const float32_t *b, float32_t *d, uint32_t n)
+    {for (uint32_t i = 0; i < n; i++) d[i] = a[i] + b[i];}
+static inline void arm_sub_f32(const float32_t *a, const float32_t *b, float32_t *d, uint32_t n)
+    {for (uint32_t i = 0; i < n; i++) d[i] = a[i] - b[i];}
+static inline void arm_mult_f32(const float32_t *a, const float32_t *b, float32_t *d, uint32_t n)
+    {for (uint32_t i = 0; i < n; i++) d[i] = a[i] * b[i];}
+static inline void arm_scale_f32(const float32_t *s, float32_t k, float32_t *d, uint32_t n)
+    {for (uint32_t i = 0; i < n; i++) d[i] = s[i] * k;}
+static inline void arm_offset_f32(const float32_t *s, float32_t k, float32_t *d, uint32_t n)
+    {for (uint32_t i = 0; i < n; i++) d[i] = s[i] + k;}
+static inline void arm_abs_f32(const float32_t *s, float32_t *d, uint32_t n)
+    {for (uint32_t i = 0; i < n; i++) d[i] = fabsf(s[i]);}
+static inline void arm_dot_prod_f32(const float32_t *a, const float32_t *b, uint32_t n, float32_t *r)
+    {float32_t acc = 0.0f; for (uint32_t i = 0; i < n; i++) acc += a[i] * b[i]; *r = acc;}
+static inline void arm_power_f32(const float32_t *s, uint32_t n, float32_t *r)
+    {float32_t acc = 0.0f; for (uint32_t i = 0; i < n; i++) acc += s[i] * s[i]; *r = acc;}
+static inline void arm_mean_f32(const float32_t *s, uint32_t n, float32_t *r)
+    {float32_t acc = 0.0f; for (uint32_t i = 0; i < n; i++) acc += s[i]; *r = acc / n;}
+static inline void arm_rms_f32(const float32_t *s, uint32_t n, float32_t *r)
+    {float32_t p; arm_power_f32(s, n, &p); *r = sqrtf(p / n);}
+static inline void arm_max_f32(const float32_t *s, uint32_t n, float32_t *r, uint32_t *ix)
+{
+    uint32_t k = 0;
+    for (uint32_t i = 1; i < n; i++) if (s[i] > s[k]) k = i;
+    *r = s[k]; *ix = k;
+}
+static inline void arm_min_f32(const float32_t *s, uint32_t n, float32_t *r, uint32_t *ix)
+{
+    uint32_t k = 0;
+    for (uint32_t i = 1; i < n; i++) if (s[i] < s[k]) k = i;
+    *r = s[k]; *ix = k;
+}
+static inline void arm_cmplx_mag_squared_f32(const float32_t *s, float32_t *d, uint32_t n)
+    {for (uint32_t i = 0; i < n; i++) d[i] = s[2*i]*s[2*i] + s[2*i+1]*s[2*i+1];}
+
+// ---- FIR decimator.  State is numTaps + blockSize - 1 long, oldest sample first.
+typedef struct {
+    uint8_t          M;
+    uint16_t         numTaps;
+    const float32_t *pCoeffs;
+    float32_t       *pState;
+} arm_fir_decimate_instance_f32;
+
+static inline arm_status arm_fir_decimate_init_f32(arm_fir_decimate_instance_f32 *S, uint16_t numTaps, uint8_t M,
+                                                   const float32_t *pCoeffs, float32_t *pState, uint32_t blockSize)
+{
+    if (M == 0 || blockSize % M != 0) return ARM_MATH_LENGTH_ERROR;
+    S->M = M; S->numTaps = numTaps; S->pCoeffs = pCoeffs; S->pState = pState;
+    memset(pState, 0, (numTaps + blockSize - 1) * sizeof(float32_t));
+    return ARM_MATH_SUCCESS;
+}
+static inline void arm_fir_decimate_f32(const arm_fir_decimate_instance_f32 *S, const float32_t *pSrc,
+                                        float32_t *pDst, uint32_t blockSize)
+{
+    float32_t *st = S->pState;
+    uint16_t   nt = S->numTaps;
+    memcpy(&st[nt - 1], pSrc, blockSize * sizeof(float32_t));
+    for (uint32_t o = 0; o < blockSize / S->M; o++) {
+        const float32_t *x = &st[o * S->M];            // oldest sample under the filter
+        float32_t acc = 0.0f;
+        for (uint16_t k = 0; k < nt; k++) acc += x[k] * S->pCoeffs[k];
+        pDst[o] = acc;
+    }
+    memmove(st, &st[blockSize], (nt - 1) * sizeof(float32_t));
+}
+
+// ---- FIR interpolator.  numTaps must be a multiple of L, state is numTaps/L + blockSize - 1 long.
+typedef struct {
+    uint8_t          L;
+    uint16_t         phaseLength;
+    const float32_t *pCoeffs;
+    float32_t       *pState;
+} arm_fir_interpolate_instance_f32;
+
+static inline arm_status arm_fir_interpolate_init_f32(arm_fir_interpolate_instance_f32 *S, uint8_t L,
+                                                      uint16_t numTaps, const float32_t *pCoeffs,
+                                                      float32_t *pState, uint32_t blockSize)
+{
+    if (L == 0 || numTaps % L != 0) return ARM_MATH_LENGTH_ERROR;
+    S->L = L; S->phaseLength = numTaps / L; S->pCoeffs = pCoeffs; S->pState = pState;
+    memset(pState, 0, (S->phaseLength + blockSize - 1) * sizeof(float32_t));
+    return ARM_MATH_SUCCESS;
+}
+static inline void arm_fir_interpolate_f32(const arm_fir_interpolate_instance_f32 *S, const float32_t *pSrc,
+                                           float32_t *pDst, uint32_t blockSize)
+{
+    float32_t *st = S->pState;
+    uint16_t   P  = S->phaseLength;
+    uint8_t    L  = S->L;
+    memcpy(&st[P - 1], pSrc, blockSize * sizeof(float32_t));
+    for (uint32_t i = 0; i < blockSize; i++) {
+        const float32_t *x = &st[i];                    // P inputs, oldest first, ending at input i
+        for (uint8_t j = 0; j < L; j++) {
+            // output i*L + j uses taps j, j+L, ... against inputs i, i-1, ...  Coefficients are time reversed.
+            float32_t acc = 0.0f;
+            for (uint16_t p = 0; p < P; p++)
+                acc += x[P - 1 - p] * S->pCoeffs[(P - 1 - p) * L + (L - 1 - j)];
+            pDst[i * L + j] = acc;
+        }
+    }
+    memmove(st, &st[blockSize], (P - 1) * sizeof(float32_t));
+}
+
+// ---- Biquad cascade, direct form 1.  Coefficients b0 b1 b2 a1 a2 per stage with CMSIS sign (y += a1*y1 + a2*y2).
+typedef struct {
+    uint32_t         numStages;
+    float32_t       *pState;            // x1 x2 y1 y2 per stage
+    const float32_t *pCoeffs;
+} arm_biquad_casd_df1_inst_f32;
+
+static inline void arm_biquad_cascade_df1_init_f32(arm_biquad_casd_df1_inst_f32 *S, uint8_t numStages,
+                                                   const float32_t *pCoeffs, float32_t *pState)
+{
+    S->numStages = numStages; S->pCoeffs = pCoeffs; S->pState = pState;
+    memset(pState, 0, 4 * numStages * sizeof(float32_t));
+}
+static inline void arm_biquad_cascade_df1_f32(const arm_biquad_casd_df1_inst_f32 *S, const float32_t *pSrc,
+                                              float32_t *pDst, uint32_t n)
+{
+    const float32_t *in = pSrc;
+    for (uint32_t s = 0; s < S->numStages; s++) {
+        const float32_t *c = &S->pCoeffs[5 * s];
+        float32_t *st = &S->pState[4 * s];
+        for (uint32_t i = 0; i < n; i++) {
+            float32_t x = in[i];
+            float32_t y = c[0]*x + c[1]*st[0] + c[2]*st[1] + c[3]*st[2] + c[4]*st[3];
+            st[1] = st[0]; st[0] = x;
+            st[3] = st[2]; st[2] = y;
+            pDst[i] = y;
+        }
+        in = pDst;
+    }
+}
+
+// ---- Complex FFT, radix 2 in place.  Same forward sign and unscaled result as arm_cfft_f32().
+typedef struct {
+    uint16_t fftLen;
+} arm_cfft_instance_f32;
+
+static const arm_cfft_instance_f32 arm_cfft_sR_f32_len64   = {64};
+static const arm_cfft_instance_f32 arm_cfft_sR_f32_len128  = {128};
+static const arm_cfft_instance_f32 arm_cfft_sR_f32_len256  = {256};
+static const arm_cfft_instance_f32 arm_cfft_sR_f32_len512  = {512};
+static const arm_cfft_instance_f32 arm_cfft_sR_f32_len1024 = {1024};
+static const arm_cfft_instance_f32 arm_cfft_sR_f32_len2048 = {2048};
+static const arm_cfft_instance_f32 arm_cfft_sR_f32_len4096 = {4096};
+
+static inline void arm_cfft_f32(const arm_cfft_instance_f32 *S, float32_t *p, uint8_t ifftFlag, uint8_t bitReverseFlag)
+{
+    uint32_t n = S->fftLen;
+    (void) bitReverseFlag;                          // always leaves the output in natural order
+    for (uint32_t i = 1, j = 0; i < n; i++) {
+        uint32_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            float32_t t;
+            t = p[2*i]; p[2*i] = p[2*j]; p[2*j] = t;
+            t = p[2*i+1]; p[2*i+1] = p[2*j+1]; p[2*j+1] = t;
+        }
+    }
+    double sign = ifftFlag ? 1.0 : -1.0;
+    for (uint32_t len = 2; len <= n; len <<= 1) {
+        double ang = sign * 2.0 * M_PI / len;
+        for (uint32_t k = 0; k < len / 2; k++) {
+            float32_t wr = (float32_t) cos(ang * k), wi = (float32_t) sin(ang * k);
+            for (uint32_t i = k; i < n; i += len) {
+                uint32_t m = i + len / 2;
+                float32_t xr = p[2*m] * wr - p[2*m+1] * wi;
+                float32_t xi = p[2*m] * wi + p[2*m+1] * wr;
+                p[2*m]   = p[2*i] - xr;   p[2*m+1] = p[2*i+1] - xi;
+                p[2*i]  += xr;            p[2*i+1] += xi;
+            }
+        }
+    }
+    if (ifftFlag)
+        for (uint32_t i = 0; i < 2 * n; i++) p[i] /= n;
+}
+#endif
@@ -0,0 +1,22 @@
+//
+// si5351mcu.h
+//
+// Host stand-in for the si5351mcu library calls Vfo.h makes to bring the chip up.  They do nothing, the VFO
+// registers are written through Wire.
+//
+#ifndef host_si5351mcu_h_
+#define host_si5351mcu_h_
+#include "Arduino.h"
+
+#define SI5351_CRYSTAL_LOAD_8PF     (3 << 6)
+#define SIOUT_8mA                   3
+
+class Si5351mcu {
+  public:
+    void init(uint32_t xtal, uint8_t load = SI5351_CRYSTAL_LOAD_8PF) {}
+    void correction(int32_t diff) {}
+    void setPower(uint8_t clk, uint8_t power) {}
+    void enable(uint8_t clk) {}
+    void disable(uint8_t clk) {}
+};
+#endif
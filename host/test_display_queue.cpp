@@ -0,0 +1,141 @@
+//
+// test_display_queue.cpp
+//
+// DisplayQueue.h against a mock DQ_Transport that records every op it is handed and reports the controller busy
+// for as many polls as a test asks.  Checks ordering, that a BTE move in progress never makes the engine wait,
+// the time budget, that a full ring drops instead of blocking, and that tagged fields coalesce in place.
+//
+#include <string>
+#include <vector>
+#include "DisplayQueue.h"
+
+RA8875 tft;
+static const ILI9341_t3_font_t font = {};
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    printf("  %-60s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+// ---- Mock transport
+static std::vector<std::string> ops;        // one line per op carried out
+static int  busy_polls = 0;                 // polls left before a started BTE move reports done
+static int  polls      = 0;
+static int  busy_after_bte = 0;
+static int  exec_us    = 0;                 // simulated time each op takes
+
+static void mock_exec(const struct DQ_Cmd *c)
+{
+    char line[64];
+    switch (c->op)
+    {
+        case DQ_FILL_RECT: snprintf(line, sizeof(line), "fill %d,%d", c->x, c->y); break;
+        case DQ_BTE_MOVE:  snprintf(line, sizeof(line), "bte %d,%d", c->x, c->y); busy_polls = busy_after_bte; break;
+        case DQ_TEXT:      snprintf(line, sizeof(line), "text %s", c->text); break;
+        case DQ_FIELD:     snprintf(line, sizeof(line), "field %d %s", c->tag, c->text); break;
+        default:           snprintf(line, sizeof(line), "op %d", c->op); break;
+    }
+    ops.push_back(line);
+    host_time_us += exec_us;
+}
+static bool mock_busy(void)
+{
+    polls++;
+    if (busy_polls > 0) {busy_polls--; return true;}
+    return false;
+}
+static const struct DQ_Transport mock = {mock_exec, mock_busy};
+
+static void reset(void)
+{
+    displayQueue_sync();
+    ops.clear();
+    busy_polls = polls = busy_after_bte = exec_us = 0;
+    dq_drops = dq_coalesced = 0;
+}
+
+static std::string joined(void)
+{
+    std::string s;
+    for (auto &o : ops) s += (s.empty() ? "" : "|") + o;
+    return s;
+}
+
+int main()
+{
+    host_time_us = 0;
+    displayQueue_setTransport(&mock);
+
+    printf("order\n");
+    reset();
+    dq_fillRect(1, 2, 3, 4, 0);
+    dq_print(5, 6, font, 0, "abc");
+    dq_BTE_move(7, 8, 9, 10, 11, 12, 1, 2);
+    dq_fillRect(13, 14, 1, 1, 0);
+    check(ops.empty(), "nothing runs until the engine is serviced");
+    displayQueue_service(DQ_SLICE_US);
+    check(joined() == "fill 1,2|text abc|bte 7,8|fill 13,14", "ops run in the order queued");
+
+    printf("BTE move in progress\n");
+    reset();
+    busy_after_bte = 5;
+    dq_BTE_move(0, 0, 1, 1, 0, 1, 1, 2);
+    dq_fillRect(20, 20, 1, 1, 0);
+    displayQueue_service(DQ_SLICE_US);
+    check(joined() == "bte 0,0", "service returns while the move is running");
+    int passes = 1;
+    while (displayQueue_pending() && passes < 100)
+    {
+        displayQueue_service(DQ_SLICE_US);
+        passes++;
+    }
+    check(joined() == "bte 0,0|fill 20,20", "the next op runs once the controller is done");
+    check(passes == 6 && polls == 6, "one busy poll per service call, no spinning");
+
+    printf("time budget\n");
+    reset();
+    exec_us = 300;
+    for (int i = 0; i < 10; i++)
+        dq_fillRect(i, 0, 1, 1, 0);
+    displayQueue_service(1000);
+    check(ops.size() == 4, "a 1000us budget runs 4 ops of 300us");
+    displayQueue_sync();
+    check(ops.size() == 10, "sync finishes the rest");
+
+    printf("full ring\n");
+    reset();
+    int queued = 0;
+    for (int i = 0; i < DQ_SIZE + 10; i++)
+        queued += dq_fillRect(i, 0, 1, 1, 0);
+    check(queued == DQ_SIZE - 1, "the ring takes DQ_SIZE-1 ops");
+    check(dq_drops == 11, "ops past that are dropped and counted");
+    check(ops.empty(), "a full ring does not run the engine from the producer");
+    check(!displayQueue_room(1), "no room reported while full");
+    displayQueue_service(DQ_SLICE_US);
+    check(ops.size() == DQ_SIZE - 1 && ops.back() == "fill 62,0", "the ops that went in all run");
+    check(displayQueue_room(DQ_SIZE - 1), "room again once drained");
+
+    printf("coalesced fields\n");
+    reset();
+    dq_field(DQ_TAG_FREQ, 0, 0, 10, 10, 0, 1, 1, font, 0, "7000.000");
+    dq_fillRect(30, 30, 1, 1, 0);
+    for (int i = 1; i <= 20; i++)
+    {
+        char text[16];
+        snprintf(text, sizeof(text), "7000.%03d", i);
+        dq_field(DQ_TAG_FREQ, 0, 0, 10, 10, 0, 1, 1, font, 0, text);
+    }
+    check(dq_depth() == 2, "a burst of 21 updates holds one entry");
+    check(dq_coalesced == 20, "20 updates overwrote the queued one");
+    displayQueue_service(DQ_SLICE_US);
+    check(joined() == "field 1 7000.020|fill 30,30", "only the newest value is drawn, in its original place");
+    dq_field(DQ_TAG_FREQ, 0, 0, 10, 10, 0, 1, 1, font, 0, "7000.021");
+    dq_field(DQ_TAG_NONE, 0, 0, 10, 10, 0, 1, 1, font, 0, "a");
+    dq_field(DQ_TAG_NONE, 0, 0, 10, 10, 0, 1, 1, font, 0, "b");
+    check(dq_depth() == 3, "a field already drawn is not reused, untagged never coalesce");
+
+    printf(failures ? "%d FAILED\n" : "all passed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,136 @@
+//
+// test_iq_balance.cpp
+//
+// AudioSDRiqBalance_F32 on synthetic IQ with a known gain and phase mismatch.  A tone on the upper sideband, with
+// Q scaled and turned off quadrature and a little noise on both channels, is run through the object until the
+// correction settles.  The learned errors must match the ones put in, and the image rejection measured on the
+// output by correlating against the tone and its image must be over 60dB.  The object's raw IRR estimate must
+// agree with the one measured, its corrected estimate must be over 60dB too, and quiet blocks must not move the
+// correction.
+//
+#include <OpenAudio_ArduinoLibrary.h>
+#include "AudioSDRiqBalance_F32.h"
+
+static const float fs     = 51200.0f;
+static const int   window = 4096;                       // samples the IRR is measured over, 32 blocks
+static const float f_tone = fs * 80 / window;           // 1000Hz, whole cycles in the window
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    printf("  %-70s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+// I = cos(wt) + n, Q = a * sin(wt + phi) + n
+class ImbalancedIQ : public AudioStream_F32 {
+  public:
+    ImbalancedIQ() : AudioStream_F32(0, NULL) {}
+    void set(float gain_dB, float phase_deg, float level) {
+        a = pow(10.0, gain_dB / 20.0); phi = phase_deg * M_PI / 180.0; amp = level;
+    }
+    virtual void update(void) {
+        audio_block_f32_t *i = allocate_f32(), *q = allocate_f32();
+        if (!i || !q) {release(i); release(q); return;}
+        for (int k = 0; k < AUDIO_BLOCK_SAMPLES; k++, n++)
+        {
+            double wt = 2.0 * M_PI * f_tone * n / fs;
+            i->data[k] = amp * cos(wt) + noise();
+            q->data[k] = amp * a * sin(wt + phi) + noise();
+        }
+        transmit(i, 0);
+        transmit(q, 1);
+        release(i);
+        release(q);
+    }
+  private:
+    double   a = 1.0, phi = 0.0, amp = 1.0;
+    uint64_t n = 0;
+    uint32_t seed = 12345;
+    float noise(void) {                                 // about -40dB below the tone
+        seed = seed * 1664525 + 1013904223;
+        return amp * 1e-2f * ((seed >> 8) / 8388608.0f - 1.0f);
+    }
+};
+
+// Correlates the output against e^+jwt (wanted) and e^-jwt (image) over the window
+class ImageMeter : public AudioStream_F32 {
+  public:
+    ImageMeter() : AudioStream_F32(2, inputQueueArray) {}
+    virtual void update(void) {
+        audio_block_f32_t *i = receiveReadOnly_f32(0), *q = receiveReadOnly_f32(1);
+        if (i && q)
+            for (int k = 0; k < i->length; k++, n++)
+            {
+                double wt = 2.0 * M_PI * f_tone * n / fs, c = cos(wt), s = sin(wt);
+                // (I + jQ) * e^-jwt and (I + jQ) * e^+jwt
+                w_re += i->data[k] * c + q->data[k] * s;  w_im += q->data[k] * c - i->data[k] * s;
+                m_re += i->data[k] * c - q->data[k] * s;  m_im += q->data[k] * c + i->data[k] * s;
+            }
+        release(i);
+        release(q);
+    }
+    void   start(void) {w_re = w_im = m_re = m_im = 0.0; n = 0;}
+    double irr_dB(void) {return 10.0 * log10((w_re * w_re + w_im * w_im) / (m_re * m_re + m_im * m_im + 1e-30));}
+  private:
+    audio_block_f32_t *inputQueueArray[2];
+    double   w_re, w_im, m_re, m_im;
+    uint64_t n = 0;
+};
+
+ImbalancedIQ          source;
+AudioSDRiqBalance_F32 balance;
+ImageMeter            meter;
+AudioConnection_F32   c1(source, 0, balance, 0);
+AudioConnection_F32   c2(source, 1, balance, 1);
+AudioConnection_F32   c3(balance, 0, meter, 0);
+AudioConnection_F32   c4(balance, 1, meter, 1);
+
+static double measure(void)
+{
+    meter.start();
+    for (int b = 0; b < window / AUDIO_BLOCK_SAMPLES; b++)
+        host_audio_update();
+    return meter.irr_dB();
+}
+
+int main()
+{
+    char what[112];
+    AudioMemory_F32(10, AudioSettings_F32(fs, AUDIO_BLOCK_SAMPLES));
+
+    const struct {float gain_dB, phase_deg;} cases[] = {{1.0f, 5.0f}, {-0.5f, -3.0f}, {0.2f, 1.0f}, {2.0f, -10.0f}};
+    for (auto &t : cases)
+    {
+        printf("gain error %.1f dB, phase error %.1f deg\n", t.gain_dB, t.phase_deg);
+        source.set(t.gain_dB, t.phase_deg, 0.3f);
+        balance.begin(0.01f);
+        balance.enable(false);
+        double raw = measure();
+        balance.enable(true);
+        for (int b = 0; b < 1000; b++)                  // 2.5 s, the averages settle in a few hundred blocks
+            host_audio_update();
+        double irr = measure();
+
+        // Q - p*I is a*cos(phi)*sin(wt), so the gain the object learns takes out a*cos(phi)
+        float want_gain = t.gain_dB + 20.0f * log10f(cosf(t.phase_deg * M_PI / 180.0f));
+        snprintf(what, sizeof(what), "learned gain %.3f dB (%.3f), phase %.3f deg (%.3f)",
+                 balance.getGainError_dB(), want_gain, balance.getPhaseError_deg(), t.phase_deg);
+        check(fabsf(balance.getGainError_dB() - want_gain) < 0.01f
+              && fabsf(balance.getPhaseError_deg() - t.phase_deg) < 0.05f, what);
+        snprintf(what, sizeof(what), "image rejection %.1f dB corrected, %.1f dB raw (object says %.1f)",
+                 irr, raw, balance.getRawImageRejection_dB());
+        check(irr > 60.0 && fabs(raw - balance.getRawImageRejection_dB()) < 0.5, what);
+        snprintf(what, sizeof(what), "object's corrected estimate %.1f dB", balance.getImageRejection_dB());
+        check(balance.getImageRejection_dB() > 60.0f, what);
+
+        float g = balance.getGainError_dB(), p = balance.getPhaseError_deg();
+        source.set(t.gain_dB, t.phase_deg, 0.0f);       // silence
+        for (int b = 0; b < 400; b++)
+            host_audio_update();
+        check(balance.getGainError_dB() == g && balance.getPhaseError_deg() == p, "a second of silence leaves the correction alone");
+    }
+
+    printf(failures ? "%d FAILED\n" : "all passed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,154 @@
+//
+// test_iq_phasing.cpp
+//
+// AudioFilterIQPhasing_F32 against the pair of arm_fir_f32 objects it replaced.  CMSIS takes FIR coefficients in
+// time reversed order, so Hilbert1 applied the +45 table reversed to I and Hilbert2 the -45 table reversed to Q,
+// and RX_Summer added them for USB and subtracted them for LSB.  That sum is worked out here directly and the
+// object's output must match it sample for sample.  Then a tone on each side of 0Hz (I = cos, Q = +/-sin) goes
+// through each sideband setting: USB must pass the tone above 0Hz and stop the one below, LSB the other way round.
+// Both the Hilbert.h tables at the capture rate and a design() pair at the decimated rate are checked, and a pair
+// that is not time reversed must leave the filter off.
+//
+#include <vector>
+#include <OpenAudio_ArduinoLibrary.h>
+#include "AudioFilterIQPhasing_F32.h"
+#include "FIR_Design.h"
+#include "Hilbert.h"
+
+static const int taps = 151;
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    printf("  %-64s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+// I = a*cos(wt), Q = a*sin(wt), f below 0 for the lower side
+class ToneIQ : public AudioStream_F32 {
+  public:
+    ToneIQ() : AudioStream_F32(0, NULL) {}
+    void set(float f_Hz, float fs_Hz) {w = 2.0 * M_PI * f_Hz / fs_Hz; n = 0; i_in.clear(); q_in.clear();}
+    virtual void update(void) {
+        audio_block_f32_t *i = allocate_f32(), *q = allocate_f32();
+        if (!i || !q) {release(i); release(q); return;}
+        for (int k = 0; k < AUDIO_BLOCK_SAMPLES; k++, n++)
+        {
+            i->data[k] = 0.25f * cos(w * n);
+            q->data[k] = 0.25f * sin(w * n);
+            i_in.push_back(i->data[k]);
+            q_in.push_back(q->data[k]);
+        }
+        transmit(i, 0);
+        transmit(q, 1);
+        release(i);
+        release(q);
+    }
+    std::vector<float> i_in, q_in;
+  private:
+    double   w = 0.0;
+    uint64_t n = 0;
+};
+
+class Capture : public AudioStream_F32 {
+  public:
+    Capture() : AudioStream_F32(1, inputQueueArray) {}
+    virtual void update(void) {
+        audio_block_f32_t *b = receiveReadOnly_f32(0);
+        if (!b) return;
+        out.insert(out.end(), b->data, b->data + b->length);
+        release(b);
+    }
+    std::vector<float> out;
+  private:
+    audio_block_f32_t *inputQueueArray[1];
+};
+
+ToneIQ                   tone;
+AudioFilterIQPhasing_F32 phasing;
+Capture                  capture;
+AudioConnection_F32      c1(tone, 0, phasing, 0);
+AudioConnection_F32      c2(tone, 1, phasing, 1);
+AudioConnection_F32      c3(phasing, 0, capture, 0);
+
+// Run a tone through the filter as it is set up, returns the output
+static const std::vector<float> &run(float f_Hz, float fs_Hz, int blocks)
+{
+    tone.set(f_Hz, fs_Hz);
+    capture.out.clear();
+    for (int b = 0; b < blocks; b++)
+        host_audio_update();
+    return capture.out;
+}
+
+// Old Hilbert1 +/- Hilbert2, arm_fir_f32 style: y[n] = sum b[k] x[n-k] with b the table reversed
+static float old_chain(const float *plus45, const float *minus45, size_t n, bool usb)
+{
+    double h1 = 0.0, h2 = 0.0;
+    for (int k = 0; k < taps && k <= (int) n; k++)
+    {
+        h1 += plus45[taps-1-k]  * tone.i_in[n-k];
+        h2 += minus45[taps-1-k] * tone.q_in[n-k];
+    }
+    return usb ? h1 + h2 : h1 - h2;
+}
+
+static double rms_dB(const std::vector<float> &x, size_t from)
+{
+    double sum = 0.0;
+    for (size_t k = from; k < x.size(); k++)
+        sum += (double) x[k] * x[k];
+    return 10.0 * log10(sum / (x.size() - from) + 1e-30);
+}
+
+static void pair_checks(const char *name, const float *plus45, const float *minus45, float fs_Hz, float tone_Hz)
+{
+    char what[96];
+    printf("%s\n", name);
+
+    for (int sb = IQ_PHASING_USB; sb <= IQ_PHASING_LSB; sb++)
+    {
+        phasing.begin(plus45, minus45, taps);
+        phasing.setSideband(sb);
+        const std::vector<float> &y = run(tone_Hz, fs_Hz, 16);
+        double err = 0.0;
+        for (size_t n = 0; n < y.size(); n++)
+            err = fmax(err, fabs(y[n] - old_chain(plus45, minus45, n, sb == IQ_PHASING_USB)));
+        snprintf(what, sizeof(what), "%s matches the old Hilbert1 %c Hilbert2, max error %.1e",
+                 sb == IQ_PHASING_USB ? "USB" : "LSB", sb == IQ_PHASING_USB ? '+' : '-', err);
+        check(y.size() == 16 * AUDIO_BLOCK_SAMPLES && err < 1e-5, what);
+    }
+
+    for (int sb = IQ_PHASING_USB; sb <= IQ_PHASING_LSB; sb++)
+    {
+        float  sign = (sb == IQ_PHASING_USB) ? 1.0f : -1.0f;
+        phasing.begin(plus45, minus45, taps);
+        phasing.setSideband(sb);
+        double pass = rms_dB(run(sign * tone_Hz, fs_Hz, 32), taps);
+        phasing.begin(plus45, minus45, taps);
+        double stop = rms_dB(run(-sign * tone_Hz, fs_Hz, 32), taps);
+        snprintf(what, sizeof(what), "%s passes %+.0fHz at %.1f dB, %+.0fHz down %.1f dB",
+                 sb == IQ_PHASING_USB ? "USB" : "LSB", sign * tone_Hz, pass, -sign * tone_Hz, pass - stop);
+        check(pass > -20.0 && pass - stop > 40.0, what);
+    }
+}
+
+int main()
+{
+    AudioMemory_F32(10, AudioSettings_F32(51200.0f, AUDIO_BLOCK_SAMPLES));
+
+    pair_checks("Hilbert.h 4.0kHz pair at 51.2kHz", Hilbert_Plus45_40K, Hilbert_Minus45_40K, 51200.0f, 1000.0f);
+
+    float plus45[taps], minus45[taps];
+    fir_design_hilbert_pair(plus45, minus45, taps, 150.0f, 4500.0f, 12800.0f);
+    pair_checks("design() 150-4500Hz pair at 12.8kHz", plus45, minus45, 12800.0f, 1000.0f);
+
+    printf("pair that is not time reversed\n");
+    phasing.begin(plus45, plus45, taps);
+    check(run(1000.0f, 12800.0f, 4).empty(), "begin() leaves the filter off, nothing comes out");
+    phasing.begin(plus45, minus45, taps);
+    check(run(1000.0f, 12800.0f, 4).size() == 4 * AUDIO_BLOCK_SAMPLES, "a good pair turns it back on");
+
+    printf(failures ? "%d FAILED\n" : "all passed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,162 @@
+//
+// test_iq_ring.cpp
+//
+// AudioSDRrecordIQ_F32 ring under a reader that stalls.  The source puts a sample counter in I and Q so every pair
+// read back says where it came from.  The reader runs like task_IQRec(): every 10ms, whole sectors up to a chunk,
+// with an audio update landing between readPtr() and consume() as the interrupt would.  It stalls now and then for
+// less than the ring holds, which must lose nothing, and for longer, which must drop whole blocks and count them.
+// What is read back must be in order, with every gap a whole number of blocks adding up to the dropped count.
+//
+#include <OpenAudio_ArduinoLibrary.h>
+#include "AudioSDRrecordIQ_F32.h"
+
+static const float    fs       = 51200.0f;
+static const uint32_t ring_bytes = 131072;          // IQ_REC_RING, 640ms
+static const uint32_t chunk    = 16384;             // IQ_REC_CHUNK
+static const uint32_t sector   = 512;
+static const int      per_run  = 4;                 // audio updates per reader run, 10ms
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    printf("  %-64s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+// I = count bits 0-14, Q = bits 15-29, both exact in int16 after the recorder's * 32768
+class CountSource : public AudioStream_F32 {
+  public:
+    CountSource() : AudioStream_F32(0, NULL) {}
+    virtual void update(void) {
+        audio_block_f32_t *i = allocate_f32(), *q = allocate_f32();
+        if (!i || !q) {release(i); release(q); return;}
+        for (int k = 0; k < AUDIO_BLOCK_SAMPLES; k++, n++)
+        {
+            i->data[k] = (n & 0x7FFF) / 32768.0f;
+            q->data[k] = ((n >> 15) & 0x7FFF) / 32768.0f;
+        }
+        transmit(i, 0);
+        transmit(q, 1);
+        release(i);
+        release(q);
+        blocks++;
+    }
+    uint32_t n = 0, blocks = 0;
+};
+
+CountSource           source;
+AudioSDRrecordIQ_F32  rec;
+AudioConnection_F32   c1(source, 0, rec, 0);
+AudioConnection_F32   c2(source, 1, rec, 1);
+
+static uint8_t  ring[ring_bytes];
+static uint32_t expect;                             // next count the reader should see
+static uint32_t in_blocks, in_end;                  // blocks made and the next count when the recording stopped
+static uint32_t gap_blocks, bad, max_contiguous, wraps_crossed;
+
+// The data must be read out before consume(), an audio update in between must not touch it
+static void read_out(bool sectors_only)
+{
+    uint32_t n;
+    const uint8_t *p = rec.readPtr(&n);
+    n = (n < chunk) ? n : chunk;
+    if (sectors_only)
+        n -= n % sector;
+    if (n == 0)
+        return;
+    if (n > max_contiguous) max_contiguous = n;
+    if (p + n > ring + ring_bytes) wraps_crossed++;
+
+    host_audio_update();                            // the interrupt lands while the card write runs
+    for (uint32_t k = 0; k < n; k += 4)
+    {
+        const int16_t *s = (const int16_t *) (p + k);
+        uint32_t count = (uint32_t) s[0] | ((uint32_t) s[1] << 15);
+        if (count != expect)
+        {
+            if (count < expect || (count - expect) % AUDIO_BLOCK_SAMPLES != 0 || expect % AUDIO_BLOCK_SAMPLES != 0)
+                bad++;                              // out of order or a partial block lost
+            else
+                gap_blocks += (count - expect) / AUDIO_BLOCK_SAMPLES;
+        }
+        expect = count + 1;
+    }
+    rec.consume(n);
+}
+
+// Run the audio for ms with the reader every 10ms, or not at all while stalled
+static void run(int ms, bool stalled)
+{
+    for (int u = 0; u < ms * fs / 1000 / AUDIO_BLOCK_SAMPLES; u++)
+    {
+        host_audio_update();
+        if (!stalled && u % per_run == per_run - 1)
+            read_out(true);
+    }
+}
+
+static void start(void)
+{
+    rec.start();
+    expect = source.n;
+    gap_blocks = bad = max_contiguous = wraps_crossed = 0;
+    source.blocks = 0;
+}
+
+// Drain what is left.  Blocks dropped at the very end show as a gap up to where the source was at the stop.
+static void finish(void)
+{
+    rec.stop();
+    in_blocks = source.blocks;
+    in_end = source.n;
+    while (rec.available() > 0)
+        read_out(false);
+    if (in_end > expect)
+        gap_blocks += (in_end - expect) / AUDIO_BLOCK_SAMPLES;
+}
+
+int main()
+{
+    char what[96];
+    AudioMemory_F32(10, AudioSettings_F32(fs, AUDIO_BLOCK_SAMPLES));
+
+    check(!rec.begin(ring, 3000) && !rec.begin(ring, 256), "begin() turns down a ring that is not a power of 2 or too small");
+    check(rec.begin(ring, ring_bytes), "begin() takes the 128KB ring");
+
+    printf("stalls shorter than the ring\n");
+    start();
+    for (int i = 0; i < 20; i++)
+    {
+        run(200, false);
+        run(100 + 25 * (i % 20), true);             // 100 to 575ms
+    }
+    finish();
+    snprintf(what, sizeof(what), "%u blocks in, %u recorded, %u dropped", in_blocks, rec.getBlocks(), rec.getDropped());
+    check(rec.getBlocks() == in_blocks && rec.getDropped() == 0, what);
+    check(bad == 0 && gap_blocks == 0 && expect == in_end, "every sample read back once, in order");
+    snprintf(what, sizeof(what), "most queued %u of %u bytes", rec.getMaxFill(), rec.getSize());
+    check(rec.getMaxFill() > ring_bytes / 2 && rec.getMaxFill() <= ring_bytes, what);
+    check(wraps_crossed == 0 && max_contiguous <= chunk, "reads stop at the end of the ring and at the chunk size");
+
+    printf("stalls longer than the ring\n");
+    start();
+    for (int i = 0; i < 10; i++)
+    {
+        run(300, false);
+        run(700 + 100 * i, true);                   // 700ms to 1.6s
+    }
+    finish();
+    snprintf(what, sizeof(what), "%u blocks in, %u recorded, %u dropped", in_blocks, rec.getBlocks(), rec.getDropped());
+    check(rec.getDropped() > 0 && rec.getBlocks() + rec.getDropped() == in_blocks, what);
+    snprintf(what, sizeof(what), "gaps of whole blocks, %u in all", gap_blocks);
+    check(bad == 0 && gap_blocks == rec.getDropped(), what);
+    check(rec.getMaxFill() <= ring_bytes, "the ring never overfills");
+
+    printf("stopped\n");
+    uint32_t blocks = rec.getBlocks();
+    run(100, false);
+    check(rec.getBlocks() == blocks && rec.available() == 0, "nothing is taken once stopped");
+
+    printf(failures ? "%d FAILED\n" : "all passed\n", failures);
+    return failures ? 1 : 0;
+}
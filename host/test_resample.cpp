@@ -0,0 +1,157 @@
+//
+// test_resample.cpp
+//
+// Frequency response of AudioDecimateIQ_F32 and AudioInterpolate_F32 as built by begin(), measured with tones run
+// through the objects.  The decimator must be flat over the demodulator passband and at least 60dB down from the
+// reduced rate's Nyquist, where anything left would alias into the audio.  The interpolator must be just as flat
+// and hold the images of the reduced rate signal 60dB down.
+//
+#include <OpenAudio_ArduinoLibrary.h>
+#include "AudioSDRresample_F32.h"
+
+static const float fs = 51200.0f;
+static int failures = 0;
+
+static void check(bool ok, const char *what, float f, float db)
+{
+    printf("  %-28s %8.1f Hz %8.3f dB  %s\n", what, f, db, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+// Sends a complex tone (I cos, Q sin) at the block rate it is told
+class ToneSource : public AudioStream_F32 {
+  public:
+    ToneSource() : AudioStream_F32(0, NULL) {}
+    void set(float f_Hz, float rate_Hz, int length, bool iq) {w = 2.0 * M_PI * f_Hz / rate_Hz; n = length; quad = iq; ph = 0.0;}
+    virtual void update(void) {
+        audio_block_f32_t *i = allocate_f32(), *q = quad ? allocate_f32() : NULL;
+        if (!i) return;
+        for (int k = 0; k < n; k++, ph += w)
+        {
+            i->data[k] = cos(ph);
+            if (q) q->data[k] = sin(ph);
+        }
+        i->length = n;
+        transmit(i, 0);
+        release(i);
+        if (q) {q->length = n; transmit(q, 1); release(q);}
+    }
+  private:
+    double w = 0.0, ph = 0.0;
+    int    n = AUDIO_BLOCK_SAMPLES;
+    bool   quad = true;
+};
+
+// Keeps the last blocks it was sent on inputs 0 and 1
+class Capture : public AudioStream_F32 {
+  public:
+    Capture() : AudioStream_F32(2, inputQueueArray) {}
+    virtual void update(void) {
+        for (int ch = 0; ch < 2; ch++)
+        {
+            audio_block_f32_t *b = receiveReadOnly_f32(ch);
+            if (!b) continue;
+            memcpy(data[ch], b->data, b->length * sizeof(float));
+            length = b->length;
+            release(b);
+        }
+    }
+    float data[2][AUDIO_BLOCK_SAMPLES];
+    int   length = 0;
+  private:
+    audio_block_f32_t *inputQueueArray[2];
+};
+
+ToneSource           tone, toneLow;
+AudioDecimateIQ_F32  decimate;
+AudioInterpolate_F32 interpolate;
+Capture              capDec, capInt;
+AudioConnection_F32  c1(tone, 0, decimate, 0);
+AudioConnection_F32  c2(tone, 1, decimate, 1);
+AudioConnection_F32  c3(decimate, 0, capDec, 0);
+AudioConnection_F32  c4(decimate, 1, capDec, 1);
+AudioConnection_F32  c5(toneLow, 0, interpolate, 0);
+AudioConnection_F32  c6(interpolate, 0, capInt, 0);
+
+// Level of the complex tone through the decimator, dB.  The input is unit magnitude.
+static float decimated_dB(float f, int factor)
+{
+    tone.set(f, fs, AUDIO_BLOCK_SAMPLES, true);
+    toneLow.set(0.0f, fs / factor, AUDIO_BLOCK_SAMPLES / factor, false);
+    for (int b = 0; b < 40; b++) host_audio_update();
+    double p = 0.0;
+    for (int k = 0; k < capDec.length; k++)
+        p += capDec.data[0][k] * capDec.data[0][k] + capDec.data[1][k] * capDec.data[1][k];
+    return 10.0f * log10f(p / capDec.length + 1e-20);
+}
+
+// Interpolated output of a reduced rate cosine at f: level of the tone and of its worst image, dB
+static void interpolated_dB(float f, int factor, float *tone_dB, float *image_dB)
+{
+    float rate = fs / factor;
+    tone.set(0.0f, fs, AUDIO_BLOCK_SAMPLES, true);
+    toneLow.set(f, rate, AUDIO_BLOCK_SAMPLES / factor, false);
+    *tone_dB = *image_dB = -200.0f;
+    for (int b = 0; b < 40; b++) host_audio_update();
+    // Correlate over one output block.  f and the images at k * rate +/- f are whole cycles per block, so they
+    // do not leak into each other.
+    int n = capInt.length;
+    for (int k = 0; k < factor; k++)
+        for (int s = -1; s <= 1; s += 2)
+        {
+            float fi = k * rate + s * f;
+            if (fi < 0.0f || fi > fs / 2.0f || (k == 0 && s < 0)) continue;
+            double re = 0.0, im = 0.0;
+            for (int j = 0; j < n; j++)
+            {
+                re += capInt.data[0][j] * cos(2.0 * M_PI * fi * j / fs);
+                im -= capInt.data[0][j] * sin(2.0 * M_PI * fi * j / fs);
+            }
+            float db = 20.0f * log10f(2.0 * sqrt(re * re + im * im) / n + 1e-20);
+            if (k == 0) *tone_dB = db;
+            else if (db > *image_dB) *image_dB = db;
+        }
+}
+
+int main()
+{
+    AudioMemory_F32(20, AudioSettings_F32(fs, AUDIO_BLOCK_SAMPLES));
+    const int factors[] = {2, 4, 8};
+    for (int factor : factors)
+    {
+        float rate = fs / factor;
+        printf("factor %d, reduced rate %.0f Hz\n", factor, rate);
+        decimate.begin(factor, fs);
+        interpolate.begin(factor, fs);
+
+        float worst_pass = 0.0f, worst_pass_f = 0.0f, worst_stop = -200.0f, worst_stop_f = 0.0f;
+        for (float f = 0.0f; f <= 0.35f * rate; f += rate / 64.0f)
+        {
+            float db = decimated_dB(f, factor);
+            if (fabsf(db) > fabsf(worst_pass)) {worst_pass = db; worst_pass_f = f;}
+        }
+        // Whole stopband, both signs of frequency since the input is complex
+        for (float f = 0.5f * rate; f <= fs / 2.0f; f += rate / 64.0f)
+            for (int s = -1; s <= 1; s += 2)
+            {
+                float db = decimated_dB(s * f, factor);
+                if (db > worst_stop) {worst_stop = db; worst_stop_f = s * f;}
+            }
+        check(fabsf(worst_pass) < 0.02f, "decimate passband", worst_pass_f, worst_pass);
+        check(worst_stop < -60.0f, "decimate stopband", worst_stop_f, worst_stop);
+
+        float worst_tone = 0.0f, worst_tone_f = 0.0f, worst_image = -200.0f, worst_image_f = 0.0f;
+        const float bin = fs / AUDIO_BLOCK_SAMPLES;
+        for (float f = bin; f <= 0.35f * rate; f += bin)
+        {
+            float t, im;
+            interpolated_dB(f, factor, &t, &im);
+            if (fabsf(t) > fabsf(worst_tone)) {worst_tone = t; worst_tone_f = f;}
+            if (im - t > worst_image) {worst_image = im - t; worst_image_f = f;}
+        }
+        check(fabsf(worst_tone) < 0.1f, "interpolate passband", worst_tone_f, worst_tone);
+        check(worst_image < -60.0f, "interpolate images", worst_image_f, worst_image);
+    }
+    printf(failures ? "%d FAILED\n" : "all passed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,86 @@
+//
+// test_smeter.cpp
+//
+// AudioSDRsmeter_F32: the table log against 10*log10, and the meter reading and ballistics for a sine of known
+// level fed through the object at the receive chain's rate.
+//
+#include <OpenAudio_ArduinoLibrary.h>
+#include "AudioSDRsmeter_F32.h"
+
+static const float fs = 12800.0f;
+static const int   block = 32;              // decimated block length, as in the receive chain
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    printf("  %-64s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+// Sine source, amplitude can be changed between updates
+class Sine : public AudioStream_F32 {
+  public:
+    Sine() : AudioStream_F32(0, NULL) {}
+    virtual void update(void) {
+        audio_block_f32_t *b = allocate_f32();
+        if (!b) return;
+        for (int k = 0; k < block; k++, ph += 2.0 * M_PI * 1000.0 / fs)
+            b->data[k] = amplitude * sin(ph);
+        b->length = block;
+        transmit(b);
+        release(b);
+    }
+    float  amplitude = 0.0f;
+  private:
+    double ph = 0.0;
+};
+
+Sine                sine;
+AudioSDRsmeter_F32  meter;
+AudioConnection_F32 c1(sine, 0, meter, 0);
+
+// Run for ms and return the reading
+static float run(float ms)
+{
+    for (int n = (int) (ms / 1000.0f * fs / block); n > 0; n--)
+        host_audio_update();
+    return meter.getdBFS();
+}
+
+int main()
+{
+    char what[96];
+    AudioMemory_F32(10, AudioSettings_F32(fs, block));
+    meter.begin(10.0f, 500.0f, fs);
+
+    printf("table log\n");
+    double worst = 0.0, at = 0.0;
+    for (double p = 1e-12; p < 100.0; p *= 1.0001)
+    {
+        double e = fabs(AudioSDRsmeter_F32::fastdB(p) - 10.0 * log10(p));
+        if (e > worst) {worst = e; at = p;}
+    }
+    snprintf(what, sizeof(what), "fastdB within %.6f dB of 10*log10 (worst at %.3g)", worst, at);
+    check(worst < 0.0001, what);
+    check(AudioSDRsmeter_F32::fastdB(0.0f) <= SMETER_FLOOR_DB, "zero power reads the floor");
+
+    printf("reading\n");
+    sine.amplitude = 0.1f;                  // mean power 0.005, -23.01 dBFS
+    float r = run(3000.0f);
+    snprintf(what, sizeof(what), "0.1 amplitude sine reads %.3f dBFS (-23.010)", r);
+    check(fabsf(r + 23.010f) < 0.05f, what);
+
+    printf("ballistics\n");
+    sine.amplitude = 1.0f;                  // +20dB step, -3.01 dBFS
+    r = run(30.0f);
+    snprintf(what, sizeof(what), "attack: %.2f dBFS 30ms (3 time constants) into a 20dB step", r);
+    check(r > -4.5f && r < -3.0f, what);
+    run(3000.0f);
+    sine.amplitude = 0.0f;
+    r = run(500.0f);
+    snprintf(what, sizeof(what), "decay: %.2f dBFS 500ms after the signal goes away", r);
+    check(r > -12.0f && r < -5.0f, what);
+
+    printf(failures ? "%d FAILED\n" : "all passed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,128 @@
+//
+// test_vfo.cpp
+//
+// Vfo.h register packing and I2C traffic, against a Wire stand-in that keeps a register image of the Si5351.
+// Each frequency in the reference table is tuned from a cold chip and the PLLA (26-33) and MultiSynth0 (42-49)
+// bytes are compared with values worked out separately from the AN619 formulas.  The table covers every
+// MultiSynth divider the HF bands use and the divide by 4 mode above 150 MHz.  The output frequency decoded back
+// from the register image must be within half a PLL fraction step.  Then the bytes a retune costs are checked.
+//
+#include "Vfo.h"
+
+TwoWire           Wire;
+Si5351mcu         si5351;
+volatile uint32_t Freq = 7074000;
+volatile uint32_t Fc   = -566;          // as in SDR_RA8875.ino
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    printf("  %-64s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+struct Vfo_Ref {
+    uint32_t freq;
+    uint32_t ms_div;
+    uint8_t  pll[8];
+    uint8_t  ms[8];
+};
+static const struct Vfo_Ref ref[] = {
+    {  1000000,  224, {0xFF, 0xFF, 0x00, 0x0F, 0xE8, 0xFA, 0xDF, 0x68}, {0x00, 0x01, 0x00, 0x6E, 0x00, 0x00, 0x00, 0x00}},
+    {  1840000,  122, {0xFF, 0xFF, 0x00, 0x0F, 0xF3, 0xFB, 0x11, 0x73}, {0x00, 0x01, 0x00, 0x3B, 0x00, 0x00, 0x00, 0x00}},
+    {  3573000,   62, {0xFF, 0xFF, 0x00, 0x0F, 0xB7, 0xFE, 0x47, 0xB7}, {0x00, 0x01, 0x00, 0x1D, 0x00, 0x00, 0x00, 0x00}},
+    {  7074000,   30, {0xFF, 0xFF, 0x00, 0x0E, 0xF9, 0xFA, 0xFC, 0x79}, {0x00, 0x01, 0x00, 0x0D, 0x00, 0x00, 0x00, 0x00}},
+    { 10136000,   22, {0xFF, 0xFF, 0x00, 0x0F, 0xD6, 0xF6, 0x0D, 0x56}, {0x00, 0x01, 0x00, 0x09, 0x00, 0x00, 0x00, 0x00}},
+    { 14074000,   14, {0xFF, 0xFF, 0x00, 0x0D, 0xC2, 0xFE, 0xB9, 0xC2}, {0x00, 0x01, 0x00, 0x05, 0x00, 0x00, 0x00, 0x00}},
+    { 18100000,   12, {0xFF, 0xFF, 0x00, 0x0F, 0x5F, 0xFE, 0x15, 0x5F}, {0x00, 0x01, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00}},
+    { 21074000,   10, {0xFF, 0xFF, 0x00, 0x0E, 0xDB, 0xF9, 0xC1, 0x5B}, {0x00, 0x01, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00}},
+    { 24915000,    8, {0xFF, 0xFF, 0x00, 0x0D, 0xF1, 0xFC, 0x37, 0xF1}, {0x00, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00}},
+    { 28074000,    8, {0xFF, 0xFF, 0x00, 0x0F, 0xF7, 0xF4, 0xE8, 0x77}, {0x00, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00}},
+    { 37000000,    6, {0xFF, 0xFF, 0x00, 0x0F, 0xC2, 0xF3, 0xFA, 0x42}, {0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00}},
+    { 37499000,    6, {0xFF, 0xFF, 0x00, 0x0F, 0xFF, 0xF8, 0xFF, 0xFF}, {0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00}},
+    { 50313000,    4, {0xFF, 0xFF, 0x00, 0x0E, 0x19, 0xF6, 0x01, 0x99}, {0x00, 0x01, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    { 54000000,    4, {0xFF, 0xFF, 0x00, 0x0F, 0x47, 0xF6, 0x5F, 0x47}, {0x00, 0x01, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00}},
+};
+
+// a + b/c from the 8 byte P1/P2/P3 layout, a + b/c = (P1 + 512 + P2/P3) / 128
+static double unpack(const uint8_t *r)
+{
+    uint32_t p3 = ((r[5] & 0xF0) << 12) | (r[0] << 8) | r[1];
+    uint32_t p1 = ((r[2] & 0x03) << 16) | (r[3] << 8) | r[4];
+    uint32_t p2 = ((r[5] & 0x0F) << 16) | (r[6] << 8) | r[7];
+    return (p1 + 512 + (double) p2 / p3) / 128.0;
+}
+
+// CLK0 frequency the register image would produce
+static double chip_freq(void)
+{
+    double fvco = unpack(&Wire.regs[SI5351_PLLA_REG]) * (VFO_XTAL + VFO_CORRECTION);
+    if ((Wire.regs[SI5351_MS0_REG + 2] & SI5351_MS_DIVBY4) == SI5351_MS_DIVBY4)
+        return fvco / 4;
+    return fvco / unpack(&Wire.regs[SI5351_MS0_REG]);
+}
+
+static double want_freq(void)
+{
+    return (double) (uint32_t) ((Freq + Fc) * 4);
+}
+
+int main()
+{
+    char what[96];
+
+    printf("cold start\n");
+    uint32_t before = Wire.bytes;
+    initVfo();
+    check(Wire.clock_hz == VFO_I2C_CLOCK, "I2C clock set for fast mode");
+    check(Wire.regs[SI5351_CLK0_CTRL] == (0x40 | 0x0C | VFO_DRIVE), "CLK0 integer mode, PLLA, MultiSynth source");
+    check(vfo_bytes_last == 20, "first tune writes both blocks and the PLL reset, 20 bytes");
+    check(Wire.bytes - before == 2 + 20, "bytes on the bus match, plus the CLK0 control write");
+
+    printf("reference table\n");
+    for (const struct Vfo_Ref &t : ref)
+    {
+        Freq = t.freq;
+        vfo_regs_valid = false;             // tune each entry from a cold chip
+        SetFreq();
+        double step = (double) (VFO_XTAL + VFO_CORRECTION) / VFO_FRAC_DENOM / 2.0 / t.ms_div;
+        double err  = fabs(chip_freq() - want_freq());
+        bool ok = vfo_regs.ms_div == t.ms_div
+               && !memcmp(&Wire.regs[SI5351_PLLA_REG], t.pll, 8)
+               && !memcmp(&Wire.regs[SI5351_MS0_REG], t.ms, 8)
+               && err <= step + 1e-3
+               && vfo_bytes_last == 20;
+        snprintf(what, sizeof(what), "%8u Hz  MS %3u  error %.3f Hz (max %.3f)", t.freq, vfo_regs.ms_div, err, step);
+        check(ok, what);
+    }
+
+    printf("retune traffic\n");
+    Freq = 14074000;
+    vfo_regs_valid = false;
+    SetFreq();
+    SetFreq();
+    check(vfo_bytes_last == 0, "retune to the same frequency sends nothing");
+    uint32_t ms_changes = vfo_ms_changes, total = 0, worst = 0;
+    double   maxerr = 0.0;
+    for (int i = 0; i < 1000; i++)
+    {
+        Freq += 10;
+        SetFreq();
+        total += vfo_bytes_last;
+        if (vfo_bytes_last > worst) worst = vfo_bytes_last;
+        maxerr = fmax(maxerr, fabs(chip_freq() - want_freq()));
+    }
+    snprintf(what, sizeof(what), "1000 x 10 Hz steps: avg %.2f bytes, worst %u, error %.3f Hz",
+             total / 1000.0, worst, maxerr);
+    check(vfo_ms_changes == ms_changes && worst <= 9 && total < 5000 && maxerr < 1.0, what);
+    Freq = 50313000;
+    SetFreq();
+    check(vfo_regs.ms_div == 4 && vfo_bytes_last > 9 && !memcmp(&Wire.regs[SI5351_MS0_REG], ref[12].ms, 8),
+          "20m to 6m switches to divide by 4 with P1 = P2 = 0, P3 = 1");
+    Freq = 50314000;
+    SetFreq();
+    check(vfo_bytes_last <= 9 && fabs(chip_freq() - want_freq()) < 3.0, "tuning within 6m only moves the PLL");
+
+    printf(failures ? "%d FAILED\n" : "all passed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,127 @@
+//
+// test_zoom.cpp
+//
+// AudioSDRzoomIQ_F32 as spectrum_zoom_set() builds it, measured with complex tones.  A zoom of 1 must pass the
+// blocks through untouched.  For 2 to 16 the output must come in full blocks at 1/zoom the rate, be flat over
+// the middle of the zoomed span, and hold tones outside the span down where they would alias into it.  The stop
+// region starts at 0.6 * the reduced rate, whose alias lands 0.4 * the reduced rate from the VFO, in the edge bins
+// of the span the header says are rolled off.
+//
+#include <OpenAudio_ArduinoLibrary.h>
+#include "AudioSDRzoomIQ_F32.h"
+
+static const float fs = 51200.0f;
+static int failures = 0;
+
+static void check(bool ok, const char *what, float f, float db)
+{
+    printf("  %-28s %8.1f Hz %8.3f dB  %s\n", what, f, db, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+// Sends a unit complex tone, I cos and Q sin
+class ToneSource : public AudioStream_F32 {
+  public:
+    ToneSource() : AudioStream_F32(0, NULL) {}
+    void set(float f_Hz) {w = 2.0 * M_PI * f_Hz / fs; ph = 0.0;}
+    virtual void update(void) {
+        audio_block_f32_t *i = allocate_f32(), *q = allocate_f32();
+        if (!i || !q) {release(i); release(q); return;}
+        for (int k = 0; k < AUDIO_BLOCK_SAMPLES; k++, ph += w)
+        {
+            i->data[k] = cos(ph);
+            q->data[k] = sin(ph);
+        }
+        transmit(i, 0);
+        transmit(q, 1);
+        release(i);
+        release(q);
+    }
+  private:
+    double w = 0.0, ph = 0.0;
+};
+
+// Keeps the last I and Q blocks and counts them
+class Capture : public AudioStream_F32 {
+  public:
+    Capture() : AudioStream_F32(2, inputQueueArray) {}
+    virtual void update(void) {
+        for (int ch = 0; ch < 2; ch++)
+        {
+            audio_block_f32_t *b = receiveReadOnly_f32(ch);
+            if (!b) continue;
+            memcpy(data[ch], b->data, b->length * sizeof(float));
+            length = b->length;
+            if (ch == 0) blocks++;
+            release(b);
+        }
+    }
+    float data[2][AUDIO_BLOCK_SAMPLES];
+    int   length = 0, blocks = 0;
+  private:
+    audio_block_f32_t *inputQueueArray[2];
+};
+
+ToneSource          tone;
+AudioSDRzoomIQ_F32  zoom;
+Capture             capture;
+AudioConnection_F32 c1(tone, 0, zoom, 0);
+AudioConnection_F32 c2(tone, 1, zoom, 1);
+AudioConnection_F32 c3(zoom, 0, capture, 0);
+AudioConnection_F32 c4(zoom, 1, capture, 1);
+
+// Level of the tone at f out of the zoom, dB.  Runs long enough to fill the longest filter and a full block after.
+static float zoomed_dB(float f, int factor)
+{
+    tone.set(f);
+    for (int b = 0; b < 2 * ZOOM_TAPS_PER_FACTOR + 2 * factor; b++) host_audio_update();
+    double p = 0.0;
+    for (int k = 0; k < capture.length; k++)
+        p += capture.data[0][k] * capture.data[0][k] + capture.data[1][k] * capture.data[1][k];
+    return 10.0f * log10f(p / capture.length + 1e-20);
+}
+
+int main()
+{
+    AudioMemory_F32(20, AudioSettings_F32(fs, AUDIO_BLOCK_SAMPLES));
+
+    printf("zoom 1\n");
+    zoom.begin(1, fs);
+    tone.set(3000.0f);
+    host_audio_update();
+    host_audio_update();
+    double err = 0.0, ph = 2.0 * M_PI * 3000.0 / fs * AUDIO_BLOCK_SAMPLES;
+    for (int k = 0; k < capture.length; k++)
+        err = fmax(err, fabs(capture.data[0][k] - cos(ph + 2.0 * M_PI * 3000.0 / fs * k)));
+    check(capture.length == AUDIO_BLOCK_SAMPLES && err < 1e-5, "passes blocks through", 3000.0f, 20.0f * log10f(err + 1e-20));
+
+    const int factors[] = {2, 4, 8, 16};
+    for (int factor : factors)
+    {
+        float rate = fs / factor;
+        printf("zoom %d, span %.0f Hz\n", factor, rate);
+        zoom.begin(factor, fs);
+
+        capture.blocks = 0;
+        tone.set(0.0f);
+        for (int b = 0; b < 8 * factor; b++) host_audio_update();
+        check(capture.blocks == 8 && capture.length == AUDIO_BLOCK_SAMPLES, "one full block per zoom in", 0.0f, 0.0f);
+
+        float worst_pass = 0.0f, worst_pass_f = 0.0f, worst_stop = -200.0f, worst_stop_f = 0.0f;
+        for (float f = -0.3f * rate; f <= 0.3f * rate; f += rate / 32.0f)
+        {
+            float db = zoomed_dB(f, factor);
+            if (fabsf(db) > fabsf(worst_pass)) {worst_pass = db; worst_pass_f = f;}
+        }
+        for (float f = 0.6f * rate; f <= fs / 2.0f; f += rate / 32.0f)
+            for (int s = -1; s <= 1; s += 2)
+            {
+                float db = zoomed_dB(s * f, factor);
+                if (db > worst_stop) {worst_stop = db; worst_stop_f = s * f;}
+            }
+        check(fabsf(worst_pass) < 0.02f, "zoomed span", worst_pass_f, worst_pass);
+        check(worst_stop < -75.0f, "outside the span", worst_stop_f, worst_stop);
+    }
+    printf(failures ? "%d FAILED\n" : "all passed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,246 @@
+#!/usr/bin/env python3
+#
+# sdr_stream_view.py
+#
+# Host side of the SDR_RA8875 USB stream (see SDR_RA8875/Host_Stream.h for the frame layout).  Opens the radio's
+# serial port, or any pty carrying the same bytes, asks for the streams, hands out credits as frames arrive and
+# draws the spectrum as a text waterfall, one line per frame, with a status line for the sequence gaps, skips and
+# IQ drops.  Console text from the radio that is mixed in with the frames is passed through with --console.
+#
+# Linux, Python 3, standard library only.
+#
+#   sdr_stream_view.py /dev/ttyACM0                 spectrum waterfall
+#   sdr_stream_view.py /dev/ttyACM0 --iq            also stream the decimated IQ, shows its level
+#   sdr_stream_view.py /dev/pts/5 --dump            print every frame header instead of drawing
+#   sdr_stream_view.py /dev/ttyACM0 --iq-out iq.raw write the IQ as int16 I,Q pairs
+#
+
+import argparse
+import math
+import os
+import select
+import shutil
+import struct
+import sys
+import termios
+import time
+import tty
+
+VERSION = 1
+SYNC = b'\xa5\x5a'
+HEADER = 8                  # sync, version, type, sequence, payload bytes
+MAX_PAYLOAD = 4096          # anything bigger is a false sync
+
+FFT, IQ, STATUS = 1, 2, 3
+CMD_SET, CMD_INTERVAL, CMD_CREDIT = 1, 2, 3
+FFT_ON, IQ_ON, STATUS_ON = 0x01, 0x02, 0x04
+
+CREDIT_WINDOW = 64          # credits kept out with the radio
+MIN_DB = -200.0             # level of code 0, one dB per code
+
+SHADES = ' .:-=+*#%@'
+
+
+def crc16(data, crc=0xFFFF):
+    """CRC-16/CCITT, the same as stream_crc() on the radio."""
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def host_frame(cmd, arg):
+    body = struct.pack('<BBI', VERSION, cmd, arg)
+    return SYNC + body + struct.pack('<H', crc16(body))
+
+
+class Decoder:
+    """Pulls frames out of the byte stream.  Bytes that are not part of a good frame are console text."""
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.bad_crc = 0
+        self.text = bytearray()
+
+    def feed(self, data):
+        self.buf += data
+        frames = []
+        while True:
+            i = self.buf.find(SYNC)
+            if i < 0:
+                keep = 1 if self.buf.endswith(SYNC[:1]) else 0
+                self.text += self.buf[:len(self.buf) - keep]
+                del self.buf[:len(self.buf) - keep]
+                break
+            if i > 0:
+                self.text += self.buf[:i]
+                del self.buf[:i]
+            if len(self.buf) < HEADER:
+                break
+            version, ftype, seq, n = struct.unpack_from('<BBHH', self.buf, 2)
+            if version != VERSION or n > MAX_PAYLOAD:
+                self.text += self.buf[:1]
+                del self.buf[:1]
+                continue
+            if len(self.buf) < HEADER + n + 2:
+                break
+            crc, = struct.unpack_from('<H', self.buf, HEADER + n)
+            if crc != crc16(self.buf[2:HEADER + n]):
+                self.bad_crc += 1
+                self.text += self.buf[:1]       # resync one byte on
+                del self.buf[:1]
+                continue
+            frames.append((ftype, seq, bytes(self.buf[HEADER:HEADER + n])))
+            del self.buf[:HEADER + n + 2]
+        return frames
+
+    def take_text(self):
+        t = bytes(self.text)
+        self.text.clear()
+        return t
+
+
+def parse_fft(p):
+    ms, freq, bin_hz, center, bins, skipped = struct.unpack_from('<IIffHH', p)
+    return dict(ms=ms, freq=freq, bin_hz=bin_hz, center=center, skipped=skipped, codes=p[20:20 + bins])
+
+
+def parse_iq(p):
+    dropped, rate, pairs, _ = struct.unpack_from('<IfHH', p)
+    return dict(dropped=dropped, rate=rate, pairs=pairs, data=p[12:12 + 4 * pairs])
+
+
+def parse_status(p):
+    f = struct.unpack_from('<IIBBHIIIII', p)
+    keys = ('ms', 'freq', 'streams', 'credits', 'interval', 'fft_sent', 'fft_skipped', 'iq_sent', 'iq_dropped',
+            'bad_host')
+    return dict(zip(keys, f))
+
+
+def waterfall_line(codes, width, lo, hi):
+    """One text line for a spectrum frame, the bins squeezed or stretched to width, levels lo to hi dB."""
+    out = []
+    n = len(codes)
+    for x in range(width):
+        a = x * n // width
+        b = max(a + 1, (x + 1) * n // width)
+        dB = max(codes[a:b]) + MIN_DB       # strongest bin in the column, so narrow signals show
+        k = int((dB - lo) / max(hi - lo, 1.0) * (len(SHADES) - 1))
+        out.append(SHADES[min(max(k, 0), len(SHADES) - 1)])
+    return ''.join(out)
+
+
+def open_port(path):
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+    if os.isatty(fd):
+        tty.setraw(fd)
+        attrs = termios.tcgetattr(fd)
+        attrs[3] &= ~termios.ECHO
+        termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    return fd
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Remote panadapter for the SDR_RA8875 USB stream')
+    ap.add_argument('port', help='serial device or pty')
+    ap.add_argument('--interval', type=int, default=100, help='ms between spectrum frames (default 100)')
+    ap.add_argument('--iq', action='store_true', help='also stream the decimated IQ')
+    ap.add_argument('--iq-out', help='write the IQ to this file as int16 I,Q pairs (implies --iq)')
+    ap.add_argument('--dump', action='store_true', help='print frame headers instead of the waterfall')
+    ap.add_argument('--console', action='store_true', help='pass the radio console text through')
+    ap.add_argument('--range', type=float, nargs=2, metavar=('LO', 'HI'),
+                    help='waterfall dB range, default follows the signal levels')
+    args = ap.parse_args()
+
+    fd = open_port(args.port)
+    iq_out = open(args.iq_out, 'wb') if args.iq_out else None
+    streams = FFT_ON | STATUS_ON | (IQ_ON if (args.iq or iq_out) else 0)
+
+    os.write(fd, host_frame(CMD_INTERVAL, args.interval))
+    os.write(fd, host_frame(CMD_SET, streams))
+    os.write(fd, host_frame(CMD_CREDIT, CREDIT_WINDOW))
+
+    dec = Decoder()
+    last_seq = None
+    gaps = owed = frames = 0
+    iq_level = None
+    iq_dropped = 0
+    lo = hi = None
+    status = {}
+    last_credit = time.monotonic()
+    try:
+        while True:
+            r, _, _ = select.select([fd], [], [], 0.5)
+            data = os.read(fd, 65536) if r else b''
+            for ftype, seq, p in dec.feed(data):
+                frames += 1
+                if last_seq is not None and seq != (last_seq + 1) & 0xFFFF:
+                    gaps += (seq - last_seq - 1) & 0xFFFF
+                last_seq = seq
+                if ftype in (FFT, IQ):
+                    owed += 1
+                if ftype == FFT:
+                    f = parse_fft(p)
+                    if args.dump:
+                        print('FFT  seq %5u  %8u ms  %10u Hz  bin %.2f Hz  center %.1f Hz  bins %u  skipped %u' %
+                              (seq, f['ms'], f['freq'], f['bin_hz'], f['center'], len(f['codes']), f['skipped']))
+                        continue
+                    levels = sorted(f['codes'])
+                    if args.range:
+                        lo, hi = args.range
+                    elif levels:
+                        # follow the noise floor and the top of the signals, like the radio's auto reference
+                        flo = levels[len(levels) // 5] + MIN_DB
+                        fhi = levels[-1] + MIN_DB
+                        lo = flo if lo is None else lo + 0.2 * (flo - lo)
+                        hi = max(fhi, lo + 20) if hi is None else hi + 0.2 * (max(fhi, lo + 20) - hi)
+                    width = shutil.get_terminal_size((100, 24)).columns
+                    print(waterfall_line(f['codes'], width, lo, hi))
+                    span = f['bin_hz'] * len(f['codes'])
+                    sys.stderr.write('\r%.3f MHz  span %.1f kHz  %.0f..%.0f dB  gaps %u  skipped %u  bad %u  %s \r' %
+                                     ((f['freq'] + f['center']) / 1e6, span / 1e3, lo, hi, gaps,
+                                      status.get('fft_skipped', 0), dec.bad_crc,
+                                      ('IQ %.1f dBFS drops %u' % (iq_level, iq_dropped)) if iq_level is not None else ''))
+                elif ftype == IQ:
+                    q = parse_iq(p)
+                    iq_dropped = q['dropped']
+                    s = struct.unpack('<%dh' % (2 * q['pairs']), q['data'])
+                    pwr = sum(v * v for v in s) / max(len(s), 1) / 32768.0 ** 2
+                    iq_level = 10 * math.log10(max(pwr, 1e-20))
+                    if iq_out:
+                        iq_out.write(q['data'])
+                    if args.dump:
+                        print('IQ   seq %5u  %u pairs at %.0f Hz  dropped blocks %u  %.1f dBFS' %
+                              (seq, q['pairs'], q['rate'], q['dropped'], iq_level))
+                elif ftype == STATUS:
+                    status = parse_status(p)
+                    if args.dump:
+                        print('STAT seq %5u  %s' % (seq, ' '.join('%s=%s' % kv for kv in status.items())))
+            text = dec.take_text()
+            if args.console and text:
+                sys.stderr.write(text.decode('ascii', 'replace'))
+
+            # Hand back credits as frames are used.  If nothing has come for a while top the window up again in
+            # case a host frame was lost, the radio caps the credit at its own limit.
+            now = time.monotonic()
+            if owed >= CREDIT_WINDOW // 4 or (now - last_credit > 2.0):
+                os.write(fd, host_frame(CMD_CREDIT, owed if owed else CREDIT_WINDOW))
+                owed = 0
+                last_credit = now
+    except KeyboardInterrupt:
+        pass
+    finally:
+        try:
+            os.write(fd, host_frame(CMD_SET, 0))
+        except OSError:
+            pass
+        os.close(fd)
+        if iq_out:
+            iq_out.close()
+        sys.stderr.write('\n%u frames, %u lost in sequence gaps, %u bad CRC\n' % (frames, gaps, dec.bad_crc))
+
+
+if __name__ == '__main__':
+    main()